@@ -0,0 +1,40 @@
+# Embeds every shader under SHADER_DIR into a C++ source file, run as a build step:
+#   cmake -DSOURCE_ROOT=<dir> -DSHADER_DIR=<dir> -DOUTPUT=<file> -P embed_shaders.cmake
+#
+# Each file becomes a raw string literal keyed by its path relative to SOURCE_ROOT (e.g. "src/shaders/BasicVS.vert"),
+# so lookups use the same paths as loading from disk. The content hash is the first 64 bits of the file's SHA1.
+
+if(NOT SOURCE_ROOT OR NOT SHADER_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "embed_shaders.cmake needs SOURCE_ROOT, SHADER_DIR and OUTPUT")
+endif()
+
+file(GLOB_RECURSE SHADER_FILES "${SHADER_DIR}/*.vert" "${SHADER_DIR}/*.frag" "${SHADER_DIR}/*.tesc"
+     "${SHADER_DIR}/*.tese" "${SHADER_DIR}/*.glsl")
+list(SORT SHADER_FILES)
+
+set(CONTENT "// Generated by cmake/embed_shaders.cmake from ${SHADER_DIR}, do not edit.\n")
+string(APPEND CONTENT "#include \"embedded_shaders.hpp\"\n\n")
+string(APPEND CONTENT "static constexpr EmbeddedShader SHADERS[] = {\n")
+
+foreach(SHADER_FILE ${SHADER_FILES})
+    file(RELATIVE_PATH NAME "${SOURCE_ROOT}" "${SHADER_FILE}")
+    file(READ "${SHADER_FILE}" SOURCE)
+    string(FIND "${SOURCE}" ")glsl\"" DELIMITER)
+    if(NOT DELIMITER EQUAL -1)
+        message(FATAL_ERROR "${SHADER_FILE} contains the raw string delimiter )glsl\"")
+    endif()
+    string(SHA1 HASH "${SOURCE}")
+    string(SUBSTRING "${HASH}" 0 16 HASH)
+    string(APPEND CONTENT "    { \"${NAME}\", 0x${HASH}ull,\n      R\"glsl(${SOURCE})glsl\" },\n")
+endforeach()
+
+string(APPEND CONTENT "};\n\n")
+string(APPEND CONTENT "const EmbeddedShader* EmbeddedShaderTable(size_t& count) {\n")
+string(APPEND CONTENT "    count = sizeof(SHADERS) / sizeof(SHADERS[0]);\n")
+string(APPEND CONTENT "    return SHADERS;\n")
+string(APPEND CONTENT "}\n")
+
+# Only touch the output when something changed, so unrelated builds don't recompile it
+file(WRITE "${OUTPUT}.tmp" "${CONTENT}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
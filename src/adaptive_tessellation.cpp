@@ -0,0 +1,68 @@
+#include "adaptive_tessellation.hpp"
+#include <algorithm>
+#include <iostream>
+
+// Squared distance from p to the segment a-b
+static float distanceSquared(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b) {
+    glm::vec3 ab = b - a;
+    float lengthSquared = glm::dot(ab, ab);
+    float t = lengthSquared > 0.0f ? std::max(0.0f, std::min(glm::dot(p - a, ab) / lengthSquared, 1.0f)) : 0.0f;
+    glm::vec3 d = p - (a + ab * t);
+    return glm::dot(d, d);
+}
+
+void AdaptiveTessellator::tessellate(const glm::vec3* controlPoints, size_t count, const glm::vec3& scale,
+                                     float tolerance, std::vector<glm::vec3>& out) {
+    out.clear();
+    if (count == 0) {
+        return;
+    }
+    if (count > MAX_CONTROL_POINTS) {
+        std::cout << "[ERROR][AdaptiveTessellator] Curves of more than " << MAX_CONTROL_POINTS
+                  << " control points aren't supported" << std::endl;
+        return;
+    }
+
+    out.push_back(controlPoints[0]);
+    if (count == 1) {
+        return;
+    }
+
+    float toleranceSquared = tolerance * tolerance;
+    stack.resize(1);
+    std::copy(controlPoints, controlPoints + count, stack[0].points);
+    stack[0].depth = 0;
+
+    while (!stack.empty()) {
+        Piece piece = stack.back();
+        stack.pop_back();
+
+        const glm::vec3* p = piece.points;
+        glm::vec3 first = p[0] * scale;
+        glm::vec3 last = p[count - 1] * scale;
+        bool flat = true;
+        for (size_t i = 1; i + 1 < count && flat; ++i) {
+            flat = distanceSquared(p[i] * scale, first, last) <= toleranceSquared;
+        }
+        if (flat || piece.depth >= maxDepth) {
+            out.push_back(p[count - 1]);
+            continue;
+        }
+
+        // de Casteljau at t = 0.5: the left half takes the first point of every level, the right one the last
+        Piece left, right;
+        left.depth = right.depth = piece.depth + 1;
+        glm::vec3 level[MAX_CONTROL_POINTS];
+        std::copy(p, p + count, level);
+        for (size_t k = 0; k < count; ++k) {
+            left.points[k] = level[0];
+            right.points[count - 1 - k] = level[count - 1 - k];
+            for (size_t i = 0; i + 1 < count - k; ++i) {
+                level[i] = (level[i] + level[i + 1]) * 0.5f;
+            }
+        }
+        // Right first, so the left half is processed next
+        stack.push_back(right);
+        stack.push_back(left);
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Tessellates a Bezier curve of any degree into as few line segments as a tolerance allows.
+//
+// The control polygon is split in half with de Casteljau until every inner control point lies within tolerance of the
+// chord between the end points. By the convex hull property the curve piece then does too, so the chord can replace
+// it. Distances are measured after multiplying by scale, e.g. the window size in pixels for a curve drawn in [0, 1]
+// coordinates, so the tolerance is in screen units and straight stretches get a single segment however long they are.
+class AdaptiveTessellator {
+public:
+    static const size_t MAX_CONTROL_POINTS = 32;
+
+    int maxDepth = 12;      // at most 2^maxDepth segments
+
+    // Writes the points from t = 0 to 1 into out, replacing its contents but keeping its storage
+    void tessellate(const glm::vec3* controlPoints, size_t count, const glm::vec3& scale, float tolerance,
+                    std::vector<glm::vec3>& out);
+
+private:
+    // Control polygons waiting to be split, depth first so the output comes out in order
+    struct Piece {
+        glm::vec3 points[MAX_CONTROL_POINTS];
+        int depth;
+    };
+    std::vector<Piece> stack;
+};
@@ -0,0 +1,148 @@
+#include "animation_tracks.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const float QUANTISED_MAX = 65535.0f;
+
+uint32_t AnimationTracks::addTrack(TrackChannel channel, const std::vector<float>& keyTimes,
+                                   const std::vector<glm::vec3>& keyValues, bool quantise) {
+    std::vector<glm::vec4> widened(keyValues.size());
+    for (size_t i = 0; i < keyValues.size(); ++i) {
+        widened[i] = glm::vec4(keyValues[i], 0.0f);
+    }
+    return add(channel, 3, keyTimes, widened, quantise);
+}
+
+uint32_t AnimationTracks::addTrack(const std::vector<float>& keyTimes, const std::vector<glm::quat>& rotations,
+                                   bool quantise) {
+    std::vector<glm::vec4> widened(rotations.size());
+    for (size_t i = 0; i < rotations.size(); ++i) {
+        glm::quat q = glm::normalize(rotations[i]);
+        glm::vec4 v(q.x, q.y, q.z, q.w);
+        // Same hemisphere as the key before, so lerping takes the short way
+        if (i > 0 && glm::dot(v, widened[i - 1]) < 0.0f) {
+            v = -v;
+        }
+        widened[i] = v;
+    }
+    return add(TrackChannel::ROTATION, 4, keyTimes, widened, quantise);
+}
+
+uint32_t AnimationTracks::add(TrackChannel channel, uint8_t components, const std::vector<float>& keyTimes,
+                              const std::vector<glm::vec4>& keyValues, bool quantise) {
+    if (keyTimes.empty() || keyTimes.size() != keyValues.size()) {
+        std::cout << "[ERROR][AnimationTracks] A track needs as many key times as values, and at least one"
+                  << std::endl;
+    }
+
+    Track track;
+    track.channel = channel;
+    track.components = components;
+    track.quantised = quantise;
+    track.firstKey = (uint32_t) times.size();
+    track.keyCount = (uint32_t) std::min(keyTimes.size(), keyValues.size());
+    times.insert(times.end(), keyTimes.begin(), keyTimes.begin() + track.keyCount);
+
+    for (int c = 0; c < 4; ++c) {
+        float minimum = 0.0f, maximum = 0.0f;
+        for (uint32_t i = 0; c < components && i < track.keyCount; ++i) {
+            minimum = i == 0 ? keyValues[i][c] : std::min(minimum, keyValues[i][c]);
+            maximum = i == 0 ? keyValues[i][c] : std::max(maximum, keyValues[i][c]);
+        }
+        track.minimum[c] = minimum;
+        track.step[c] = maximum > minimum ? (maximum - minimum) / QUANTISED_MAX : 0.0f;
+    }
+
+    track.firstValue = (uint32_t) (quantise ? quantisedValues.size() : values.size());
+    for (int c = 0; c < components; ++c) {
+        for (uint32_t i = 0; i < track.keyCount; ++i) {
+            if (quantise) {
+                float q = track.step[c] > 0.0f ? (keyValues[i][c] - track.minimum[c]) / track.step[c] : 0.0f;
+                quantisedValues.push_back((uint16_t) std::min(std::max(std::lround(q), 0L), 65535L));
+            } else {
+                values.push_back(keyValues[i][c]);
+            }
+        }
+    }
+
+    tracks.push_back(track);
+    cursors.push_back(0);
+    results.push_back(keyValues.empty() ? glm::vec4(0.0f) : keyValues[0]);
+    cursorHits.push_back(0);
+    searches.push_back(0);
+    return (uint32_t) tracks.size() - 1;
+}
+
+glm::vec4 AnimationTracks::key(const Track& track, uint32_t index) const {
+    glm::vec4 v(0.0f);
+    uint32_t i = track.firstValue + index;
+    for (int c = 0; c < track.components; ++c, i += track.keyCount) {
+        v[c] = track.quantised ? track.minimum[c] + (float) quantisedValues[i] * track.step[c] : values[i];
+    }
+    return v;
+}
+
+float AnimationTracks::duration(uint32_t track) const {
+    const Track& t = tracks[track];
+    return t.keyCount == 0 ? 0.0f : times[t.firstKey + t.keyCount - 1] - times[t.firstKey];
+}
+
+void AnimationTracks::sample(float time, uint32_t first, uint32_t count) {
+    uint32_t end = std::min(first + count, (uint32_t) tracks.size());
+    for (uint32_t t = first; t < end; ++t) {
+        const Track& track = tracks[t];
+        if (track.keyCount == 0) {
+            continue;
+        }
+        const float* keyTimes = &times[track.firstKey];
+        uint32_t last = track.keyCount - 1;
+        if (track.keyCount == 1 || time <= keyTimes[0]) {
+            results[t] = key(track, 0);
+            cursors[t] = 0;
+            continue;
+        }
+        if (time >= keyTimes[last]) {
+            results[t] = key(track, last);
+            cursors[t] = last;
+            continue;
+        }
+
+        // Key k with keyTimes[k] <= time < keyTimes[k + 1]
+        uint32_t k = cursors[t];
+        if (k < last && keyTimes[k] <= time && time < keyTimes[k + 1]) {
+            cursorHits[t]++;
+        } else if (k + 1 < last && keyTimes[k + 1] <= time && time < keyTimes[k + 2]) {
+            k++;
+            cursorHits[t]++;
+        } else {
+            k = (uint32_t) (std::upper_bound(keyTimes, keyTimes + track.keyCount, time) - keyTimes) - 1;
+            searches[t]++;
+        }
+        cursors[t] = k;
+
+        float alpha = (time - keyTimes[k]) / (keyTimes[k + 1] - keyTimes[k]);
+        glm::vec4 a = key(track, k);
+        glm::vec4 b = key(track, k + 1);
+        glm::vec4 v = a + (b - a) * alpha;
+        if (track.channel == TrackChannel::ROTATION) {
+            float length = std::sqrt(glm::dot(v, v));
+            v = length > 0.0f ? v / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+        results[t] = v;
+    }
+}
+
+TrackStats AnimationTracks::takeStats() {
+    TrackStats stats;
+    stats.tracks = (uint32_t) tracks.size();
+    stats.keys = (uint32_t) times.size();
+    for (size_t t = 0; t < tracks.size(); ++t) {
+        stats.cursorHits += cursorHits[t];
+        stats.searches += searches[t];
+        cursorHits[t] = 0;
+        searches[t] = 0;
+    }
+    stats.bytes = (times.size() + values.size()) * sizeof(float) + quantisedValues.size() * sizeof(uint16_t);
+    return stats;
+}
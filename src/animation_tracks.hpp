@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+enum class TrackChannel : uint8_t {
+    POSITION = 0,
+    ROTATION = 1,
+    SCALE = 2
+};
+
+struct TrackStats {
+    uint32_t tracks = 0;
+    uint32_t keys = 0;
+    uint32_t cursorHits = 0;    // samples found at or right after the cached key last sample()
+    uint32_t searches = 0;      // samples that needed a binary search (scrubbing, jumps, loops)
+    size_t bytes = 0;           // key storage
+};
+
+// Keyframe tracks of many animated entities, sampled together once per frame.
+//
+// Key times and values live in pooled arrays that each track points into, its values as one run per component. A
+// quantised track stores its values as 16 bits per component relative to the track's range, half the size of floats.
+// Every track keeps a cursor at the key it sampled last: playback moving forward finds its key at the cursor or the one
+// after it, anything else (scrubbing, looping) falls back to a binary search over the key times. Between keys values
+// are lerped, rotations nlerped, their keys having been flipped into one hemisphere on add.
+//
+// sample() with disjoint track ranges may run on several threads at once: a track's cursor and result are only
+// touched by the range containing it. Adding tracks while sampling isn't allowed.
+class AnimationTracks {
+public:
+    // times must be increasing. Returns the handle of the track.
+    uint32_t addTrack(TrackChannel channel, const std::vector<float>& times, const std::vector<glm::vec3>& values,
+                      bool quantise = false);
+    uint32_t addTrack(const std::vector<float>& times, const std::vector<glm::quat>& rotations, bool quantise = false);
+
+    // Samples tracks first .. first + count - 1 at time (clamped to each track's keys)
+    void sample(float time, uint32_t first, uint32_t count);
+    void sample(float time) { sample(time, 0, (uint32_t) tracks.size()); }
+
+    glm::vec3 vec3(uint32_t track) const { return glm::vec3(results[track]); }
+    glm::quat rotation(uint32_t track) const {
+        const glm::vec4& r = results[track];
+        return glm::quat(r.w, r.x, r.y, r.z);
+    }
+    float duration(uint32_t track) const;
+
+    size_t size() const { return tracks.size(); }
+    // Counters since the last call, summed over all ranges sampled
+    TrackStats takeStats();
+
+private:
+    struct Track {
+        TrackChannel channel;
+        uint8_t components;
+        bool quantised;
+        uint32_t firstKey;      // into times
+        uint32_t firstValue;    // into values, or quantisedValues if quantised. Component c starts c * keyCount later.
+        uint32_t keyCount;
+        float minimum[4];
+        float step[4];          // value of one quantisation step
+    };
+
+    std::vector<Track> tracks;
+    std::vector<float> times;
+    std::vector<float> values;
+    std::vector<uint16_t> quantisedValues;
+    std::vector<uint32_t> cursors;      // key index per track, hot data kept apart from the rest
+    std::vector<glm::vec4> results;     // x, y, z (and w of rotations) of the last sample
+    std::vector<uint32_t> cursorHits;   // per track, so ranges on different threads don't share counters
+    std::vector<uint32_t> searches;
+
+    uint32_t add(TrackChannel channel, uint8_t components, const std::vector<float>& keyTimes,
+                 const std::vector<glm::vec4>& keyValues, bool quantise);
+    glm::vec4 key(const Track& track, uint32_t index) const;
+};
@@ -0,0 +1,88 @@
+#include "arc_length.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Nodes on [-1, 1] and weights of 5 point Gauss-Legendre quadrature
+static const float GAUSS_NODES[5] = { 0.0f, -0.5384693101f, 0.5384693101f, -0.9061798459f, 0.9061798459f };
+static const float GAUSS_WEIGHTS[5] = { 0.5688888889f, 0.4786286705f, 0.4786286705f, 0.2369268851f, 0.2369268851f };
+
+void ArcLengthTable::build(const glm::vec3* controlPoints, size_t count, int intervals) {
+    lengths.assign((size_t)std::max(intervals, 1) + 1, 0.0f);
+    if (count < 2) {
+        hodograph.setControlPoints(nullptr, 0);
+        return;
+    }
+
+    // The derivative of a degree n curve is the degree n - 1 curve through n (P_i+1 - P_i)
+    std::vector<glm::vec3> differences(count - 1);
+    float degree = (float)(count - 1);
+    for (size_t i = 0; i + 1 < count; ++i) {
+        differences[i] = degree * (controlPoints[i + 1] - controlPoints[i]);
+    }
+    hodograph.setControlPoints(differences);
+
+    float step = 1.0f / (float)(lengths.size() - 1);
+    for (size_t i = 1; i < lengths.size(); ++i) {
+        lengths[i] = lengths[i - 1] + integrate((i - 1) * step, i * step);
+    }
+}
+
+float ArcLengthTable::speed(float t) const {
+    return hodograph.size() == 0 ? 0.0f : glm::length(hodograph.evaluate(t));
+}
+
+float ArcLengthTable::integrate(float t0, float t1) const {
+    float half = 0.5f * (t1 - t0);
+    float middle = 0.5f * (t0 + t1);
+    float sum = 0.0f;
+    for (int i = 0; i < 5; ++i) {
+        sum += GAUSS_WEIGHTS[i] * speed(middle + half * GAUSS_NODES[i]);
+    }
+    return sum * half;
+}
+
+float ArcLengthTable::parameterAt(float distance) const {
+    float total = length();
+    if (total <= 0.0f) {
+        // A point, every parameter is as good as any other
+        return lengths.empty() ? 0.0f : std::max(0.0f, std::min(distance, 1.0f));
+    }
+    if (distance <= 0.0f) {
+        return 0.0f;
+    }
+    if (distance >= total) {
+        return 1.0f;
+    }
+
+    // First interval whose end is beyond distance
+    size_t end = (size_t)(std::upper_bound(lengths.begin() + 1, lengths.end(), distance) - lengths.begin());
+    end = std::min(end, lengths.size() - 1);
+    float step = 1.0f / (float)(lengths.size() - 1);
+    float t0 = (end - 1) * step;
+    float start = lengths[end - 1];
+    float span = lengths[end] - start;
+    float t = span > 0.0f ? t0 + step * (distance - start) / span : t0;
+
+    // Newton on L(t) - distance, whose derivative is the speed, until the error is down to what the float lengths can
+    // resolve. Where the speed goes to zero, at a clamped end or a cusp, a step can leave the bracket around the root,
+    // the bracket is halved instead.
+    float low = t0, high = t0 + step;
+    float tolerance = 1e-6f * total;
+    for (int i = 0; i < MAX_ITERATIONS; ++i) {
+        float residual = start + integrate(t0, t) - distance;
+        if (std::fabs(residual) <= tolerance) {
+            break;
+        }
+        (residual > 0.0f ? high : low) = t;
+        float v = speed(t);
+        float refined = v > 0.0f ? t - residual / v : low;
+        t = refined > low && refined < high ? refined : 0.5f * (low + high);
+    }
+    return t;
+}
+
+void ArcLengthTable::parametersAt(const float* distances, float* ts, size_t count) const {
+    for (size_t i = 0; i < count; ++i) {
+        ts[i] = parameterAt(distances[i]);
+    }
+}
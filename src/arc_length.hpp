@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bezier_curve.hpp"
+
+// Maps distance along a Bezier curve to its parameter, for animation at constant speed.
+//
+// build() splits [0, 1] into equal parameter intervals and integrates the speed |B'(t)| over each with 5 point
+// Gauss-Legendre quadrature, which is exact for polynomials up to degree 9 and close for the square root of one. A
+// lookup binary searches the cumulative lengths for its interval, interpolates linearly inside it and refines that
+// with Newton steps on the length integral, bisecting where the speed is too close to zero for Newton. Queries are
+// const and allocation free, so any number of followers (and threads) can share the table of a curve; rebuild it only
+// when the control points change.
+class ArcLengthTable {
+public:
+    static const int MAX_ITERATIONS = 24;
+
+    void build(const glm::vec3* controlPoints, size_t count, int intervals = 64);
+
+    float length() const { return lengths.empty() ? 0.0f : lengths.back(); }
+    // Parameter t at which the curve is distance long, distance clamped to [0, length()]
+    float parameterAt(float distance) const;
+    // Same, with the distance as a fraction of the length
+    float parameterAtFraction(float fraction) const { return parameterAt(fraction * length()); }
+    // Parameters for count distances at once, e.g. all followers of the curve
+    void parametersAt(const float* distances, float* ts, size_t count) const;
+
+    int intervals() const { return lengths.empty() ? 0 : (int)lengths.size() - 1; }
+
+private:
+    BezierCurve hodograph;          // B'(t), a curve of one degree less
+    std::vector<float> lengths;     // lengths[i]: length from 0 to i / intervals()
+
+    float speed(float t) const;
+    float integrate(float t0, float t1) const;
+};
@@ -0,0 +1,92 @@
+#include "bezier_curve.hpp"
+#include <algorithm>
+
+void BezierCurve::setControlPoints(const glm::vec3* points, size_t count) {
+    if (binomials.size() != count) {
+        binomials.resize(count);
+        double binomial = 1.0;
+        for (size_t i = 0; i < count; ++i) {
+            binomials[i] = (float) binomial;
+            binomial = binomial * (double) (count - 1 - i) / (double) (i + 1);
+        }
+    }
+    weighted.resize(count);
+    weightedX.resize(count);
+    weightedY.resize(count);
+    weightedZ.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        weighted[i] = binomials[i] * points[i];
+        weightedX[i] = weighted[i].x;
+        weightedY[i] = weighted[i].y;
+        weightedZ[i] = weighted[i].z;
+    }
+}
+
+BezierWeights BezierCurve::weights() const {
+    BezierWeights result;
+    result.x = weightedX.data();
+    result.y = weightedY.data();
+    result.z = weightedZ.data();
+    result.count = weighted.size();
+    return result;
+}
+
+glm::vec3 BezierCurve::evaluate(float t) const {
+    size_t count = weighted.size();
+    if (count == 0) {
+        return glm::vec3(0.0f);
+    }
+
+    float u = 1.0f - t;
+    glm::vec3 sum;
+    float scale = 1.0f;
+    if (t <= 0.5f) {
+        // (1 - t)^n * sum(w_i s^i), s = t / (1 - t), Horner from the highest power down
+        float s = t / u;
+        sum = weighted[count - 1];
+        for (size_t i = count - 1; i-- > 0;) {
+            sum = sum * s + weighted[i];
+            scale *= u;
+        }
+    } else {
+        // t^n * sum(w_i s^(n - i)), s = (1 - t) / t
+        float s = u / t;
+        sum = weighted[0];
+        for (size_t i = 1; i < count; ++i) {
+            sum = sum * s + weighted[i];
+            scale *= t;
+        }
+    }
+    return sum * scale;
+}
+
+// Points per kernel call, the components go through the stack on their way to glm::vec3
+static const size_t BATCH = 256;
+
+void BezierCurve::evaluate(const float* ts, glm::vec3* out, size_t count) const {
+    float x[BATCH], y[BATCH], z[BATCH];
+    BezierWeights curve = weights();
+    for (size_t first = 0; first < count; first += BATCH) {
+        size_t n = std::min(BATCH, count - first);
+        EvaluateBezierBatch(curve, ts + first, x, y, z, n);
+        for (size_t i = 0; i < n; ++i) {
+            out[first + i] = glm::vec3(x[i], y[i], z[i]);
+        }
+    }
+}
+
+void BezierCurve::evaluate(const float* ts, float* x, float* y, float* z, size_t count) const {
+    EvaluateBezierBatch(weights(), ts, x, y, z, count);
+}
+
+void BezierCurve::tessellate(int count, std::vector<glm::vec3>& out) const {
+    out.resize((size_t) count + 1);
+    float ts[BATCH];
+    for (size_t first = 0; first < out.size(); first += BATCH) {
+        size_t n = std::min(BATCH, out.size() - first);
+        for (size_t i = 0; i < n; ++i) {
+            ts[i] = (float) (first + i) / (float) count;
+        }
+        evaluate(ts, &out[first], n);
+    }
+}
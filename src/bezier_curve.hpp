@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "curve_kernels.hpp"
+
+// A single Bezier curve of any degree.
+//
+// setControlPoints() premultiplies every point by its binomial coefficient (the coefficients are only recomputed when
+// the degree changes). Evaluation then runs Horner's rule on the Bernstein form: with s = t / (1 - t) the curve is
+// (1 - t)^n * sum(C(n, i) P_i s^i), and for t > 0.5 the mirrored form in (1 - t) / t keeps s <= 1. That's n + 1
+// multiply-adds per point and no transcendental calls.
+class BezierCurve {
+public:
+    BezierCurve() = default;
+    explicit BezierCurve(const std::vector<glm::vec3>& points) { setControlPoints(points.data(), points.size()); }
+
+    void setControlPoints(const glm::vec3* points, size_t count);
+    void setControlPoints(const std::vector<glm::vec3>& points) { setControlPoints(points.data(), points.size()); }
+
+    glm::vec3 evaluate(float t) const;
+    // out[i] = evaluate(ts[i]) for i < count, same results but several points at a time, see EvaluateBezierBatch()
+    void evaluate(const float* ts, glm::vec3* out, size_t count) const;
+    // The same into one array per component, for followers stored as structure of arrays
+    void evaluate(const float* ts, float* x, float* y, float* z, size_t count) const;
+    // count + 1 points at t = 0, 1 / count, ..., 1, resizing out. Keeps out's storage when the size doesn't change.
+    void tessellate(int count, std::vector<glm::vec3>& out) const;
+
+    size_t size() const { return weighted.size(); }
+    size_t degree() const { return weighted.empty() ? 0 : weighted.size() - 1; }
+
+private:
+    std::vector<float> binomials;
+    std::vector<glm::vec3> weighted;    // C(n, i) * P_i
+    std::vector<float> weightedX, weightedY, weightedZ;     // the same per component for the SIMD kernels
+
+    BezierWeights weights() const;
+};
@@ -0,0 +1,258 @@
+#include "curve_bvh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Squared distance from p to the box, 0 inside
+static float boxDistanceSquared(const glm::vec3& p, const glm::vec3& minimum, const glm::vec3& maximum) {
+    glm::vec3 d = glm::max(glm::max(minimum - p, p - maximum), glm::vec3(0.0f));
+    return glm::dot(d, d);
+}
+
+void CurveBvh::build(const glm::vec3* points, size_t segmentCount, int degree, const glm::vec3& scale, int depth) {
+    nodes.clear();
+    pieces.clear();
+    piecePoints.clear();
+    if (degree < 0 || degree > MAX_DEGREE) {
+        std::cout << "[ERROR][CurveBvh] Curves of degree " << degree << " aren't supported, at most " << MAX_DEGREE
+                  << std::endl;
+        return;
+    }
+    if (segmentCount == 0) {
+        return;
+    }
+    pieceDegree = degree;
+    depth = std::max(depth, 0);
+
+    const size_t stride = (size_t) degree + 1;
+    const size_t piecesPerSegment = (size_t) 1 << depth;
+    pieces.reserve(segmentCount * piecesPerSegment);
+    piecePoints.reserve(segmentCount * piecesPerSegment * stride);
+    std::vector<glm::vec3> level(stride);
+
+    for (size_t s = 0; s < segmentCount; ++s) {
+        size_t firstPiece = pieces.size();
+        Piece whole = { (uint32_t) s, (uint32_t) piecePoints.size(), 0.0f, 1.0f };
+        pieces.push_back(whole);
+        for (size_t i = 0; i < stride; ++i) {
+            piecePoints.push_back(points[s * stride + i] * scale);
+        }
+
+        // Halve every piece of the segment depth times. The left half stays in place, the right one is appended, so
+        // the pieces of a segment end up out of parameter order, which the tree doesn't care about.
+        for (int d = 0; d < depth; ++d) {
+            size_t end = pieces.size();
+            for (size_t k = firstPiece; k < end; ++k) {
+                Piece right = pieces[k];
+                float middle = (right.t0 + right.t1) * 0.5f;
+                right.t0 = middle;
+                pieces[k].t1 = middle;
+                right.firstPoint = (uint32_t) piecePoints.size();
+                piecePoints.resize(piecePoints.size() + stride);
+
+                // de Casteljau at 0.5: the left half takes the first point of every level, the right one the last
+                glm::vec3* left = &piecePoints[pieces[k].firstPoint];
+                glm::vec3* rightPoints = &piecePoints[right.firstPoint];
+                std::copy(left, left + stride, level.begin());
+                for (size_t j = 0; j < stride; ++j) {
+                    left[j] = level[0];
+                    rightPoints[stride - 1 - j] = level[stride - 1 - j];
+                    for (size_t i = 0; i + 1 < stride - j; ++i) {
+                        level[i] = (level[i] + level[i + 1]) * 0.5f;
+                    }
+                }
+                pieces.push_back(right);
+            }
+        }
+    }
+
+    order.resize(pieces.size());
+    centres.resize(pieces.size());
+    for (size_t k = 0; k < pieces.size(); ++k) {
+        const glm::vec3* p = &piecePoints[pieces[k].firstPoint];
+        glm::vec3 minimum = p[0], maximum = p[0];
+        for (size_t i = 1; i < stride; ++i) {
+            minimum = glm::min(minimum, p[i]);
+            maximum = glm::max(maximum, p[i]);
+        }
+        centres[k] = (minimum + maximum) * 0.5f;
+        order[k] = (uint32_t) k;
+    }
+
+    nodes.reserve(2 * pieces.size() - 1);
+    nodes.resize(1);
+    buildNode(0, 0, (uint32_t) pieces.size());
+
+    // Leaves index the pieces in tree order, so the pieces of one subtree sit together in memory
+    std::vector<Piece> sorted(pieces.size());
+    for (size_t k = 0; k < pieces.size(); ++k) {
+        sorted[k] = pieces[order[k]];
+    }
+    pieces.swap(sorted);
+}
+
+void CurveBvh::buildNode(uint32_t index, uint32_t first, uint32_t count) {
+    const size_t stride = (size_t) pieceDegree + 1;
+    glm::vec3 minimum(std::numeric_limits<float>::max());
+    glm::vec3 maximum(-std::numeric_limits<float>::max());
+    glm::vec3 centreMinimum = minimum, centreMaximum = maximum;
+    for (uint32_t k = first; k < first + count; ++k) {
+        const glm::vec3* p = &piecePoints[pieces[order[k]].firstPoint];
+        for (size_t i = 0; i < stride; ++i) {
+            minimum = glm::min(minimum, p[i]);
+            maximum = glm::max(maximum, p[i]);
+        }
+        centreMinimum = glm::min(centreMinimum, centres[order[k]]);
+        centreMaximum = glm::max(centreMaximum, centres[order[k]]);
+    }
+    nodes[index].minimum = minimum;
+    nodes[index].maximum = maximum;
+
+    if (count == 1) {
+        nodes[index].first = first;
+        nodes[index].count = 1;
+        return;
+    }
+
+    glm::vec3 extent = centreMaximum - centreMinimum;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    uint32_t middle = first + count / 2;
+
+    std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + first + count,
+                     [&](uint32_t a, uint32_t b) { return centres[a][axis] < centres[b][axis]; });
+
+    uint32_t left = (uint32_t) nodes.size();
+    nodes.resize(nodes.size() + 2);
+    nodes[index].first = left;
+    nodes[index].count = 0;
+    buildNode(left, first, middle - first);
+    buildNode(left + 1, middle, first + count - middle);
+}
+
+CurveHit CurveBvh::nearest(const glm::vec3& point, float maxDistance) const {
+    CurveHit best;
+    // Squared until the end
+    best.distance = maxDistance < std::sqrt(std::numeric_limits<float>::max())
+        ? maxDistance * maxDistance : std::numeric_limits<float>::max();
+    if (nodes.empty()) {
+        return best;
+    }
+
+    struct Entry {
+        uint32_t node;
+        float distance;
+    };
+    // Closer child on top. The tree is balanced, so the stack holds at most one entry more than it has levels.
+    Entry stack[64];
+    int top = 0;
+    stack[top++] = { 0, boxDistanceSquared(point, nodes[0].minimum, nodes[0].maximum) };
+
+    while (top > 0) {
+        Entry entry = stack[--top];
+        if (entry.distance >= best.distance) {
+            continue;
+        }
+        const Node& node = nodes[entry.node];
+        if (node.count > 0) {
+            for (uint32_t k = node.first; k < node.first + node.count; ++k) {
+                nearestOnPiece(pieces[k], point, best);
+            }
+            continue;
+        }
+
+        Entry left = { node.first, boxDistanceSquared(point, nodes[node.first].minimum, nodes[node.first].maximum) };
+        Entry right = { node.first + 1,
+                        boxDistanceSquared(point, nodes[node.first + 1].minimum, nodes[node.first + 1].maximum) };
+        if (left.distance > right.distance) {
+            std::swap(left, right);
+        }
+        if (right.distance < best.distance) {
+            stack[top++] = right;
+        }
+        if (left.distance < best.distance) {
+            stack[top++] = left;
+        }
+    }
+
+    if (best.found) {
+        best.distance = std::sqrt(best.distance);
+    } else {
+        best.distance = maxDistance;
+    }
+    return best;
+}
+
+void CurveBvh::nearestOnPiece(const Piece& piece, const glm::vec3& point, CurveHit& best) const {
+    const glm::vec3* p = &piecePoints[piece.firstPoint];
+    const int n = pieceDegree;
+
+    // Point, first and second derivative at t, de Casteljau down to the last three levels
+    glm::vec3 position, first, second;
+    auto evaluate = [&](float t) {
+        glm::vec3 level[MAX_DEGREE + 1];
+        std::copy(p, p + n + 1, level);
+        for (int k = n; k > 2; --k) {
+            for (int i = 0; i < k; ++i) {
+                level[i] = glm::mix(level[i], level[i + 1], t);
+            }
+        }
+        if (n < 2) {
+            second = glm::vec3(0.0f);
+            first = n == 1 ? level[1] - level[0] : glm::vec3(0.0f);
+            position = n == 1 ? glm::mix(level[0], level[1], t) : level[0];
+            return;
+        }
+        second = (float) (n * (n - 1)) * (level[0] - 2.0f * level[1] + level[2]);
+        glm::vec3 a = glm::mix(level[0], level[1], t);
+        glm::vec3 b = glm::mix(level[1], level[2], t);
+        first = (float) n * (b - a);
+        position = glm::mix(a, b, t);
+    };
+    auto consider = [&](const glm::vec3& candidate, float t) {
+        glm::vec3 d = candidate - point;
+        float distance = glm::dot(d, d);
+        if (distance < best.distance) {
+            best.found = true;
+            best.segment = piece.segment;
+            best.t = piece.t0 + (piece.t1 - piece.t0) * t;
+            best.point = candidate;
+            best.distance = distance;
+        }
+    };
+
+    // The minimum may sit at an end, where the derivative of the distance needn't vanish
+    consider(p[0], 0.0f);
+    consider(p[n], 1.0f);
+
+    // Newton finds the minimum of the basin it starts in, so start at the closest of a few samples. (B(t) - p) . B'(t)
+    // has degree 2n - 1, so the distance can have more minima the higher the degree and needs more samples to find
+    // the right basin.
+    const int seeds = SEED_SAMPLES + 2 * n;
+    float t = 0.5f;
+    float seedDistance = std::numeric_limits<float>::max();
+    for (int i = 1; i < seeds; ++i) {
+        float sample = (float) i / (float) seeds;
+        evaluate(sample);
+        glm::vec3 d = position - point;
+        if (glm::dot(d, d) < seedDistance) {
+            seedDistance = glm::dot(d, d);
+            t = sample;
+        }
+    }
+    for (int i = 0; i < NEWTON_ITERATIONS; ++i) {
+        evaluate(t);
+        glm::vec3 d = position - point;
+        float slope = glm::dot(first, first) + glm::dot(d, second);
+        if (slope <= 0.0f) {
+            break;
+        }
+        float next = std::max(0.0f, std::min(t - glm::dot(d, first) / slope, 1.0f));
+        bool converged = std::fabs(next - t) < 1e-5f;
+        t = next;
+        if (converged) {
+            break;
+        }
+    }
+    evaluate(t);
+    consider(position, t);
+}
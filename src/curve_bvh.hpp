@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct CurveHit {
+    bool found = false;
+    uint32_t segment = 0;
+    float t = 0.0f;             // parameter within the segment
+    glm::vec3 point = glm::vec3(0.0f);
+    float distance = std::numeric_limits<float>::max();
+};
+
+// Bounding volume hierarchy over the segments of a Bezier path, for nearest point queries (hover, picking, snapping).
+//
+// build() splits every segment with de Casteljau into 2^depth pieces. By the convex hull property the box around a
+// piece's control points holds the piece, and the boxes of pieces hug the curve much tighter than one of the whole
+// segment. The pieces are the leaves of a binary tree built by median splits along the longest axis.
+//
+// nearest() walks the tree closer child first and skips every box that's further away than the best point found so
+// far, so a query usually reaches only the one or two pieces next to the answer. On a piece the parameter starts at the
+// closest of a few samples and a few Newton steps on (B(t) - p) . B'(t) = 0 finish it. As in AdaptiveTessellator
+// everything is measured after multiplying by scale, e.g. in pixels for a curve drawn in [0, 1] coordinates.
+class CurveBvh {
+public:
+    static const int MAX_DEGREE = 7;
+    static const int SEED_SAMPLES = 4;     // per piece, the ends included, plus two per degree
+    static const int NEWTON_ITERATIONS = 4;
+
+    // segmentCount segments of degree + 1 points each, one after the other as in PiecewisePath::bezierPoints()
+    void build(const glm::vec3* points, size_t segmentCount, int degree, const glm::vec3& scale, int depth = 2);
+
+    // Closest point no further than maxDistance, in scaled units. hit.found is false if there's none.
+    CurveHit nearest(const glm::vec3& point, float maxDistance = std::numeric_limits<float>::max()) const;
+
+    size_t pieceCount() const { return pieces.size(); }
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+    struct Node {
+        glm::vec3 minimum;
+        uint32_t first;         // leaf: first piece, otherwise the left child (the right one is first + 1)
+        glm::vec3 maximum;
+        uint32_t count;         // pieces of a leaf, 0 for inner nodes
+    };
+
+    struct Piece {
+        uint32_t segment;
+        uint32_t firstPoint;    // into piecePoints
+        float t0, t1;           // the part of the segment it covers
+    };
+
+    int pieceDegree = 0;
+    std::vector<Node> nodes;
+    std::vector<Piece> pieces;
+    std::vector<glm::vec3> piecePoints;
+    // Build only: pieces in tree order and the centres of their boxes
+    std::vector<uint32_t> order;
+    std::vector<glm::vec3> centres;
+
+    void buildNode(uint32_t index, uint32_t first, uint32_t count);
+    void nearestOnPiece(const Piece& piece, const glm::vec3& point, CurveHit& best) const;
+};
@@ -0,0 +1,54 @@
+#include "curve_cache.hpp"
+
+bool CachedCurve::sync(const glm::vec3* source, size_t count, uint32_t sourceVersion) {
+    if (sourceVersion == seenSourceVersion) {
+        return false;
+    }
+    bezier.setControlPoints(source, count);
+    controlPoints.assign(source, source + count);
+    seenSourceVersion = sourceVersion;
+    tessellationDirty = true;
+    arcLengthsDirty = true;
+    cacheVersion++;
+    return true;
+}
+
+const std::vector<glm::vec3>& CachedCurve::tessellation(int segments) {
+    if (tessellationDirty || segments != tessellatedSegments) {
+        bezier.tessellate(segments, points);
+        evaluatedPoints += (uint64_t) segments + 1;
+        tessellatedSegments = segments;
+        adaptiveDepth = -1;
+        tessellationDirty = false;
+        cacheVersion++;
+    }
+    return points;
+}
+
+const std::vector<glm::vec3>& CachedCurve::adaptiveTessellation(const glm::vec3& scale, float tolerance,
+                                                                int maxSegments) {
+    int depth = 0;
+    while (depth < 30 && (2 << depth) <= maxSegments) {
+        depth++;
+    }
+    if (tessellationDirty || depth != adaptiveDepth || scale != adaptiveScale || tolerance != adaptiveTolerance) {
+        tessellator.maxDepth = depth;
+        tessellator.tessellate(controlPoints.data(), controlPoints.size(), scale, tolerance, points);
+        evaluatedPoints += points.size();
+        adaptiveDepth = depth;
+        adaptiveScale = scale;
+        adaptiveTolerance = tolerance;
+        tessellatedSegments = -1;
+        tessellationDirty = false;
+        cacheVersion++;
+    }
+    return points;
+}
+
+const ArcLengthTable& CachedCurve::arcLength() {
+    if (arcLengthsDirty) {
+        arcLengths.build(controlPoints.data(), controlPoints.size());
+        arcLengthsDirty = false;
+    }
+    return arcLengths;
+}
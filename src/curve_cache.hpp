@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "adaptive_tessellation.hpp"
+#include "arc_length.hpp"
+#include "bezier_curve.hpp"
+
+// A BezierCurve and its tessellation, rebuilt only when the control points or the tessellation parameters changed.
+//
+// The source of the control points keeps a version that every edit bumps, sync() compares it against the one the
+// cache was built from, so an unchanged curve costs one integer compare per frame: no evaluation, no allocation.
+// version() changes whenever the cached data does, consumers (overlay drawing, GPU uploads) compare against it the
+// same way.
+class CachedCurve {
+public:
+    // Rebuilds the curve if sourceVersion differs from the last sync. Returns true if it did.
+    bool sync(const glm::vec3* points, size_t count, uint32_t sourceVersion);
+    bool sync(const std::vector<glm::vec3>& points, uint32_t sourceVersion) {
+        return sync(points.data(), points.size(), sourceVersion);
+    }
+
+    // count + 1 points from t = 0 to 1, re-evaluated only after a change. The storage is reused.
+    const std::vector<glm::vec3>& tessellation(int segments);
+    // As few points as keep the polyline within tolerance of the curve once scaled, see AdaptiveTessellator. At most
+    // maxSegments segments (rounded down to a power of two), in place of the uniform tessellation.
+    const std::vector<glm::vec3>& adaptiveTessellation(const glm::vec3& scale, float tolerance, int maxSegments);
+
+    // Rebuilt on first use after a change, shared by everything that follows this curve
+    const ArcLengthTable& arcLength();
+
+    const BezierCurve& curve() const { return bezier; }
+    size_t tessellationSize() const { return points.size(); }
+    uint32_t version() const { return cacheVersion; }
+    // Points evaluated for tessellations so far, to check that idle frames add none
+    uint64_t evaluations() const { return evaluatedPoints; }
+
+private:
+    BezierCurve bezier;
+    std::vector<glm::vec3> controlPoints;
+    AdaptiveTessellator tessellator;
+    ArcLengthTable arcLengths;
+    bool arcLengthsDirty = true;
+    std::vector<glm::vec3> points;
+    uint32_t seenSourceVersion = 0;     // sources start at 1, so the first sync always builds
+    int tessellatedSegments = -1;       // -1 while points holds an adaptive tessellation
+    int adaptiveDepth = -1;             // -1 while points holds a uniform one
+    glm::vec3 adaptiveScale = glm::vec3(0.0f);
+    float adaptiveTolerance = 0.0f;
+    bool tessellationDirty = true;
+    uint32_t cacheVersion = 0;
+    uint64_t evaluatedPoints = 0;
+};
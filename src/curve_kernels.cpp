@@ -0,0 +1,518 @@
+#include "curve_kernels.hpp"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CURVE_USE_SSE 1
+#include <emmintrin.h>
+// The AVX2 versions are compiled for that target alone and only called after CPUID said so, which needs the GCC/Clang
+// target attribute
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CURVE_USE_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define CURVE_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Eberly, "A Fast and Accurate Algorithm for Computing SLERP": sin(t a) / sin(a) as a polynomial in cos(a) - 1,
+// evaluated with Horner from the last term. The last coefficient pair is scaled by mu to make up for the truncation.
+static const int SLERP_TERMS = 12;
+static const double SLERP_MU = 1.8937;
+
+struct SlerpCoefficients {
+    float u[SLERP_TERMS];
+    float v[SLERP_TERMS];
+
+    SlerpCoefficients() {
+        for (int i = 1; i <= SLERP_TERMS; ++i) {
+            double scale = i == SLERP_TERMS ? SLERP_MU : 1.0;
+            u[i - 1] = (float) (scale / (i * (2.0 * i + 1.0)));
+            v[i - 1] = (float) (scale * i / (2.0 * i + 1.0));
+        }
+    }
+};
+
+static const SlerpCoefficients SLERP;
+
+/* ----------------------------------------------------
+                        Scalar
+-----------------------------------------------------*/
+
+static void bezierScalar(const BezierWeights& curve, const float* ts, float* x, float* y, float* z, size_t n) {
+    size_t last = curve.count - 1;
+    for (size_t i = 0; i < n; ++i) {
+        float t = ts[i];
+        float u = 1.0f - t;
+        bool low = t <= 0.5f;
+        // Same order of operations as BezierCurve::evaluate(), the low form runs Horner from the last point down
+        float s = low ? t / u : u / t;
+        float big = low ? u : t;
+        size_t first = low ? last : 0;
+        float sx = curve.x[first], sy = curve.y[first], sz = curve.z[first];
+        float scale = 1.0f;
+        for (size_t k = 1; k <= last; ++k) {
+            size_t j = low ? last - k : k;
+            sx = sx * s + curve.x[j];
+            sy = sy * s + curve.y[j];
+            sz = sz * s + curve.z[j];
+            scale *= big;
+        }
+        x[i] = sx * scale;
+        y[i] = sy * scale;
+        z[i] = sz * scale;
+    }
+}
+
+// Loads quaternion i of a and b, with b flipped to the hemisphere of a. Returns the (non-negative) dot product.
+static float loadPair(const QuatStreams& a, const QuatStreams& b, size_t i, float qa[4], float qb[4]) {
+    qa[0] = a.x[i]; qa[1] = a.y[i]; qa[2] = a.z[i]; qa[3] = a.w[i];
+    qb[0] = b.x[i]; qb[1] = b.y[i]; qb[2] = b.z[i]; qb[3] = b.w[i];
+    float dot = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3];
+    if (dot < 0.0f) {
+        for (int c = 0; c < 4; ++c) {
+            qb[c] = -qb[c];
+        }
+        dot = -dot;
+    }
+    return dot;
+}
+
+static void store(const QuatStreams& out, size_t i, const float q[4]) {
+    out.x[i] = q[0];
+    out.y[i] = q[1];
+    out.z[i] = q[2];
+    out.w[i] = q[3];
+}
+
+static void nlerpScalar(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        float qa[4], qb[4], q[4];
+        loadPair(a, b, i, qa, qb);
+        float lengthSq = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            q[c] = qa[c] + (qb[c] - qa[c]) * t[i];
+            lengthSq += q[c] * q[c];
+        }
+        float inverse = lengthSq > 0.0f ? 1.0f / std::sqrt(lengthSq) : 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            q[c] *= inverse;
+        }
+        store(out, i, q);
+    }
+}
+
+static void slerpScalar(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        float qa[4], qb[4], q[4];
+        float xm1 = loadPair(a, b, i, qa, qb) - 1.0f;
+        float d = 1.0f - t[i];
+        float tt = t[i] * t[i], dd = d * d;
+        float fT = 1.0f, fD = 1.0f;
+        for (int k = SLERP_TERMS - 1; k >= 0; --k) {
+            fT = 1.0f + (SLERP.u[k] * tt - SLERP.v[k]) * xm1 * fT;
+            fD = 1.0f + (SLERP.u[k] * dd - SLERP.v[k]) * xm1 * fD;
+        }
+        float cT = t[i] * fT, cD = d * fD;
+        for (int c = 0; c < 4; ++c) {
+            q[c] = cD * qa[c] + cT * qb[c];
+        }
+        store(out, i, q);
+    }
+}
+
+/* ----------------------------------------------------
+                        SSE
+-----------------------------------------------------*/
+
+#ifdef CURVE_USE_SSE
+static inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void bezierSse(const BezierWeights& curve, const float* ts, float* x, float* y, float* z, size_t n) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    size_t last = curve.count - 1;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 t = _mm_loadu_ps(ts + i);
+        __m128 u = _mm_sub_ps(one, t);
+        __m128 low = _mm_cmple_ps(t, half);
+        __m128 s = _mm_div_ps(select(low, t, u), select(low, u, t));
+        __m128 big = select(low, u, t);
+        __m128 sx = select(low, _mm_set1_ps(curve.x[last]), _mm_set1_ps(curve.x[0]));
+        __m128 sy = select(low, _mm_set1_ps(curve.y[last]), _mm_set1_ps(curve.y[0]));
+        __m128 sz = select(low, _mm_set1_ps(curve.z[last]), _mm_set1_ps(curve.z[0]));
+        __m128 scale = one;
+        for (size_t k = 1; k <= last; ++k) {
+            sx = _mm_add_ps(_mm_mul_ps(sx, s), select(low, _mm_set1_ps(curve.x[last - k]), _mm_set1_ps(curve.x[k])));
+            sy = _mm_add_ps(_mm_mul_ps(sy, s), select(low, _mm_set1_ps(curve.y[last - k]), _mm_set1_ps(curve.y[k])));
+            sz = _mm_add_ps(_mm_mul_ps(sz, s), select(low, _mm_set1_ps(curve.z[last - k]), _mm_set1_ps(curve.z[k])));
+            scale = _mm_mul_ps(scale, big);
+        }
+        _mm_storeu_ps(x + i, _mm_mul_ps(sx, scale));
+        _mm_storeu_ps(y + i, _mm_mul_ps(sy, scale));
+        _mm_storeu_ps(z + i, _mm_mul_ps(sz, scale));
+    }
+    bezierScalar(curve, ts + i, x + i, y + i, z + i, n - i);
+}
+
+// Loads 4 quaternions of a and b, flips b to the hemisphere of a and returns |dot|
+static inline __m128 loadPairs(const QuatStreams& a, const QuatStreams& b, size_t i, __m128 qa[4], __m128 qb[4]) {
+    qa[0] = _mm_loadu_ps(a.x + i); qa[1] = _mm_loadu_ps(a.y + i);
+    qa[2] = _mm_loadu_ps(a.z + i); qa[3] = _mm_loadu_ps(a.w + i);
+    qb[0] = _mm_loadu_ps(b.x + i); qb[1] = _mm_loadu_ps(b.y + i);
+    qb[2] = _mm_loadu_ps(b.z + i); qb[3] = _mm_loadu_ps(b.w + i);
+    __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qa[0], qb[0]), _mm_mul_ps(qa[1], qb[1])),
+                            _mm_add_ps(_mm_mul_ps(qa[2], qb[2]), _mm_mul_ps(qa[3], qb[3])));
+    __m128 sign = _mm_and_ps(dot, _mm_set1_ps(-0.0f));
+    for (int c = 0; c < 4; ++c) {
+        qb[c] = _mm_xor_ps(qb[c], sign);
+    }
+    return _mm_xor_ps(dot, sign);
+}
+
+static inline void storePairs(const QuatStreams& out, size_t i, const __m128 q[4]) {
+    _mm_storeu_ps(out.x + i, q[0]);
+    _mm_storeu_ps(out.y + i, q[1]);
+    _mm_storeu_ps(out.z + i, q[2]);
+    _mm_storeu_ps(out.w + i, q[3]);
+}
+
+static void nlerpSse(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 qa[4], qb[4], q[4];
+        loadPairs(a, b, i, qa, qb);
+        __m128 tv = _mm_loadu_ps(t + i);
+        __m128 lengthSq = _mm_setzero_ps();
+        for (int c = 0; c < 4; ++c) {
+            q[c] = _mm_add_ps(qa[c], _mm_mul_ps(_mm_sub_ps(qb[c], qa[c]), tv));
+            lengthSq = _mm_add_ps(lengthSq, _mm_mul_ps(q[c], q[c]));
+        }
+        __m128 valid = _mm_cmpgt_ps(lengthSq, _mm_setzero_ps());
+        __m128 inverse = _mm_and_ps(_mm_div_ps(one, _mm_sqrt_ps(lengthSq)), valid);
+        for (int c = 0; c < 4; ++c) {
+            q[c] = _mm_mul_ps(q[c], inverse);
+        }
+        storePairs(out, i, q);
+    }
+    QuatStreams ta = { a.x + i, a.y + i, a.z + i, a.w + i };
+    QuatStreams tb = { b.x + i, b.y + i, b.z + i, b.w + i };
+    QuatStreams to = { out.x + i, out.y + i, out.z + i, out.w + i };
+    nlerpScalar(ta, tb, t + i, to, n - i);
+}
+
+static void slerpSse(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 qa[4], qb[4], q[4];
+        __m128 xm1 = _mm_sub_ps(loadPairs(a, b, i, qa, qb), one);
+        __m128 tv = _mm_loadu_ps(t + i);
+        __m128 d = _mm_sub_ps(one, tv);
+        __m128 tt = _mm_mul_ps(tv, tv), dd = _mm_mul_ps(d, d);
+        __m128 fT = one, fD = one;
+        for (int k = SLERP_TERMS - 1; k >= 0; --k) {
+            __m128 u = _mm_set1_ps(SLERP.u[k]), v = _mm_set1_ps(SLERP.v[k]);
+            fT = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, tt), v), xm1), fT));
+            fD = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, dd), v), xm1), fD));
+        }
+        __m128 cT = _mm_mul_ps(tv, fT), cD = _mm_mul_ps(d, fD);
+        for (int c = 0; c < 4; ++c) {
+            q[c] = _mm_add_ps(_mm_mul_ps(cD, qa[c]), _mm_mul_ps(cT, qb[c]));
+        }
+        storePairs(out, i, q);
+    }
+    QuatStreams ta = { a.x + i, a.y + i, a.z + i, a.w + i };
+    QuatStreams tb = { b.x + i, b.y + i, b.z + i, b.w + i };
+    QuatStreams to = { out.x + i, out.y + i, out.z + i, out.w + i };
+    slerpScalar(ta, tb, t + i, to, n - i);
+}
+#endif
+
+/* ----------------------------------------------------
+                        AVX2
+-----------------------------------------------------*/
+
+#ifdef CURVE_USE_AVX2
+#define CURVE_AVX2 __attribute__((target("avx2")))
+
+CURVE_AVX2 static inline __m256 select8(__m256 mask, __m256 a, __m256 b) {
+    return _mm256_blendv_ps(b, a, mask);
+}
+
+CURVE_AVX2 static void bezierAvx2(const BezierWeights& curve, const float* ts, float* x, float* y, float* z,
+                                  size_t n) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    size_t last = curve.count - 1;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 t = _mm256_loadu_ps(ts + i);
+        __m256 u = _mm256_sub_ps(one, t);
+        __m256 low = _mm256_cmp_ps(t, half, _CMP_LE_OQ);
+        __m256 s = _mm256_div_ps(select8(low, t, u), select8(low, u, t));
+        __m256 big = select8(low, u, t);
+        __m256 sx = select8(low, _mm256_set1_ps(curve.x[last]), _mm256_set1_ps(curve.x[0]));
+        __m256 sy = select8(low, _mm256_set1_ps(curve.y[last]), _mm256_set1_ps(curve.y[0]));
+        __m256 sz = select8(low, _mm256_set1_ps(curve.z[last]), _mm256_set1_ps(curve.z[0]));
+        __m256 scale = one;
+        for (size_t k = 1; k <= last; ++k) {
+            sx = _mm256_add_ps(_mm256_mul_ps(sx, s),
+                               select8(low, _mm256_set1_ps(curve.x[last - k]), _mm256_set1_ps(curve.x[k])));
+            sy = _mm256_add_ps(_mm256_mul_ps(sy, s),
+                               select8(low, _mm256_set1_ps(curve.y[last - k]), _mm256_set1_ps(curve.y[k])));
+            sz = _mm256_add_ps(_mm256_mul_ps(sz, s),
+                               select8(low, _mm256_set1_ps(curve.z[last - k]), _mm256_set1_ps(curve.z[k])));
+            scale = _mm256_mul_ps(scale, big);
+        }
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(sx, scale));
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(sy, scale));
+        _mm256_storeu_ps(z + i, _mm256_mul_ps(sz, scale));
+    }
+    bezierSse(curve, ts + i, x + i, y + i, z + i, n - i);
+}
+
+CURVE_AVX2 static inline __m256 loadPairs8(const QuatStreams& a, const QuatStreams& b, size_t i, __m256 qa[4],
+                                           __m256 qb[4]) {
+    qa[0] = _mm256_loadu_ps(a.x + i); qa[1] = _mm256_loadu_ps(a.y + i);
+    qa[2] = _mm256_loadu_ps(a.z + i); qa[3] = _mm256_loadu_ps(a.w + i);
+    qb[0] = _mm256_loadu_ps(b.x + i); qb[1] = _mm256_loadu_ps(b.y + i);
+    qb[2] = _mm256_loadu_ps(b.z + i); qb[3] = _mm256_loadu_ps(b.w + i);
+    __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(qa[0], qb[0]), _mm256_mul_ps(qa[1], qb[1])),
+                               _mm256_add_ps(_mm256_mul_ps(qa[2], qb[2]), _mm256_mul_ps(qa[3], qb[3])));
+    __m256 sign = _mm256_and_ps(dot, _mm256_set1_ps(-0.0f));
+    for (int c = 0; c < 4; ++c) {
+        qb[c] = _mm256_xor_ps(qb[c], sign);
+    }
+    return _mm256_xor_ps(dot, sign);
+}
+
+CURVE_AVX2 static inline void storePairs8(const QuatStreams& out, size_t i, const __m256 q[4]) {
+    _mm256_storeu_ps(out.x + i, q[0]);
+    _mm256_storeu_ps(out.y + i, q[1]);
+    _mm256_storeu_ps(out.z + i, q[2]);
+    _mm256_storeu_ps(out.w + i, q[3]);
+}
+
+CURVE_AVX2 static void nlerpAvx2(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out,
+                                 size_t n) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 qa[4], qb[4], q[4];
+        loadPairs8(a, b, i, qa, qb);
+        __m256 tv = _mm256_loadu_ps(t + i);
+        __m256 lengthSq = _mm256_setzero_ps();
+        for (int c = 0; c < 4; ++c) {
+            q[c] = _mm256_add_ps(qa[c], _mm256_mul_ps(_mm256_sub_ps(qb[c], qa[c]), tv));
+            lengthSq = _mm256_add_ps(lengthSq, _mm256_mul_ps(q[c], q[c]));
+        }
+        __m256 valid = _mm256_cmp_ps(lengthSq, _mm256_setzero_ps(), _CMP_GT_OQ);
+        __m256 inverse = _mm256_and_ps(_mm256_div_ps(one, _mm256_sqrt_ps(lengthSq)), valid);
+        for (int c = 0; c < 4; ++c) {
+            q[c] = _mm256_mul_ps(q[c], inverse);
+        }
+        storePairs8(out, i, q);
+    }
+    QuatStreams ta = { a.x + i, a.y + i, a.z + i, a.w + i };
+    QuatStreams tb = { b.x + i, b.y + i, b.z + i, b.w + i };
+    QuatStreams to = { out.x + i, out.y + i, out.z + i, out.w + i };
+    nlerpSse(ta, tb, t + i, to, n - i);
+}
+
+CURVE_AVX2 static void slerpAvx2(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out,
+                                 size_t n) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 qa[4], qb[4], q[4];
+        __m256 xm1 = _mm256_sub_ps(loadPairs8(a, b, i, qa, qb), one);
+        __m256 tv = _mm256_loadu_ps(t + i);
+        __m256 d = _mm256_sub_ps(one, tv);
+        __m256 tt = _mm256_mul_ps(tv, tv), dd = _mm256_mul_ps(d, d);
+        __m256 fT = one, fD = one;
+        for (int k = SLERP_TERMS - 1; k >= 0; --k) {
+            __m256 u = _mm256_set1_ps(SLERP.u[k]), v = _mm256_set1_ps(SLERP.v[k]);
+            fT = _mm256_add_ps(one, _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(u, tt), v), xm1), fT));
+            fD = _mm256_add_ps(one, _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(u, dd), v), xm1), fD));
+        }
+        __m256 cT = _mm256_mul_ps(tv, fT), cD = _mm256_mul_ps(d, fD);
+        for (int c = 0; c < 4; ++c) {
+            q[c] = _mm256_add_ps(_mm256_mul_ps(cD, qa[c]), _mm256_mul_ps(cT, qb[c]));
+        }
+        storePairs8(out, i, q);
+    }
+    QuatStreams ta = { a.x + i, a.y + i, a.z + i, a.w + i };
+    QuatStreams tb = { b.x + i, b.y + i, b.z + i, b.w + i };
+    QuatStreams to = { out.x + i, out.y + i, out.z + i, out.w + i };
+    slerpSse(ta, tb, t + i, to, n - i);
+}
+#endif
+
+/* ----------------------------------------------------
+                        NEON
+-----------------------------------------------------*/
+
+#ifdef CURVE_USE_NEON
+static void bezierNeon(const BezierWeights& curve, const float* ts, float* x, float* y, float* z, size_t n) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    size_t last = curve.count - 1;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t t = vld1q_f32(ts + i);
+        float32x4_t u = vsubq_f32(one, t);
+        uint32x4_t low = vcleq_f32(t, half);
+        float32x4_t s = vdivq_f32(vbslq_f32(low, t, u), vbslq_f32(low, u, t));
+        float32x4_t big = vbslq_f32(low, u, t);
+        float32x4_t sx = vbslq_f32(low, vdupq_n_f32(curve.x[last]), vdupq_n_f32(curve.x[0]));
+        float32x4_t sy = vbslq_f32(low, vdupq_n_f32(curve.y[last]), vdupq_n_f32(curve.y[0]));
+        float32x4_t sz = vbslq_f32(low, vdupq_n_f32(curve.z[last]), vdupq_n_f32(curve.z[0]));
+        float32x4_t scale = one;
+        // Separate multiply and add, vmlaq_f32 may fuse on AArch64
+        for (size_t k = 1; k <= last; ++k) {
+            sx = vaddq_f32(vmulq_f32(sx, s), vbslq_f32(low, vdupq_n_f32(curve.x[last - k]), vdupq_n_f32(curve.x[k])));
+            sy = vaddq_f32(vmulq_f32(sy, s), vbslq_f32(low, vdupq_n_f32(curve.y[last - k]), vdupq_n_f32(curve.y[k])));
+            sz = vaddq_f32(vmulq_f32(sz, s), vbslq_f32(low, vdupq_n_f32(curve.z[last - k]), vdupq_n_f32(curve.z[k])));
+            scale = vmulq_f32(scale, big);
+        }
+        vst1q_f32(x + i, vmulq_f32(sx, scale));
+        vst1q_f32(y + i, vmulq_f32(sy, scale));
+        vst1q_f32(z + i, vmulq_f32(sz, scale));
+    }
+    bezierScalar(curve, ts + i, x + i, y + i, z + i, n - i);
+}
+
+static inline float32x4_t loadPairsNeon(const QuatStreams& a, const QuatStreams& b, size_t i, float32x4_t qa[4],
+                                        float32x4_t qb[4]) {
+    qa[0] = vld1q_f32(a.x + i); qa[1] = vld1q_f32(a.y + i);
+    qa[2] = vld1q_f32(a.z + i); qa[3] = vld1q_f32(a.w + i);
+    qb[0] = vld1q_f32(b.x + i); qb[1] = vld1q_f32(b.y + i);
+    qb[2] = vld1q_f32(b.z + i); qb[3] = vld1q_f32(b.w + i);
+    float32x4_t dot = vaddq_f32(vaddq_f32(vmulq_f32(qa[0], qb[0]), vmulq_f32(qa[1], qb[1])),
+                                vaddq_f32(vmulq_f32(qa[2], qb[2]), vmulq_f32(qa[3], qb[3])));
+    uint32x4_t negative = vcltq_f32(dot, vdupq_n_f32(0.0f));
+    for (int c = 0; c < 4; ++c) {
+        qb[c] = vbslq_f32(negative, vnegq_f32(qb[c]), qb[c]);
+    }
+    return vabsq_f32(dot);
+}
+
+static inline void storePairsNeon(const QuatStreams& out, size_t i, const float32x4_t q[4]) {
+    vst1q_f32(out.x + i, q[0]);
+    vst1q_f32(out.y + i, q[1]);
+    vst1q_f32(out.z + i, q[2]);
+    vst1q_f32(out.w + i, q[3]);
+}
+
+static void nlerpNeon(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t qa[4], qb[4], q[4];
+        loadPairsNeon(a, b, i, qa, qb);
+        float32x4_t tv = vld1q_f32(t + i);
+        float32x4_t lengthSq = zero;
+        for (int c = 0; c < 4; ++c) {
+            q[c] = vaddq_f32(qa[c], vmulq_f32(vsubq_f32(qb[c], qa[c]), tv));
+            lengthSq = vaddq_f32(lengthSq, vmulq_f32(q[c], q[c]));
+        }
+        uint32x4_t valid = vcgtq_f32(lengthSq, zero);
+        float32x4_t inverse = vbslq_f32(valid, vdivq_f32(one, vsqrtq_f32(lengthSq)), zero);
+        for (int c = 0; c < 4; ++c) {
+            q[c] = vmulq_f32(q[c], inverse);
+        }
+        storePairsNeon(out, i, q);
+    }
+    QuatStreams ta = { a.x + i, a.y + i, a.z + i, a.w + i };
+    QuatStreams tb = { b.x + i, b.y + i, b.z + i, b.w + i };
+    QuatStreams to = { out.x + i, out.y + i, out.z + i, out.w + i };
+    nlerpScalar(ta, tb, t + i, to, n - i);
+}
+
+static void slerpNeon(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t qa[4], qb[4], q[4];
+        float32x4_t xm1 = vsubq_f32(loadPairsNeon(a, b, i, qa, qb), one);
+        float32x4_t tv = vld1q_f32(t + i);
+        float32x4_t d = vsubq_f32(one, tv);
+        float32x4_t tt = vmulq_f32(tv, tv), dd = vmulq_f32(d, d);
+        float32x4_t fT = one, fD = one;
+        for (int k = SLERP_TERMS - 1; k >= 0; --k) {
+            float32x4_t u = vdupq_n_f32(SLERP.u[k]), v = vdupq_n_f32(SLERP.v[k]);
+            fT = vaddq_f32(one, vmulq_f32(vmulq_f32(vsubq_f32(vmulq_f32(u, tt), v), xm1), fT));
+            fD = vaddq_f32(one, vmulq_f32(vmulq_f32(vsubq_f32(vmulq_f32(u, dd), v), xm1), fD));
+        }
+        float32x4_t cT = vmulq_f32(tv, fT), cD = vmulq_f32(d, fD);
+        for (int c = 0; c < 4; ++c) {
+            q[c] = vaddq_f32(vmulq_f32(cD, qa[c]), vmulq_f32(cT, qb[c]));
+        }
+        storePairsNeon(out, i, q);
+    }
+    QuatStreams ta = { a.x + i, a.y + i, a.z + i, a.w + i };
+    QuatStreams tb = { b.x + i, b.y + i, b.z + i, b.w + i };
+    QuatStreams to = { out.x + i, out.y + i, out.z + i, out.w + i };
+    slerpScalar(ta, tb, t + i, to, n - i);
+}
+#endif
+
+/* ----------------------------------------------------
+                        Dispatch
+-----------------------------------------------------*/
+
+struct CurveKernels {
+    const char* name;
+    void (*bezier)(const BezierWeights&, const float*, float*, float*, float*, size_t);
+    void (*nlerp)(const QuatStreams&, const QuatStreams&, const float*, const QuatStreams&, size_t);
+    void (*slerp)(const QuatStreams&, const QuatStreams&, const float*, const QuatStreams&, size_t);
+};
+
+static CurveKernels selectKernels() {
+#ifdef CURVE_USE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return { "AVX2", bezierAvx2, nlerpAvx2, slerpAvx2 };
+    }
+#endif
+#if defined(CURVE_USE_SSE)
+    return { "SSE", bezierSse, nlerpSse, slerpSse };
+#elif defined(CURVE_USE_NEON)
+    return { "NEON", bezierNeon, nlerpNeon, slerpNeon };
+#else
+    return { "scalar", bezierScalar, nlerpScalar, slerpScalar };
+#endif
+}
+
+static const CurveKernels& kernels() {
+    static const CurveKernels selected = selectKernels();
+    return selected;
+}
+
+void EvaluateBezierBatch(const BezierWeights& curve, const float* ts, float* x, float* y, float* z, size_t n) {
+    if (curve.count == 0) {
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = y[i] = z[i] = 0.0f;
+        }
+        return;
+    }
+    kernels().bezier(curve, ts, x, y, z, n);
+}
+
+void NlerpBatch(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n) {
+    kernels().nlerp(a, b, t, out, n);
+}
+
+void SlerpBatch(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n) {
+    kernels().slerp(a, b, t, out, n);
+}
+
+const char* CurveKernelName() {
+    return kernels().name;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+// Control points of a Bezier curve premultiplied by their binomial coefficients, one array per component
+struct BezierWeights {
+    const float* x = nullptr;
+    const float* y = nullptr;
+    const float* z = nullptr;
+    size_t count = 0;
+};
+
+// Quaternions as one array per component. Inputs are only read.
+struct QuatStreams {
+    float* x = nullptr;
+    float* y = nullptr;
+    float* z = nullptr;
+    float* w = nullptr;
+};
+
+// Batched path evaluation for many followers at once.
+//
+// Each kernel exists as AVX2 (8 lanes), SSE (4 lanes), NEON (4 lanes, AArch64) and scalar code, the widest the CPU
+// supports is picked on first use with CPUID. The Bezier kernel runs the same Horner scheme as BezierCurve::evaluate()
+// in every lane, without FMA, so all versions give the scalar result bit for bit. That needs both files built without
+// contracting a * b + c into an FMA (-ffp-contract=off, see CMakeLists.txt), curve_tests checks it.
+
+// Evaluates the curve at ts[0 .. n) into x, y and z
+void EvaluateBezierBatch(const BezierWeights& curve, const float* ts, float* x, float* y, float* z, size_t n);
+
+// out[i] = normalize(lerp(a[i], b[i], t[i])), flipping b[i] to the hemisphere of a[i] first. out may alias a or b.
+void NlerpBatch(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n);
+// Spherical interpolation along the shorter arc, from a polynomial in the cosine of the angle instead of acos() and
+// sin(), within 2e-6 of glm::slerp(). out may alias a or b.
+void SlerpBatch(const QuatStreams& a, const QuatStreams& b, const float* t, const QuatStreams& out, size_t n);
+
+// "AVX2", "SSE", "NEON" or "scalar"
+const char* CurveKernelName();
@@ -0,0 +1,104 @@
+#include "curve_renderer.hpp"
+#include <algorithm>
+#include <iostream>
+
+constexpr uint32_t U_CURVE_POINTS = fnv1a("CurvePoints");
+constexpr uint32_t U_SEGMENT_COUNT = fnv1a("u_segmentCount");
+constexpr uint32_t U_DEGREE = fnv1a("u_degree");
+constexpr uint32_t U_LAST_VERTEX = fnv1a("u_lastVertex");
+constexpr uint32_t U_TESS_LEVEL = fnv1a("u_tessLevel");
+constexpr uint32_t U_VIEW_PROJ = fnv1a("u_viewProj");
+constexpr uint32_t U_START_COLOR = fnv1a("u_startColor");
+constexpr uint32_t U_END_COLOR = fnv1a("u_endColor");
+
+CurveRenderer::CurveRenderer(ShaderBuildService& builder)
+    : tessellationProgram(nullptr), ubo(0), vao(0), maxTessLevel(0), segments(0), requestedSegments(0),
+      curveDegree(0), uploadedVersion(0) {
+    program = builder.add({ "curve", "src/shaders/CurveVS.vert", "src/shaders/CurvePS.frag", "" });
+    if (GLEW_VERSION_4_0 || GLEW_ARB_tessellation_shader) {
+        tessellationProgram = builder.add({ "curve tessellated", "src/shaders/CurvePatchVS.vert",
+                                            "src/shaders/CurvePS.frag", "", "src/shaders/CurveTCS.tesc",
+                                            "src/shaders/CurveTES.tese" });
+        glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxTessLevel);
+    }
+
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, MAX_POINTS * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glGenVertexArrays(1, &vao);
+}
+
+void CurveRenderer::release() {
+    glDeleteBuffers(1, &ubo);
+    glDeleteVertexArrays(1, &vao);
+    ubo = 0;
+    vao = 0;
+}
+
+void CurveRenderer::setCurve(const glm::vec3* points, size_t segmentCount, int degree, uint32_t version) {
+    if (version == uploadedVersion && segmentCount == requestedSegments && degree == curveDegree) {
+        return;
+    }
+    uploadedVersion = version;
+    requestedSegments = segmentCount;
+    curveDegree = degree;
+
+    size_t stride = (size_t) degree + 1;
+    if (segmentCount * stride > (size_t) MAX_POINTS) {
+        std::cout << "[ERROR][CurveRenderer] " << segmentCount * stride << " control points, at most " << MAX_POINTS
+                  << " fit" << std::endl;
+        segmentCount = MAX_POINTS / stride;
+    }
+    segments = segmentCount;
+
+    // Premultiplied by the binomial coefficients, the shader only runs Horner's rule
+    staging.resize(segmentCount * stride);
+    for (size_t segment = 0; segment < segmentCount; ++segment) {
+        double binomial = 1.0;
+        for (size_t i = 0; i < stride; ++i) {
+            staging[segment * stride + i] = glm::vec4((float) binomial * points[segment * stride + i], 1.0f);
+            binomial = binomial * (double) (degree - i) / (double) (i + 1);
+        }
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, staging.size() * sizeof(glm::vec4), staging.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    lastStats.uploads++;
+}
+
+void CurveRenderer::draw(const glm::mat4& viewProj, int pointsPerSegment, bool useTessellation) {
+    lastStats.vertices = 0;
+    lastStats.tessellated = false;
+    bool tessellate = useTessellation && tessellationProgram != nullptr && tessellationProgram->valid();
+    ShaderProgram* active = tessellate ? tessellationProgram : program;
+    if (segments == 0 || !active->valid()) {
+        return;
+    }
+
+    active->use();
+    active->bindBlock(U_CURVE_POINTS, BINDING);
+    active->set(U_SEGMENT_COUNT, (int) segments);
+    active->set(U_DEGREE, curveDegree);
+    active->set(U_VIEW_PROJ, viewProj);
+    active->set(U_START_COLOR, startColor);
+    active->set(U_END_COLOR, endColor);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, ubo);
+    glBindVertexArray(vao);
+
+    if (tessellate) {
+        int level = std::max(1, std::min(pointsPerSegment, (int) maxTessLevel));
+        active->set(U_TESS_LEVEL, (float) level);
+        glPatchParameteri(GL_PATCH_VERTICES, 1);
+        glDrawArrays(GL_PATCHES, 0, (GLsizei) segments);
+        lastStats.vertices = (uint32_t) (segments * (level + 1));
+        lastStats.tessellated = true;
+    } else {
+        int lastVertex = std::max(1, (int) segments * pointsPerSegment);
+        active->set(U_LAST_VERTEX, lastVertex);
+        glDrawArrays(GL_LINE_STRIP, 0, lastVertex + 1);
+        lastStats.vertices = (uint32_t) lastVertex + 1;
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader_build.hpp"
+
+struct CurveRenderStats {
+    uint32_t uploads = 0;       // control point uploads so far
+    uint32_t vertices = 0;      // curve points evaluated on the GPU last draw
+    bool tessellated = false;   // last draw used the tessellation shaders
+};
+
+// Draws curves as depth tested line strips evaluated entirely on the GPU.
+//
+// The control points live in a uniform block (CurvePoints in curve_eval.glsl) and are uploaded only when their version
+// changes, there is no vertex buffer at all: the vertex shader evaluates the curve at gl_VertexID / (vertices - 1).
+// With GL 4.0 or ARB_tessellation_shader there is a second path that draws one patch per segment and lets the
+// tessellator generate the points of an isoline, up to GL_MAX_TESS_GEN_LEVEL per segment.
+class CurveRenderer {
+public:
+    static const int MAX_POINTS = 256;      // MAX_CURVE_POINTS in curve_eval.glsl
+    static const GLuint BINDING = 0;        // uniform buffer binding point of CurvePoints
+
+    // Needs a current GL context. The programs are built by builder like every other program.
+    explicit CurveRenderer(ShaderBuildService& builder);
+    // Call before the GL context is destroyed
+    void release();
+
+    // segmentCount segments of degree + 1 control points each, back to back. Nothing happens if version, count and
+    // degree are the ones uploaded last.
+    void setCurve(const glm::vec3* points, size_t segmentCount, int degree, uint32_t version);
+
+    // Draws into the bound framebuffer with the current depth state, pointsPerSegment line pieces per segment
+    void draw(const glm::mat4& viewProj, int pointsPerSegment, bool useTessellation);
+
+    bool tessellationSupported() const { return tessellationProgram != nullptr; }
+    const CurveRenderStats& stats() const { return lastStats; }
+
+    glm::vec3 startColor = glm::vec3(1.0f, 0.6f, 0.1f);
+    glm::vec3 endColor = glm::vec3(0.2f, 0.5f, 1.0f);
+
+private:
+    ShaderProgram* program;
+    ShaderProgram* tessellationProgram;
+    GLuint ubo;
+    GLuint vao;                 // core profiles need one bound even without attributes
+    GLint maxTessLevel;
+    size_t segments;            // drawn, at most MAX_POINTS control points' worth
+    size_t requestedSegments;   // passed to setCurve(), compared so a clamped curve isn't uploaded every frame
+    int curveDegree;
+    uint32_t uploadedVersion;
+    std::vector<glm::vec4> staging;
+    CurveRenderStats lastStats;
+};
@@ -0,0 +1,90 @@
+#include "depth_prepass.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const float SMOOTHING = 0.1f;
+// If the scene coverage changes this much since the timings were taken they no longer describe the scene
+static const float STALE_OVERDRAW_RATIO = 0.25f;
+// The first frames are slow with start-up work and would make the first choice look worse than it is, their timings
+// are ignored and the first early probe comes after them
+static const uint32_t WARM_UP_FRAMES = 10;
+
+void DepthPrepassPolicy::beginFrame() {
+    coveredArea = 0.0f;
+}
+
+void DepthPrepassPolicy::addOpaque(const glm::vec3& viewCenter, float radius, const glm::mat4& proj,
+                                   float viewportHeight) {
+    float distance = -viewCenter.z;
+    if (distance <= radius) {
+        // Camera is inside or right at the object, it covers the whole view
+        coveredArea += 1.0e9f;
+        return;
+    }
+
+    // proj[1][1] is cot(fovy / 2), so this is the projected radius in pixels
+    float radiusPixels = radius * proj[1][1] / distance * viewportHeight * 0.5f;
+    coveredArea += 3.14159265f * radiusPixels * radiusPixels;
+}
+
+bool DepthPrepassPolicy::decide(float viewportWidth, float viewportHeight) {
+    float viewportArea = std::max(viewportWidth * viewportHeight, 1.0f);
+    // A single object can at most cover the viewport once
+    overdraw = std::min(coveredArea / viewportArea, 1000.0f);
+
+    if (mode != DepthPrepassMode::AUTO) {
+        lastChoice = mode == DepthPrepassMode::ON;
+        return lastChoice;
+    }
+
+    if (estimateOn && overdraw < disableOverdraw) {
+        estimateOn = false;
+    } else if (!estimateOn && overdraw > enableOverdraw) {
+        estimateOn = true;
+    }
+
+    if (overdrawAtMeasurement > 0.0f
+        && std::fabs(overdraw - overdrawAtMeasurement) > overdrawAtMeasurement * STALE_OVERDRAW_RATIO) {
+        measuredWith = 0.0f;
+        measuredWithout = 0.0f;
+        overdrawAtMeasurement = 0.0f;
+    }
+
+    bool choice = estimateOn;
+    if (timed && measuredWith > 0.0f && measuredWithout > 0.0f) {
+        choice = measuredWith < measuredWithout;
+    }
+
+    // The other choice is tried every probeInterval frames, and early on as soon as the current one has a timing and it
+    // has none, so the timings take over within a few frames instead of a whole interval
+    frameCounter++;
+    bool otherUnmeasured = (choice ? measuredWithout : measuredWith) == 0.0f
+                           && (choice ? measuredWith : measuredWithout) > 0.0f;
+    if (timed && probeInterval > 0
+        && (frameCounter % (uint32_t) probeInterval == 0 || (otherUnmeasured && frameCounter > WARM_UP_FRAMES))) {
+        choice = !choice;
+    }
+
+    lastChoice = choice;
+    return choice;
+}
+
+void DepthPrepassPolicy::reportTiming(bool usedPrepass, float ms) {
+    if (ms <= 0.0f || frameCounter <= WARM_UP_FRAMES) {
+        return;
+    }
+    float& measured = usedPrepass ? measuredWith : measuredWithout;
+    measured = measured == 0.0f ? ms : measured + (ms - measured) * SMOOTHING;
+    if (overdrawAtMeasurement == 0.0f) {
+        overdrawAtMeasurement = std::max(overdraw, 0.001f);
+    }
+}
+
+const char* depthPrepassModeName(DepthPrepassMode mode) {
+    switch (mode) {
+        case DepthPrepassMode::OFF: return "Off";
+        case DepthPrepassMode::ON: return "On";
+        case DepthPrepassMode::AUTO: return "Auto";
+        default: return "Unknown";
+    }
+}
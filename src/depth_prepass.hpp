@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+enum class DepthPrepassMode {
+    OFF = 0,
+    ON = 1,
+    AUTO = 2
+};
+
+// Decides whether the depth-only pre-pass is worth it this frame.
+//
+// The estimate is the summed screen coverage of all opaque bounding spheres divided by the viewport area. With little
+// overlap the pre-pass just doubles vertex work, with heavy overlap it saves shading hidden fragments. In AUTO mode the
+// estimate picks the initial choice (with hysteresis), then every probeInterval frames the other choice is tried and
+// both are timed, on the GPU or by whole frame time where the GPU timer can't see the work; once both timings exist
+// they take over from the estimate. With nothing to time the choices by (timed false) the estimate decides alone and
+// the other choice is never probed.
+class DepthPrepassPolicy {
+public:
+    DepthPrepassMode mode = DepthPrepassMode::AUTO;
+    float enableOverdraw = 1.6f;
+    float disableOverdraw = 1.3f;
+    int probeInterval = 120;
+    bool timed = true;
+
+    void beginFrame();
+    void addOpaque(const glm::vec3& viewCenter, float radius, const glm::mat4& proj, float viewportHeight);
+    bool decide(float viewportWidth, float viewportHeight);
+
+    // Feed back the GPU or whole frame time of a frame rendered with or without the pre-pass. Only one kind per run,
+    // the two aren't comparable.
+    void reportTiming(bool usedPrepass, float ms);
+
+    float estimatedOverdraw() const { return overdraw; }
+    float measuredMs(bool withPrepass) const { return withPrepass ? measuredWith : measuredWithout; }
+    bool enabled() const { return lastChoice; }
+
+private:
+    float coveredArea = 0.0f;
+    float overdraw = 0.0f;
+    float overdrawAtMeasurement = 0.0f;
+    bool estimateOn = false;
+    bool lastChoice = false;
+    uint32_t frameCounter = 0;
+
+    // Exponential moving averages, 0 means no measurement yet
+    float measuredWith = 0.0f;
+    float measuredWithout = 0.0f;
+};
+
+const char* depthPrepassModeName(DepthPrepassMode mode);
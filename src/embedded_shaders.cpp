@@ -0,0 +1,13 @@
+#include "embedded_shaders.hpp"
+
+const EmbeddedShader* FindEmbeddedShader(const std::string& path) {
+    // A handful of files, a linear scan is fine
+    size_t count = 0;
+    const EmbeddedShader* shaders = EmbeddedShaderTable(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (path == shaders[i].path) {
+            return &shaders[i];
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// A shader file compiled into the executable by cmake/embed_shaders.cmake.
+struct EmbeddedShader {
+    const char* path;           // relative to the repository root, e.g. "src/shaders/BasicVS.vert"
+    uint64_t hash;              // content hash computed at build time
+    std::string_view source;
+};
+
+// Defined in the generated embedded_shader_data.cpp
+const EmbeddedShader* EmbeddedShaderTable(size_t& count);
+
+// nullptr if the path (as passed to PreprocessShader, any "./" or ".." already normalised) isn't embedded
+const EmbeddedShader* FindEmbeddedShader(const std::string& path);
@@ -0,0 +1,540 @@
+#include "frame_capture.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include "frame_writer.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAPTURE_USE_SSE 1
+#include <emmintrin.h>
+// Like the curve kernels, the AVX2 versions are compiled for that target alone and only called after CPUID said so
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CAPTURE_USE_AVX2 1
+#define CAPTURE_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+// Fixed point BT.601 full range, scaled by 256. The chroma terms are rewritten with (255 - c) so every intermediate
+// is unsigned and fits 16 bits: Cb = (128 B + 43 (255 - R) + 85 (255 - G) + 128) >> 8, which equals
+// 128 + (-43 R - 85 G + 128 B + 128) >> 8.
+static inline uint8_t lumaOf(int r, int g, int b) {
+    return (uint8_t) ((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+static inline uint8_t cbOf(int r, int g, int b) {
+    return (uint8_t) ((128 * b + 43 * (255 - r) + 85 * (255 - g) + 128) >> 8);
+}
+
+static inline uint8_t crOf(int r, int g, int b) {
+    return (uint8_t) ((128 * r + 107 * (255 - g) + 21 * (255 - b) + 128) >> 8);
+}
+
+#ifdef CAPTURE_USE_AVX2
+// The AVX2 rows do the same arithmetic as the SSE2 ones, 32 pixels at a time, and return how far they got. The rest is
+// left to the SSE2 and scalar loops.
+
+CAPTURE_AVX2 static int lumaRowAvx2(const uint8_t* r, const uint8_t* g, const uint8_t* b, int width, uint8_t* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i kr = _mm256_set1_epi16(77), kg = _mm256_set1_epi16(150), kb = _mm256_set1_epi16(29);
+    const __m256i round = _mm256_set1_epi16(128);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i r8 = _mm256_loadu_si256((const __m256i*) (r + x));
+        __m256i g8 = _mm256_loadu_si256((const __m256i*) (g + x));
+        __m256i b8 = _mm256_loadu_si256((const __m256i*) (b + x));
+        // Unpacking and packing both work within 128 bit lanes, so the pixels come out in order
+        __m256i half[2];
+        for (int h = 0; h < 2; ++h) {
+            __m256i r16 = h == 0 ? _mm256_unpacklo_epi8(r8, zero) : _mm256_unpackhi_epi8(r8, zero);
+            __m256i g16 = h == 0 ? _mm256_unpacklo_epi8(g8, zero) : _mm256_unpackhi_epi8(g8, zero);
+            __m256i b16 = h == 0 ? _mm256_unpacklo_epi8(b8, zero) : _mm256_unpackhi_epi8(b8, zero);
+            __m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r16, kr), _mm256_mullo_epi16(g16, kg)),
+                                           _mm256_add_epi16(_mm256_mullo_epi16(b16, kb), round));
+            half[h] = _mm256_srli_epi16(sum, 8);
+        }
+        _mm256_storeu_si256((__m256i*) (out + x), _mm256_packus_epi16(half[0], half[1]));
+    }
+    return x;
+}
+
+CAPTURE_AVX2 static int chromaRowAvx2(const uint8_t* const top[3], const uint8_t* const bottom[3], int width,
+                                      uint8_t* cb, uint8_t* cr) {
+    const __m256i low = _mm256_set1_epi16(0x00FF);
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i round = _mm256_set1_epi16(128);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i c[3];
+        for (int channel = 0; channel < 3; ++channel) {
+            __m256i v = _mm256_avg_epu8(_mm256_loadu_si256((const __m256i*) (top[channel] + x)),
+                                        _mm256_loadu_si256((const __m256i*) (bottom[channel] + x)));
+            __m256i even = _mm256_and_si256(v, low);
+            __m256i odd = _mm256_srli_epi16(v, 8);
+            c[channel] = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(even, odd), one), 1);
+        }
+        __m256i invR = _mm256_sub_epi16(full, c[0]);
+        __m256i invG = _mm256_sub_epi16(full, c[1]);
+        __m256i invB = _mm256_sub_epi16(full, c[2]);
+        __m256i u = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_slli_epi16(c[2], 7), _mm256_mullo_epi16(invR, _mm256_set1_epi16(43))),
+            _mm256_add_epi16(_mm256_mullo_epi16(invG, _mm256_set1_epi16(85)), round));
+        __m256i v = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_slli_epi16(c[0], 7), _mm256_mullo_epi16(invG, _mm256_set1_epi16(107))),
+            _mm256_add_epi16(_mm256_mullo_epi16(invB, _mm256_set1_epi16(21)), round));
+        // Per lane Cb then Cr, 8 of each; gathering the 64 bit halves puts all 16 Cb in front of the 16 Cr
+        __m256i packed = _mm256_packus_epi16(_mm256_srli_epi16(u, 8), _mm256_srli_epi16(v, 8));
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i*) (cb + x / 2), _mm256_castsi256_si128(packed));
+        _mm_storeu_si128((__m128i*) (cr + x / 2), _mm256_extracti128_si256(packed, 1));
+    }
+    return x;
+}
+
+CAPTURE_AVX2 static int deinterleaveRowAvx2(const uint8_t* rgba, int width, uint8_t* r, uint8_t* g, uint8_t* b) {
+    // Within each lane R0-3 G0-3 B0-3 A0-3, then across lanes R, G, B and A of all 8 pixels as 64 bit groups
+    const __m256i group = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+                                           0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    const __m256i gather = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i v[4];
+        for (int k = 0; k < 4; ++k) {
+            v[k] = _mm256_loadu_si256((const __m256i*) (rgba + (x + k * 8) * 4));
+            v[k] = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v[k], group), gather);
+        }
+        // Low lanes hold R and G, high lanes B and A
+        __m256i rb01 = _mm256_unpacklo_epi64(v[0], v[1]);
+        __m256i rb23 = _mm256_unpacklo_epi64(v[2], v[3]);
+        __m256i ga01 = _mm256_unpackhi_epi64(v[0], v[1]);
+        __m256i ga23 = _mm256_unpackhi_epi64(v[2], v[3]);
+        _mm256_storeu_si256((__m256i*) (r + x), _mm256_permute2x128_si256(rb01, rb23, 0x20));
+        _mm256_storeu_si256((__m256i*) (g + x), _mm256_permute2x128_si256(ga01, ga23, 0x20));
+        _mm256_storeu_si256((__m256i*) (b + x), _mm256_permute2x128_si256(rb01, rb23, 0x31));
+    }
+    return x;
+}
+#endif
+
+static void lumaRow(const uint8_t* r, const uint8_t* g, const uint8_t* b, int width, uint8_t* out, bool avx2) {
+    int x = 0;
+#ifdef CAPTURE_USE_AVX2
+    if (avx2) {
+        x = lumaRowAvx2(r, g, b, width, out);
+    }
+#endif
+#ifdef CAPTURE_USE_SSE
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i kr = _mm_set1_epi16(77), kg = _mm_set1_epi16(150), kb = _mm_set1_epi16(29);
+    const __m128i round = _mm_set1_epi16(128);
+    for (; x + 16 <= width; x += 16) {
+        __m128i r8 = _mm_loadu_si128((const __m128i*) (r + x));
+        __m128i g8 = _mm_loadu_si128((const __m128i*) (g + x));
+        __m128i b8 = _mm_loadu_si128((const __m128i*) (b + x));
+        __m128i half[2];
+        for (int h = 0; h < 2; ++h) {
+            __m128i r16 = h == 0 ? _mm_unpacklo_epi8(r8, zero) : _mm_unpackhi_epi8(r8, zero);
+            __m128i g16 = h == 0 ? _mm_unpacklo_epi8(g8, zero) : _mm_unpackhi_epi8(g8, zero);
+            __m128i b16 = h == 0 ? _mm_unpacklo_epi8(b8, zero) : _mm_unpackhi_epi8(b8, zero);
+            // At most 256 * 255 + 128, wraps neither as unsigned 16 bit nor through the logical shift
+            __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r16, kr), _mm_mullo_epi16(g16, kg)),
+                                        _mm_add_epi16(_mm_mullo_epi16(b16, kb), round));
+            half[h] = _mm_srli_epi16(sum, 8);
+        }
+        _mm_storeu_si128((__m128i*) (out + x), _mm_packus_epi16(half[0], half[1]));
+    }
+#endif
+    for (; x < width; ++x) {
+        out[x] = lumaOf(r[x], g[x], b[x]);
+    }
+}
+
+// One chroma row from two luma rows, each 2x2 block averaged the way _mm_avg_epu8 rounds: vertically, then
+// horizontally, both rounding up
+static void chromaRow(const uint8_t* const top[3], const uint8_t* const bottom[3], int width, uint8_t* cb,
+                      uint8_t* cr, bool avx2) {
+    int x = 0;
+#ifdef CAPTURE_USE_AVX2
+    if (avx2) {
+        x = chromaRowAvx2(top, bottom, width, cb, cr);
+    }
+#endif
+#ifdef CAPTURE_USE_SSE
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low = _mm_set1_epi16(0x00FF);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i round = _mm_set1_epi16(128);
+    for (; x + 16 <= width; x += 16) {
+        __m128i c[3];
+        for (int channel = 0; channel < 3; ++channel) {
+            __m128i v = _mm_avg_epu8(_mm_loadu_si128((const __m128i*) (top[channel] + x)),
+                                     _mm_loadu_si128((const __m128i*) (bottom[channel] + x)));
+            __m128i even = _mm_and_si128(v, low);
+            __m128i odd = _mm_srli_epi16(v, 8);
+            c[channel] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(even, odd), one), 1);
+        }
+        __m128i invR = _mm_sub_epi16(full, c[0]);
+        __m128i invG = _mm_sub_epi16(full, c[1]);
+        __m128i invB = _mm_sub_epi16(full, c[2]);
+        __m128i u = _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(c[2], 7), _mm_mullo_epi16(invR, _mm_set1_epi16(43))),
+                                  _mm_add_epi16(_mm_mullo_epi16(invG, _mm_set1_epi16(85)), round));
+        __m128i v = _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(c[0], 7), _mm_mullo_epi16(invG, _mm_set1_epi16(107))),
+                                  _mm_add_epi16(_mm_mullo_epi16(invB, _mm_set1_epi16(21)), round));
+        _mm_storel_epi64((__m128i*) (cb + x / 2), _mm_packus_epi16(_mm_srli_epi16(u, 8), zero));
+        _mm_storel_epi64((__m128i*) (cr + x / 2), _mm_packus_epi16(_mm_srli_epi16(v, 8), zero));
+    }
+#endif
+    for (; x < width; x += 2) {
+        int c[3];
+        for (int channel = 0; channel < 3; ++channel) {
+            int left = (top[channel][x] + bottom[channel][x] + 1) >> 1;
+            int right = (top[channel][x + 1] + bottom[channel][x + 1] + 1) >> 1;
+            c[channel] = (left + right + 1) >> 1;
+        }
+        cb[x / 2] = cbOf(c[0], c[1], c[2]);
+        cr[x / 2] = crOf(c[0], c[1], c[2]);
+    }
+}
+
+// Splits RGBA pixels into R, G and B planes
+static void deinterleaveRow(const uint8_t* rgba, int width, uint8_t* r, uint8_t* g, uint8_t* b, bool avx2) {
+    int x = 0;
+#ifdef CAPTURE_USE_AVX2
+    if (avx2) {
+        x = deinterleaveRowAvx2(rgba, width, r, g, b);
+    }
+#endif
+#ifdef CAPTURE_USE_SSE
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    for (; x + 16 <= width; x += 16) {
+        __m128i v[4];
+        for (int k = 0; k < 4; ++k) {
+            v[k] = _mm_loadu_si128((const __m128i*) (rgba + (x + k * 4) * 4));
+        }
+        uint8_t* planes[3] = { r, g, b };
+        for (int channel = 0; channel < 3; ++channel) {
+            __m128i c[4];
+            for (int k = 0; k < 4; ++k) {
+                c[k] = _mm_and_si128(channel == 0 ? v[k] : _mm_srli_epi32(v[k], channel * 8), mask);
+            }
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], c[3]));
+            _mm_storeu_si128((__m128i*) (planes[channel] + x), packed);
+        }
+    }
+#endif
+    for (; x < width; ++x) {
+        r[x] = rgba[x * 4];
+        g[x] = rgba[x * 4 + 1];
+        b[x] = rgba[x * 4 + 2];
+    }
+}
+
+static bool supportsAvx2() {
+#ifdef CAPTURE_USE_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+void ConvertRGBAToYUV420(const uint8_t* rgba, size_t rowBytes, int width, int height, uint8_t* yuv,
+                         std::vector<uint8_t>& scratch) {
+    static const bool avx2 = supportsAvx2();
+    size_t w = (size_t) width;
+    scratch.resize(w * 6);
+    uint8_t* lumaPlane = yuv;
+    uint8_t* cbPlane = yuv + w * height;
+    uint8_t* crPlane = cbPlane + (w / 2) * (height / 2);
+
+    for (int y = 0; y < height; y += 2) {
+        const uint8_t* rows[2][3];
+        for (int k = 0; k < 2; ++k) {
+            // GL rows are bottom-up, the image is written top-down
+            const uint8_t* source = rgba + (size_t) (height - 1 - y - k) * rowBytes;
+            uint8_t* r = scratch.data() + w * 3 * k;
+            uint8_t* g = r + w;
+            uint8_t* b = g + w;
+            deinterleaveRow(source, width, r, g, b, avx2);
+            rows[k][0] = r;
+            rows[k][1] = g;
+            rows[k][2] = b;
+            lumaRow(r, g, b, width, lumaPlane + (size_t) (y + k) * w, avx2);
+        }
+        chromaRow(rows[0], rows[1], width, cbPlane + (size_t) (y / 2) * (w / 2), crPlane + (size_t) (y / 2) * (w / 2),
+                  avx2);
+    }
+}
+
+FrameCapture::FrameCapture() {}
+
+FrameCapture::~FrameCapture() {
+    stopWriter();
+}
+
+bool FrameCapture::start(const std::string& path, CaptureFormat captureFormat, int framesPerSecond, bool drop) {
+    if (recording) {
+        std::cout << "[WARNING][FrameCapture] Already recording to \"" << outputPath << "\"" << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    fs::path directory = captureFormat == CaptureFormat::PPM ? fs::path(path) : fs::path(path).parent_path();
+    if (!directory.empty()) {
+        fs::create_directories(directory, error);
+    }
+    if (error) {
+        std::cout << "[ERROR][FrameCapture] Couldn't create \"" << directory.string() << "\": " << error.message()
+                  << std::endl;
+        return false;
+    }
+    if (captureFormat == CaptureFormat::Y4M) {
+        video.open(path, std::ios::binary | std::ios::trunc);
+        if (!video) {
+            std::cout << "[ERROR][FrameCapture] Couldn't open \"" << path << "\"" << std::endl;
+            return false;
+        }
+        videoHeader = false;
+    }
+
+    format = captureFormat;
+    outputPath = path;
+    fps = std::max(framesPerSecond, 1);
+    dropFrames = drop;
+    slotCount = RING + (drop ? MAX_QUEUED : MAX_QUEUED_WAITING);
+    head = 0;
+    videoWidth = videoHeight = 0;
+    nextIndex = 0;
+    warnedSize = false;
+    localStats = CaptureStats();
+    written = 0;
+    encodeMs = 0.0f;
+    quit = false;
+    writer = std::thread(&FrameCapture::run, this);
+    recording = true;
+    return true;
+}
+
+void FrameCapture::capture(int width, int height) {
+    if (!recording) {
+        return;
+    }
+    auto startTime = std::chrono::steady_clock::now();
+
+    width = std::max(width, 2);
+    height = std::max(height, 2);
+    bool skip = false;
+    if (format == CaptureFormat::Y4M) {
+        if (videoWidth == 0) {
+            videoWidth = width & ~1;
+            videoHeight = height & ~1;
+        } else if ((width & ~1) != videoWidth || (height & ~1) != videoHeight) {
+            if (!warnedSize) {
+                std::cout << "[WARNING][FrameCapture] Frame size changed to " << width << "x" << height
+                          << ", Y4M needs " << videoWidth << "x" << videoHeight << ", dropping frames" << std::endl;
+                warnedSize = true;
+            }
+            localStats.dropped++;
+            skip = true;
+        }
+    }
+
+    if (!skip && !unmap(slots[head], !dropFrames)) {
+        // The writer is still on the buffer this frame would go into
+        localStats.dropped++;
+        skip = true;
+    }
+
+    if (!skip) {
+        Slot& slot = slots[head];
+        if (!slot.pbo) {
+            glGenBuffers(1, &slot.pbo);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        size_t size = (size_t) width * height * 4;
+        if (size > slot.capacity) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) size, nullptr, GL_STREAM_READ);
+            slot.capacity = size;
+        }
+        // With a pack buffer bound this only queues the copy, the pointer is an offset into the buffer. RGBA matches
+        // the framebuffer's layout, so drivers (llvmpipe in particular) copy rows instead of converting pixels.
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*) 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.width = width;
+        slot.height = height;
+        slot.index = nextIndex++;
+        localStats.captured++;
+        head = (head + 1) % slotCount;
+
+        // The oldest readback in flight, issued RING - 1 frames ago
+        int oldest = (head + slotCount - RING) % slotCount;
+        if (slots[oldest].fence) {
+            collect(oldest);
+        }
+    }
+
+    localStats.captureMs =
+        std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void FrameCapture::collect(int index) {
+    Slot& slot = slots[index];
+    // Flushes in case the fence is still only queued, a fence this old has normally signalled already
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+        std::cout << "[WARNING][FrameCapture] Readback of frame " << slot.index << " didn't finish" << std::endl;
+        localStats.dropped++;
+        return;
+    }
+
+    // Stays mapped until the writer is done with it, the writer reads the pixels where GL left them
+    size_t size = (size_t) slot.width * slot.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    slot.mapped = (const uint8_t*) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) size, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!slot.mapped) {
+        std::cout << "[ERROR][FrameCapture] Couldn't map the pixel buffer of frame " << slot.index << std::endl;
+        localStats.dropped++;
+        return;
+    }
+
+    Frame frame;
+    frame.slot = index;
+    frame.rgba = slot.mapped;
+    frame.rowBytes = (size_t) slot.width * 4;
+    frame.width = format == CaptureFormat::Y4M ? videoWidth : slot.width;
+    frame.height = format == CaptureFormat::Y4M ? videoHeight : slot.height;
+    frame.index = slot.index;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    slot.queued = true;
+    queue.push_back(frame);
+    wakeWriter.notify_one();
+}
+
+bool FrameCapture::unmap(Slot& slot, bool wait) {
+    if (!slot.mapped) {
+        return true;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (slot.queued && !wait) {
+            return false;
+        }
+        frameDone.wait(lock, [&slot] { return !slot.queued; });
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.mapped = nullptr;
+    return true;
+}
+
+void FrameCapture::stop() {
+    if (!recording) {
+        return;
+    }
+    // Oldest first so the writer still gets the frames in order
+    for (int i = 0; i < slotCount; ++i) {
+        int index = (head + i) % slotCount;
+        if (slots[index].fence) {
+            collect(index);
+        }
+    }
+    stopWriter();
+    for (Slot& slot : slots) {
+        unmap(slot, true);
+    }
+
+    CaptureStats finalStats = stats();
+    std::cout << "[INFO][FrameCapture] Wrote " << finalStats.written << " frames to \"" << outputPath << "\""
+              << (finalStats.dropped ? ", dropped " + std::to_string(finalStats.dropped) : std::string()) << std::endl;
+}
+
+void FrameCapture::release() {
+    for (Slot& slot : slots) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        unmap(slot, true);
+        glDeleteBuffers(1, &slot.pbo);
+        slot = Slot();
+    }
+    head = 0;
+}
+
+CaptureStats FrameCapture::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    CaptureStats result = localStats;
+    result.written = written;
+    result.queued = (uint32_t) queue.size();
+    result.encodeMs = encodeMs;
+    return result;
+}
+
+void FrameCapture::stopWriter() {
+    if (writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wakeWriter.notify_one();
+        writer.join();
+    }
+    if (video.is_open()) {
+        video.close();
+    }
+    recording = false;
+}
+
+void FrameCapture::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeWriter.wait(lock, [this] { return quit || !queue.empty(); });
+        // Whatever was queued before stop() is still written
+        if (queue.empty()) {
+            break;
+        }
+        Frame frame = queue.front();
+        queue.pop_front();
+        lock.unlock();
+
+        auto startTime = std::chrono::steady_clock::now();
+        write(frame);
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+        lock.lock();
+        written++;
+        encodeMs = ms;
+        slots[frame.slot].queued = false;
+        frameDone.notify_all();
+    }
+}
+
+void FrameCapture::write(const Frame& frame) {
+    if (format == CaptureFormat::PPM) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%05u.ppm", frame.index);
+        WritePPM((fs::path(outputPath) / name).string(), frame.width, frame.height, frame.rgba, true, 4);
+        return;
+    }
+
+    if (!videoHeader) {
+        video << "YUV4MPEG2 W" << frame.width << " H" << frame.height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+        videoHeader = true;
+    }
+    yuv.resize((size_t) frame.width * frame.height * 3 / 2);
+    ConvertRGBAToYUV420(frame.rgba, frame.rowBytes, frame.width, frame.height, yuv.data(), planes);
+    video << "FRAME\n";
+    video.write(reinterpret_cast<const char*>(yuv.data()), (std::streamsize) yuv.size());
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+enum class CaptureFormat : uint8_t {
+    Y4M,    // one raw YUV 4:2:0 video file, full range BT.601 (C420jpeg)
+    PPM     // one image per frame, frame_00000.ppm, ...
+};
+
+struct CaptureStats {
+    uint32_t captured = 0;      // readbacks issued
+    uint32_t written = 0;       // frames the writer finished
+    uint32_t dropped = 0;       // frames skipped because the writer fell behind or the size changed
+    uint32_t queued = 0;        // frames waiting for the writer
+    float captureMs = 0.0f;     // CPU time of the last capture() call on the GL thread
+    float encodeMs = 0.0f;      // writer time of the last frame, conversion and disk
+};
+
+// Records the scene without stalling the pipeline on glReadPixels.
+//
+// capture() reads the frame into a pixel pack buffer and puts a fence behind it. The buffer written RING - 1 frames
+// earlier is then mapped (its fence has normally long signalled) and handed to a writer thread as it is, which converts
+// and writes straight from the mapping. The GL thread only pays for issuing the readback and the map, a buffer is
+// unmapped when its turn to be read into comes round again and the writer is done with it. Buffers beyond the RING in
+// flight are the writer's queue, a capture that doesn't drop frames gets a deeper one.
+class FrameCapture {
+public:
+    static const int RING = 3;
+    static const int MAX_QUEUED = 6;            // frames waiting for the writer before new ones are dropped
+    static const int MAX_QUEUED_WAITING = 16;   // without dropping, before the GL thread waits for the writer
+
+    FrameCapture();
+    // Stops the writer, pending readbacks are lost. Call stop() and release() first while the context is current.
+    ~FrameCapture();
+
+    // path is the file for Y4M and the directory for PPM. With dropFrames a writer that falls behind loses frames
+    // instead of slowing the frame loop down, for interactive recording.
+    bool start(const std::string& path, CaptureFormat format, int fps = 60, bool dropFrames = true);
+    // Reads the bottom-left width x height of the bound read framebuffer. Y4M needs a fixed size, frames that don't
+    // match the first one are dropped.
+    void capture(int width, int height);
+    // Collects the readbacks still in flight and waits until the writer wrote everything
+    void stop();
+    // Deletes the pixel buffers, must be called while the context is still current
+    void release();
+
+    bool active() const { return recording; }
+    const std::string& path() const { return outputPath; }
+    CaptureStats stats() const;
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        size_t capacity = 0;
+        int width = 0;
+        int height = 0;
+        uint32_t index = 0;
+        const uint8_t* mapped = nullptr;
+        bool queued = false;        // the writer hasn't finished with the mapping yet, guarded by the mutex
+    };
+
+    struct Frame {
+        int slot = 0;
+        const uint8_t* rgba = nullptr;  // the mapped buffer, bottom row first as GL reads it
+        size_t rowBytes = 0;
+        int width = 0;                  // size to write, Y4M crops the read size to even numbers
+        int height = 0;
+        uint32_t index = 0;
+    };
+
+    Slot slots[RING + MAX_QUEUED_WAITING];
+    int slotCount = RING + MAX_QUEUED;  // RING in flight plus the writer's queue, set by start()
+    int head = 0;
+    bool recording = false;
+    bool dropFrames = true;
+    CaptureFormat format = CaptureFormat::Y4M;
+    std::string outputPath;
+    int fps = 60;
+    int videoWidth = 0;
+    int videoHeight = 0;
+    uint32_t nextIndex = 0;
+    bool warnedSize = false;
+    CaptureStats localStats;
+
+    std::thread writer;
+    mutable std::mutex mutex;
+    std::condition_variable wakeWriter;
+    std::condition_variable frameDone;
+    std::deque<Frame> queue;
+    bool quit = false;
+    uint32_t written = 0;
+    float encodeMs = 0.0f;
+
+    // Writer thread only, the file is opened by start()
+    std::ofstream video;
+    bool videoHeader = false;
+    std::vector<uint8_t> yuv;
+    std::vector<uint8_t> planes;
+
+    void collect(int slot);
+    bool unmap(Slot& slot, bool wait);
+    void run();
+    void write(const Frame& frame);
+    void stopWriter();
+};
+
+// Converts bottom-up RGBA rows to top-down planar YUV 4:2:0 (Y, then Cb, then Cr) with full range BT.601 coefficients,
+// 32 pixels at a time with AVX2 (picked at run time) or 16 with SSE2 where available. width and height must be even,
+// the bottom-left width x height corner is converted. scratch holds the deinterleaved channels of two rows.
+void ConvertRGBAToYUV420(const uint8_t* rgba, size_t rowBytes, int width, int height, uint8_t* yuv,
+                         std::vector<uint8_t>& scratch);
@@ -0,0 +1,84 @@
+#include "frame_governor.hpp"
+#include <algorithm>
+
+// Lowest quality first. DEFAULT_LEVEL is the full quality the scene was tuned for, the levels above it spend headroom.
+static const QualitySettings LADDER[] = {
+    { 0.5f, 100, 4.0f },
+    { 0.625f, 150, 3.0f },
+    { 0.75f, 200, 2.5f },
+    { 0.875f, 300, 2.0f },
+    { 1.0f, 300, 2.0f },
+    { 1.0f, 500, 1.5f },
+    { 1.0f, 1000, 1.0f },
+    { 1.0f, 2000, 0.5f },
+};
+static const int LEVEL_COUNT = (int) (sizeof(LADDER) / sizeof(LADDER[0]));
+static const int DEFAULT_LEVEL = 6;
+
+// A percentile of a few frames is mostly noise
+static const int MIN_WINDOW = 30;
+// Intervals within this fraction of the refresh period are taken to have waited for vsync. A missed vsync doubles the
+// interval with double buffering, triple buffering lands in between.
+static const float VSYNC_TOLERANCE = 0.25f;
+
+FrameGovernor::FrameGovernor() : currentLevel(DEFAULT_LEVEL) {
+    scratch.reserve(WINDOW);
+}
+
+int FrameGovernor::levels() const {
+    return LEVEL_COUNT;
+}
+
+const QualitySettings& FrameGovernor::settings() const {
+    return enabled ? LADDER[currentLevel] : LADDER[DEFAULT_LEVEL];
+}
+
+void FrameGovernor::setLevel(int level) {
+    currentLevel = std::max(0, std::min(level, LEVEL_COUNT - 1));
+    windowCount = 0;
+    windowNext = 0;
+    overFrames = 0;
+    underFrames = 0;
+    settleLeft = settleFrames;
+    lastPercentile = 0.0f;
+}
+
+void FrameGovernor::reportFrame(float cpuMs, float gpuMs) {
+    addCost(std::max(cpuMs, gpuMs));
+}
+
+void FrameGovernor::reportInterval(float intervalMs, float refreshMs) {
+    bool madeVsync = refreshMs > 0.0f && intervalMs > refreshMs * (1.0f - VSYNC_TOLERANCE)
+                     && intervalMs < refreshMs * (1.0f + VSYNC_TOLERANCE);
+    addCost(madeVsync ? budgetMs : intervalMs);
+}
+
+void FrameGovernor::addCost(float ms) {
+    if (!enabled) {
+        return;
+    }
+    if (settleLeft > 0) {
+        settleLeft--;
+        return;
+    }
+
+    window[windowNext] = ms;
+    windowNext = (windowNext + 1) % WINDOW;
+    windowCount = std::min(windowCount + 1, WINDOW);
+    if (windowCount < MIN_WINDOW) {
+        return;
+    }
+
+    scratch.assign(window, window + windowCount);
+    size_t rank = std::min((size_t) (percentile * (float) windowCount), scratch.size() - 1);
+    std::nth_element(scratch.begin(), scratch.begin() + rank, scratch.end());
+    lastPercentile = scratch[rank];
+
+    overFrames = lastPercentile > budgetMs ? overFrames + 1 : 0;
+    underFrames = lastPercentile < budgetMs * upgradeFraction ? underFrames + 1 : 0;
+    if (overFrames >= holdFrames && currentLevel > 0) {
+        setLevel(currentLevel - 1);
+    } else if (underFrames >= holdFrames && currentLevel < LEVEL_COUNT - 1) {
+        setLevel(currentLevel + 1);
+    }
+}
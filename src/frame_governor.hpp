@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// What the governor trades for frame time
+struct QualitySettings {
+    float resolutionScale = 1.0f;   // scene render size relative to the size it's shown at
+    int curveSegments = 1000;       // tessellation of the curve overlay
+    float lodBias = 1.0f;           // multiplies the pixel size below which cheaper shader variants are used
+};
+
+// Keeps the frame cost inside a budget by stepping through a ladder of quality levels.
+//
+// Each frame reports its cost, the larger of its CPU and GPU time, into a rolling window. Where the GPU timer can't see
+// the rendering (software rasterisers draw at the flush) the interval from one frame to the next is reported instead. A
+// frame that waited for vsync can't show how much room it left, so an interval close to the refresh period counts as
+// exactly on budget: the quality still drops when frames miss vsync, but doesn't climb behind it. When the window's
+// percentile stays over budgetMs for holdFrames frames in a row the quality drops a level, when it stays under
+// upgradeFraction * budgetMs it rises one. After every change the window is cleared and nothing changes for
+// settleFrames frames, so the next decision only sees frames rendered at the new level. Cheap knobs go first: the
+// overlay loses segments and the shading LOD before the scene resolution drops.
+class FrameGovernor {
+public:
+    static const int WINDOW = 120;
+
+    bool enabled = true;
+    float budgetMs = 1000.0f / 60.0f;
+    float percentile = 0.9f;
+    float upgradeFraction = 0.7f;
+    int holdFrames = 30;
+    int settleFrames = 60;
+
+    FrameGovernor();
+
+    void reportFrame(float cpuMs, float gpuMs);
+    // Instead of reportFrame() when the GPU time isn't known. refreshMs is 0 without vsync.
+    void reportInterval(float intervalMs, float refreshMs);
+    // Settings for the next frame, full quality when disabled
+    const QualitySettings& settings() const;
+
+    int level() const { return currentLevel; }
+    int levels() const;
+    // The window's percentile frame cost, 0 until the window has enough frames
+    float percentileMs() const { return lastPercentile; }
+
+private:
+    int currentLevel;
+    float window[WINDOW];
+    int windowCount = 0;
+    int windowNext = 0;
+    int overFrames = 0;
+    int underFrames = 0;
+    int settleLeft = 0;
+    float lastPercentile = 0.0f;
+    std::vector<float> scratch;
+
+    void setLevel(int level);
+    void addCost(float ms);
+};
@@ -0,0 +1,34 @@
+#include "frame_writer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+bool WritePPM(const std::string& path, int width, int height, const uint8_t* pixels, bool bottomUp, int channels) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "[ERROR][WritePPM] Couldn't open \"" << path << "\"" << std::endl;
+        return false;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    size_t rowBytes = (size_t) width * channels;
+    std::vector<uint8_t> rgb;
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* source = pixels + (bottomUp ? height - 1 - row : row) * rowBytes;
+        if (channels == 3) {
+            file.write(reinterpret_cast<const char*>(source), rowBytes);
+            continue;
+        }
+        rgb.resize((size_t) width * 3);
+        for (int x = 0; x < width; ++x) {
+            std::copy(source + x * channels, source + x * channels + 3, rgb.begin() + x * 3);
+        }
+        file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    }
+    if (!file) {
+        std::cout << "[ERROR][WritePPM] Writing \"" << path << "\" failed" << std::endl;
+        return false;
+    }
+    return true;
+}
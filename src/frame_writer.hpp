@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Writes tightly packed 8-bit RGB or RGBA (channels 3 or 4, alpha is dropped) pixels as a binary PPM (P6). GL reads
+// rows bottom to top, bottomUp flips them so the image isn't upside down.
+bool WritePPM(const std::string& path, int width, int height, const uint8_t* pixels, bool bottomUp = true,
+              int channels = 3);
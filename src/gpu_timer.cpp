@@ -0,0 +1,121 @@
+#include "gpu_timer.hpp"
+
+GpuTimer::GpuTimer() : current(0), created(false), inFrame(false), skipFrame(false), resultValid(false),
+                       freshResult(false), lastTag(0), lastTotalMs(0.0f) {
+    for (float& ms : lastSectionMs) {
+        ms = 0.0f;
+    }
+}
+
+void GpuTimer::release() {
+    if (!created) {
+        return;
+    }
+    for (FrameQueries& frame : frames) {
+        glDeleteQueries(1, &frame.start);
+        glDeleteQueries(MAX_SECTIONS, frame.sections);
+    }
+    created = false;
+    resultValid = false;
+}
+
+void GpuTimer::create() {
+    // Queries are created lazily because the timer may be constructed before the GL context exists
+    for (FrameQueries& frame : frames) {
+        glGenQueries(1, &frame.start);
+        glGenQueries(MAX_SECTIONS, frame.sections);
+        frame.pending = false;
+        frame.tag = 0;
+        for (bool& recorded : frame.recorded) {
+            recorded = false;
+        }
+    }
+    created = true;
+}
+
+void GpuTimer::beginFrame(uint32_t tag) {
+    if (!created) {
+        create();
+    }
+    collect();
+
+    current = (current + 1) % LATENCY;
+    FrameQueries& frame = frames[current];
+
+    // The GPU is more than LATENCY frames behind, don't time this frame rather than waiting
+    skipFrame = frame.pending;
+    inFrame = true;
+    if (skipFrame) {
+        return;
+    }
+
+    frame.tag = tag;
+    for (bool& recorded : frame.recorded) {
+        recorded = false;
+    }
+    glQueryCounter(frame.start, GL_TIMESTAMP);
+}
+
+void GpuTimer::endSection(int section) {
+    if (!inFrame || skipFrame || section < 0 || section >= MAX_SECTIONS) {
+        return;
+    }
+    FrameQueries& frame = frames[current];
+    glQueryCounter(frame.sections[section], GL_TIMESTAMP);
+    frame.recorded[section] = true;
+}
+
+void GpuTimer::endFrame() {
+    if (inFrame && !skipFrame) {
+        frames[current].pending = true;
+    }
+    inFrame = false;
+}
+
+bool GpuTimer::takeNewResult() {
+    bool fresh = freshResult;
+    freshResult = false;
+    return fresh;
+}
+
+void GpuTimer::collect() {
+    // Walk the ring oldest first and stop at the first frame that isn't finished, later ones can't be either
+    for (int k = 1; k <= LATENCY; ++k) {
+        FrameQueries& frame = frames[(current + k) % LATENCY];
+        if (!frame.pending) {
+            continue;
+        }
+
+        GLuint lastQuery = frame.start;
+        for (int s = 0; s < MAX_SECTIONS; ++s) {
+            if (frame.recorded[s]) {
+                lastQuery = frame.sections[s];
+            }
+        }
+
+        GLint available = 0;
+        glGetQueryObjectiv(lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+
+        GLuint64 start = 0;
+        glGetQueryObjectui64v(frame.start, GL_QUERY_RESULT, &start);
+        GLuint64 previous = start;
+        for (int s = 0; s < MAX_SECTIONS; ++s) {
+            if (!frame.recorded[s]) {
+                lastSectionMs[s] = 0.0f;
+                continue;
+            }
+            GLuint64 stamp = 0;
+            glGetQueryObjectui64v(frame.sections[s], GL_QUERY_RESULT, &stamp);
+            lastSectionMs[s] = (float) (stamp - previous) / 1.0e6f;
+            previous = stamp;
+        }
+        lastTotalMs = (float) (previous - start) / 1.0e6f;
+        lastTag = frame.tag;
+        resultValid = true;
+        freshResult = true;
+        frame.pending = false;
+    }
+}
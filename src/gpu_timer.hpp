@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <GL/glew.h>
+
+// Per-frame GPU section timings from GL_TIMESTAMP queries. Results are read back a few frames late so the CPU never
+// waits on the GPU. A frame records a start timestamp plus one timestamp at the end of each section; sections that
+// were skipped in a frame report 0. Sections must be ended in increasing index order.
+class GpuTimer {
+public:
+    static const int MAX_SECTIONS = 8;
+    static const int LATENCY = 4;   // frames in flight before a slot is reused
+
+    GpuTimer();
+
+    // Deletes the query objects, must be called while the context is still current
+    void release();
+
+    // tag is returned with the result so callers can tell which configuration a late result belongs to
+    void beginFrame(uint32_t tag = 0);
+    void endSection(int section);
+    void endFrame();
+
+    bool hasResult() const { return resultValid; }
+    // True once for every frame result that arrived since the last call
+    bool takeNewResult();
+    uint32_t resultTag() const { return lastTag; }
+    float sectionMs(int section) const { return lastSectionMs[section]; }
+    float totalMs() const { return lastTotalMs; }
+
+private:
+    struct FrameQueries {
+        GLuint start;
+        GLuint sections[MAX_SECTIONS];
+        bool recorded[MAX_SECTIONS];
+        bool pending;
+        uint32_t tag;
+    };
+
+    FrameQueries frames[LATENCY];
+    int current;
+    bool created;
+    bool inFrame;
+    bool skipFrame;
+
+    bool resultValid;
+    bool freshResult;
+    uint32_t lastTag;
+    float lastSectionMs[MAX_SECTIONS];
+    float lastTotalMs;
+
+    void create();
+    void collect();
+};
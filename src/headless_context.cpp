@@ -0,0 +1,123 @@
+#include "headless_context.hpp"
+#include <cstring>
+#include <iostream>
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions) {
+        return false;
+    }
+    size_t length = std::strlen(name);
+    for (const char* found = std::strstr(extensions, name); found; found = std::strstr(found + length, name)) {
+        if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+HeadlessContext::HeadlessContext() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT) {}
+
+bool HeadlessContext::create(int major, int minor) {
+    // The surfaceless platform needs neither X11, Wayland nor a render node's display
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (eglDisplay == EGL_NO_DISPLAY) {
+        std::cout << "[WARNING][HeadlessContext] No surfaceless platform, using the default EGL display" << std::endl;
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint eglMajor = 0, eglMinor = 0;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &eglMajor, &eglMinor)) {
+        std::cout << "[ERROR][HeadlessContext] Couldn't initialise EGL: 0x" << std::hex << eglGetError() << std::dec
+                  << std::endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    const char* extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+    if (!hasExtension(extensions, "EGL_KHR_surfaceless_context")) {
+        std::cout << "[ERROR][HeadlessContext] EGL_KHR_surfaceless_context isn't supported" << std::endl;
+        release();
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "[ERROR][HeadlessContext] Desktop OpenGL isn't supported by EGL" << std::endl;
+        release();
+        return false;
+    }
+
+    // Rendering only goes to framebuffer objects, so any config that can do desktop GL will do. The surfaceless
+    // platform only offers pbuffer configs, without EGL_KHR_no_config_context one of those is picked.
+    EGLConfig config = (EGLConfig) 0;
+    if (!hasExtension(extensions, "EGL_KHR_no_config_context")) {
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLint configCount = 0;
+        if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            std::cout << "[ERROR][HeadlessContext] No EGL config for desktop OpenGL" << std::endl;
+            release();
+            return false;
+        }
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        std::cout << "[ERROR][HeadlessContext] Couldn't create an OpenGL " << major << "." << minor
+                  << " core context: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        release();
+        return false;
+    }
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext) context)) {
+        std::cout << "[ERROR][HeadlessContext] Couldn't make the context current: 0x" << std::hex << eglGetError()
+                  << std::dec << std::endl;
+        release();
+        return false;
+    }
+
+    std::cout << "[INFO][HeadlessContext] EGL " << eglMajor << "." << eglMinor << " ("
+              << eglQueryString(eglDisplay, EGL_VENDOR) << ")" << std::endl;
+    return true;
+}
+
+void HeadlessContext::release() {
+    if (display == EGL_NO_DISPLAY) {
+        return;
+    }
+    eglMakeCurrent((EGLDisplay) display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT) {
+        eglDestroyContext((EGLDisplay) display, (EGLContext) context);
+    }
+    eglTerminate((EGLDisplay) display);
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+}
+
+#else
+
+HeadlessContext::HeadlessContext() : display(nullptr), context(nullptr) {}
+
+bool HeadlessContext::create(int, int) {
+    std::cout << "[ERROR][HeadlessContext] Built without EGL, headless rendering isn't available" << std::endl;
+    return false;
+}
+
+void HeadlessContext::release() {}
+
+#endif
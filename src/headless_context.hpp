@@ -0,0 +1,20 @@
+#pragma once
+
+// An OpenGL 3.3 core context without a window or display server, for rendering frames to disk.
+//
+// Uses EGL on Mesa's surfaceless platform (EGL_MESA_platform_surfaceless), which works with the llvmpipe software
+// rasteriser, and falls back to the default EGL display. No default framebuffer exists, everything has to be drawn
+// into a framebuffer object. Only available when built with EGL (HEADLESS_EGL), create() fails otherwise.
+class HeadlessContext {
+public:
+    HeadlessContext();
+
+    // Creates the context and makes it current on the calling thread
+    bool create(int major = 3, int minor = 3);
+    void release();
+
+private:
+    // EGLDisplay and EGLContext, kept opaque so the EGL headers stay out of this one
+    void* display;
+    void* context;
+};
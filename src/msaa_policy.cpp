@@ -0,0 +1,68 @@
+#include "msaa_policy.hpp"
+#include <algorithm>
+
+static const float SMOOTHING = 0.1f;
+// Assumed cost of one step up without a measurement. Doubling the samples rarely doubles the frame, only edges are
+// shaded more than once, but depth/colour bandwidth and the resolve grow with it.
+static const float STEP_COST = 1.5f;
+
+static int levelOf(int samples) {
+    int level = 0;
+    while (level + 1 < MsaaPolicy::LEVELS && (2 << level) <= samples) {
+        level++;
+    }
+    return level;
+}
+
+int MsaaPolicy::decide(int maxSamples) {
+    frame++;
+    int maxLevel = levelOf(std::max(maxSamples, 1));
+    for (int i = 0; i < LEVELS; ++i) {
+        if (measured[i] > 0.0f && frame - measuredFrame[i] > (uint32_t) staleFrames) {
+            measured[i] = 0.0f;
+        }
+    }
+
+    if (fixedSamples > 0) {
+        level = std::min(levelOf(fixedSamples), maxLevel);
+        overBudget = 0;
+        return samples();
+    }
+
+    level = std::min(level, maxLevel);
+    float current = measured[level];
+    if (current <= 0.0f) {
+        // Nothing to go on until the first result for this count arrives
+        return samples();
+    }
+
+    if (overBudget >= downgradeResults && level > 0) {
+        level--;
+        overBudget = 0;
+    } else if (level < maxLevel) {
+        float next = measured[level + 1] > 0.0f ? measured[level + 1] : current * STEP_COST;
+        if (next < budgetMs * upgradeFraction) {
+            level++;
+            overBudget = 0;
+        }
+    }
+    return samples();
+}
+
+void MsaaPolicy::reportTiming(int sampleCount, float gpuMs) {
+    if (gpuMs <= 0.0f) {
+        return;
+    }
+    int index = levelOf(sampleCount);
+    measured[index] = measured[index] == 0.0f ? gpuMs : measured[index] + (gpuMs - measured[index]) * SMOOTHING;
+    measuredFrame[index] = frame;
+
+    // Late results for a count that's no longer used don't count against the current one
+    if (index == level) {
+        overBudget = measured[index] > budgetMs ? overBudget + 1 : 0;
+    }
+}
+
+float MsaaPolicy::measuredMs(int sampleCount) const {
+    return measured[levelOf(sampleCount)];
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+// Picks the scene framebuffer's MSAA sample count from the GPU time the scene is allowed to take.
+//
+// Every GPU timer result is filed under the sample count it was rendered with, so each count (1, 2, 4, 8) keeps its own
+// moving average cost. In auto mode the count drops one step once the current one stayed over budgetMs for a few
+// results, and rises one step while the next count fits into upgradeFraction of the budget: by its own measurement if
+// it has a recent one, otherwise by the current cost scaled with an assumed per-step increase. A count that was just
+// dropped for being too slow keeps its measurement, so it isn't retried until that goes stale. Without results the
+// count stays where it is, so don't report timer totals that can't see the scene.
+class MsaaPolicy {
+public:
+    static const int LEVELS = 4;        // 1x, 2x, 4x, 8x
+
+    int fixedSamples = 0;               // 0 for auto, otherwise the count to use (clamped to what's supported)
+    float budgetMs = 12.0f;             // scene GPU time allowed, the rest of a 60 Hz frame is left to the UI
+    float upgradeFraction = 0.75f;
+    int downgradeResults = 8;           // results over budget in a row before stepping down
+    int staleFrames = 600;              // measurements older than this are forgotten
+
+    // Once per frame, before the framebuffer is bound. maxSamples is the largest count the framebuffer supports.
+    int decide(int maxSamples);
+    // GPU time of a frame rendered with the given sample count
+    void reportTiming(int samples, float gpuMs);
+
+    int samples() const { return 1 << level; }
+    // Moving average cost of a sample count, 0 without a recent measurement
+    float measuredMs(int samples) const;
+
+private:
+    int level = 0;
+    int overBudget = 0;
+    uint32_t frame = 0;
+    float measured[LEVELS] = {};
+    uint32_t measuredFrame[LEVELS] = {};
+};
@@ -4,9 +4,15 @@
 
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
 
 #include <GL/glew.h>
 #include <glfw/glfw3.h>
@@ -17,6 +23,28 @@
 #include "imgui_impl_opengl3.h"
 
 #include "mesh.hpp"
+#include "shader_program.hpp"
+#include "program_cache.hpp"
+#include "shader_build.hpp"
+#include "shader_variants.hpp"
+#include "render_queue.hpp"
+#include "depth_prepass.hpp"
+#include "msaa_policy.hpp"
+#include "frame_governor.hpp"
+#include "gpu_timer.hpp"
+#include "occlusion.hpp"
+#include "transform_batch.hpp"
+#include "bezier_curve.hpp"
+#include "curve_cache.hpp"
+#include "curve_bvh.hpp"
+#include "curve_renderer.hpp"
+#include "overlay_renderer.hpp"
+#include "piecewise_path.hpp"
+#include "rotation_spline.hpp"
+#include "animation_tracks.hpp"
+#include "scene_framebuffer.hpp"
+#include "headless_context.hpp"
+#include "frame_capture.hpp"
 
 using namespace std;
 using namespace glm;
@@ -24,71 +52,52 @@ using namespace glm;
 const GLint WIDTH = 800;
 const GLint HEIGHT = 600;
 
-enum class ShaderType
-{
-    NONE = -1,
-    VERTEX = 0,
-    FRAGMENT = 1
-};
-
 GLuint VAO;
 GLuint VBO;
-GLuint FBO;
-GLuint RBO;
-GLuint texture_id;
 GLuint shader;
 
-/*
-    ImGUI setup functions
-*/
-
-void create_framebuffer()
-{
-	glGenFramebuffers(1, &FBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-
-	glGenTextures(1, &texture_id);
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, WIDTH, HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_id, 0);
-
-	glGenRenderbuffers(1, &RBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WIDTH, HEIGHT);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
-
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n";
-
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindRenderbuffer(GL_RENDERBUFFER, 0);
-}
-
-void bind_framebuffer()
-{
-	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-}
-
-void unbind_framebuffer()
-{
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-void rescale_framebuffer(float width, float height)
-{
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_id, 0);
-
-	glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
-}
+// Uniform names, hashed at compile time
+constexpr uint32_t U_MODEL = fnv1a("u_model");
+constexpr uint32_t U_MVP = fnv1a("u_mvp");
+constexpr uint32_t U_NORMAL_MATRIX = fnv1a("u_normalMatrix");
+constexpr uint32_t U_VIEW_PROJ = fnv1a("u_viewProj");
+constexpr uint32_t U_OBJ_COLOR = fnv1a("u_objColor");
+constexpr uint32_t U_LIGHT_COLOR = fnv1a("u_lightColor");
+constexpr uint32_t U_LIGHT_POS = fnv1a("u_lightPos");
+constexpr uint32_t U_CAM_POS = fnv1a("u_camPos");
+
+// GPU timer sections, in the order they are rendered
+const int GPU_SECTION_PREPASS = 0;
+const int GPU_SECTION_COLOR = 1;
+const int GPU_SECTION_RESOLVE = 2;
+// Below this the pre-pass and colour sections are taken to have missed the scene's work. Software rasterisers such as
+// llvmpipe draw at the next flush, so every timestamp between draws reads about the same and the cost lands in
+// whichever section flushes (the resolve). The adaptive policies then ignore the timer and use frame times or nothing.
+const float GPU_BLIND_SCENE_MS = 0.05f;
+// Sample count of a headless run without --msaa
+const int HEADLESS_MSAA_SAMPLES = 4;
+
+// Dense overlap scene: layers of spheres stacked in front of the camera
+bool overlapStressScene = false;
+int overlapStressLayers = 16;
+
+// Cubes animated by keyframe tracks, built the first time they're needed
+bool animatedCrowd = false;
+int crowdSize = 256;
+bool quantisedCrowdTracks = true;
+
+bool occlusionCulling = true;
+// Objects smaller than this on screen use the shader variant without specular
+float specularLodPixels = 24.0f;
+bool adaptiveOverlay = true;
+bool constantSpeedPaths = true;
+// The object follows a piecewise cubic path through its control points, or one Bezier of all of them
+bool piecewiseObjectPath = true;
+PathBasis objectPathBasis = PathBasis::B_SPLINE;
+// The object's path drawn into the scene, evaluated on the GPU
+bool drawPathInScene = true;
+bool tessellatePath = false;
+float overlayTolerancePixels = 0.25f;
 
 /*
     Bezier curve default control points
@@ -133,220 +142,330 @@ std::vector<glm::quat> rotationControlPoints = {
     glm::quat(glm::vec3(0.0f, 0.0f, glm::radians(172.0f)))  // Rotate 45 degrees around the z-axis
 };
 
-// This is a cubic Bezier curve function
-glm::vec3 bezier(float scaler, const glm::vec3* controlPoints) {
-    float scaler_coeff = 1.0f - scaler;
-    float scaler_squared = scaler * scaler;
-    float scaler_coeff_squared = scaler_coeff * scaler_coeff;
-    float scaler_coeff_cubed = scaler_coeff_squared * scaler_coeff;
-    float scaler_cubed = scaler_squared * scaler;
-
-    glm::vec3 point = scaler_coeff_cubed * controlPoints[0]; // (1-t)^3 * P0
-    point += 3 * scaler_coeff_squared * scaler * controlPoints[1];   // 3 * (1-t)^2 * t * P1
-    point += 3 * scaler_coeff * scaler_squared * controlPoints[2];   // 3 * (1-t) * t^2 * P2
-    point += scaler_cubed * controlPoints[3];          // t^3 * P3
+// Bumped by every edit of the control points above, cached curves only rebuild when these change
+uint32_t controlPointsVersion = 1;
+uint32_t cameraControlPointsVersion = 1;
+uint32_t rotationControlPointsVersion = 1;
 
-    return point;
-}
+void showBezierControlPoints(const CachedCurve& overlayCurve, const PiecewisePath& objectPath,
+                             const CurveRenderer& curveRenderer, const OverlayStats& overlayStats) {
+    ImGui::Begin("Bezier Control Points");
 
-std::vector<glm::vec3> generateBezierCurve(const glm::vec3* controlPoints, int numPoints) {
-    std::vector<glm::vec3> curvePoints;
-    for (int i = 0; i <= numPoints; ++i) {
-        float t = (float)i / (float)numPoints;
-        curvePoints.push_back(bezier(t, controlPoints));
+    // Labels are formatted on the stack, this window is built every frame
+    char label[48];
+    for (int i = 0; i < (int) controlPoints.size(); ++i) {
+        std::snprintf(label, sizeof(label), "Control Point %d", i);
+        if (ImGui::SliderFloat3(label, &controlPoints[i].x, 0.0f, 4.0f)) {
+            controlPointsVersion++;
+        }
     }
-    return curvePoints;
-}
 
-glm::vec3 calculateBezierPoint(float t, const std::vector<glm::vec3>& controlPoints) {
-    size_t n = controlPoints.size() - 1;
-    glm::vec3 point(0.0f);
-    for (size_t i = 0; i <= n; ++i) {
-        float binomialCoeff = static_cast<float>(tgamma(n + 1) / (tgamma(i + 1) * tgamma(n - i + 1)));
-        float powT = glm::pow(t, i);
-        float powOneMinusT = glm::pow(1 - t, n - i);
-        point += binomialCoeff * powT * powOneMinusT * controlPoints[i];
+    for (int i = 0; i < (int) cameraControlPoints.size(); ++i) {
+        std::snprintf(label, sizeof(label), "Camera Control Point %d", i);
+        if (ImGui::SliderFloat3(label, &cameraControlPoints[i].x, 0.0f, 4.0f)) {
+            cameraControlPointsVersion++;
+        }
     }
-    return point;
-}
 
-glm::quat slerp(float t, const std::vector<glm::quat>& controlPoints) {
-    size_t n = controlPoints.size() - 1;
-    glm::quat result = controlPoints[0];
-    for (size_t i = 1; i <= n; ++i) {
-        float binomialCoeff = static_cast<float>(tgamma(n + 1) / (tgamma(i + 1) * tgamma(n - i + 1)));
-        float powT = glm::pow(t, i);
-        float powOneMinusT = glm::pow(1 - t, n - i);
-        result = glm::slerp(result, controlPoints[i], binomialCoeff * powT * powOneMinusT);
+    for (int i = 0; i < (int) rotationControlPoints.size(); ++i) {
+        std::snprintf(label, sizeof(label), "Rotation Control Point %d", i);
+        if (ImGui::SliderAngle(label, &rotationControlPoints[i].x)) {
+            rotationControlPointsVersion++;
+        }
     }
-    return result;
-}
 
-void showBezierControlPoints() {
-    ImGui::Begin("Bezier Control Points");
-
-    for (int i = 0; i < controlPoints.size(); ++i) {
-        ImGui::SliderFloat3(("Control Point " + std::to_string(i)).c_str(), &controlPoints[i].x, 0.0f, 4.0f);
+    const char* pathTypes[] = { "Single Bezier", "Cubic B-spline", "Catmull-Rom" };
+    int pathType = piecewiseObjectPath ? (objectPathBasis == PathBasis::B_SPLINE ? 1 : 2) : 0;
+    if (ImGui::Combo("Object path", &pathType, pathTypes, 3)) {
+        piecewiseObjectPath = pathType != 0;
+        objectPathBasis = pathType == 2 ? PathBasis::CATMULL_ROM : PathBasis::B_SPLINE;
     }
-
-    for (int i = 0; i < cameraControlPoints.size(); ++i) {
-        ImGui::SliderFloat3(("Camera Control Point " + std::to_string(i)).c_str(), &cameraControlPoints[i].x, 0.0f, 4.0f);
+    if (piecewiseObjectPath) {
+        const PathStats& pathStats = objectPath.stats();
+        ImGui::Text("%u segments, %u rebuilt by the last edit, length %.2f", pathStats.segments,
+                    pathStats.rebuiltSegments, objectPath.length());
     }
-
-    for (int i = 0; i < rotationControlPoints.size(); ++i) {
-        ImGui::SliderAngle(("Rotation Control Point " + std::to_string(i)).c_str(), &rotationControlPoints[i].x);
+    ImGui::Checkbox("Draw path in scene", &drawPathInScene);
+    if (curveRenderer.tessellationSupported()) {
+        ImGui::SameLine();
+        ImGui::Checkbox("Tessellation shaders", &tessellatePath);
+    }
+    const CurveRenderStats& curveStats = curveRenderer.stats();
+    ImGui::Text("Path: %u points evaluated on the GPU%s, %u uploads", curveStats.vertices,
+                curveStats.tessellated ? " (tessellated)" : "", curveStats.uploads);
+    ImGui::Checkbox("Constant speed along paths", &constantSpeedPaths);
+    ImGui::Checkbox("Adaptive overlay", &adaptiveOverlay);
+    if (adaptiveOverlay) {
+        ImGui::SliderFloat("Overlay tolerance (px)", &overlayTolerancePixels, 0.05f, 2.0f, "%.2f");
     }
+    ImGui::Text("Overlay curve version %u, %zu points, %llu points evaluated", overlayCurve.version(),
+                overlayCurve.tessellationSize(), (unsigned long long)overlayCurve.evaluations());
+    ImGui::Text("Overlay drawing: %u segments, %u culled, %u vertices in %u reservations", overlayStats.segments,
+                overlayStats.culled, overlayStats.vertices, overlayStats.reservations);
+    ImGui::Text("Curve kernels: %s", CurveKernelName());
 
     ImGui::End();
 }
 
-ImU32 HSVtoRGB(float h, float s, float v) {
-    float r, g, b;
-
-    int i = int(h * 6);
-    float f = h * 6 - i;
-    float p = v * (1 - s);
-    float q = v * (1 - f * s);
-    float t = v * (1 - (1 - f) * s);
-
-    switch (i % 6) {
-        case 0: r = v, g = t, b = p; break;
-        case 1: r = q, g = v, b = p; break;
-        case 2: r = p, g = v, b = t; break;
-        case 3: r = p, g = q, b = v; break;
-        case 4: r = t, g = p, b = v; break;
-        case 5: r = v, g = p, b = q; break;
+void showRenderStats(RenderQueue& queue, DepthPrepassPolicy& depthPrepass, MsaaPolicy& msaaPolicy,
+                     FrameGovernor& governor, const GpuTimer& gpuTimer, const OcclusionCuller& occlusionCuller, const ShaderBuildService& shaderBuild,
+                     const TransformBatch& transforms, const SceneFramebuffer& sceneFramebuffer,
+                     FrameCapture& frameCapture, const TrackStats& crowdTracks) {
+    ImGui::Begin("Render Stats");
+
+    ImGui::Text("Frame time: %.2f ms (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::Checkbox("Frame governor", &governor.enabled);
+    ImGui::SliderFloat("Frame budget (ms)", &governor.budgetMs, 4.0f, 50.0f);
+    const QualitySettings& quality = governor.settings();
+    ImGui::Text("Quality %d/%d, p%d %.2f ms: %.0f%% resolution, %d curve segments, LOD bias %.1f", governor.level(),
+                governor.levels() - 1, (int)(governor.percentile * 100.0f), governor.percentileMs(),
+                quality.resolutionScale * 100.0f, quality.curveSegments, quality.lodBias);
+    ImGui::Text("Queued draws: %d", (int)queue.size());
+    const FramebufferStats& framebuffer = sceneFramebuffer.frameStats();
+    ImGui::Text("Scene target: %dx%d in %dx%d, %u reallocations", framebuffer.width, framebuffer.height,
+                framebuffer.allocatedWidth, framebuffer.allocatedHeight, framebuffer.reallocations);
+    const TransformStats& transformStats = transforms.stats();
+    ImGui::Text("Transforms: %u objects, %u models and %u MVPs recomputed", transformStats.objects,
+                transformStats.modelsUpdated, transformStats.mvpsUpdated);
+    ImGui::Separator();
+
+    for (int i = 0; i < (int)RenderPass::COUNT; ++i) {
+        RenderPass pass = (RenderPass)i;
+        const RenderPassStats& stats = queue.stats(pass);
+        ImGui::Text("%s: %u/%u drawn, %u dropped, %u program binds, %u VAO binds", renderPassName(pass),
+                    stats.drawn, stats.submitted, stats.dropped, stats.programBinds, stats.vaoBinds);
+
+        // Pre-pass draws are linked to their opaque draw and follow its cap
+        if (pass == RenderPass::DEPTH_PREPASS) {
+            continue;
+        }
+        // 0 means no cap
+        int cap = queue.passCap(pass) == RenderQueue::NO_CAP ? 0 : (int)queue.passCap(pass);
+        ImGui::PushID(i);
+        if (ImGui::SliderInt("Draw cap", &cap, 0, 1000)) {
+            queue.setPassCap(pass, cap == 0 ? RenderQueue::NO_CAP : (uint32_t)cap);
+        }
+        ImGui::PopID();
     }
 
-    return IM_COL32(int(r * 255), int(g * 255), int(b * 255), 255);
-}
-
-std::string ParseShader(const std::string& filepath)
-{
-    std::ifstream stream(filepath);
-    std::string line;
-    std::stringstream ss;
-
-    if (stream.fail())
-    {
-        std::cout << "[ERROR][ParseShader] The filepath  \"" << filepath << "\" doesn't exist." << std::endl;
+    ImGui::Separator();
+    const char* modes[] = { depthPrepassModeName(DepthPrepassMode::OFF), depthPrepassModeName(DepthPrepassMode::ON),
+                            depthPrepassModeName(DepthPrepassMode::AUTO) };
+    int mode = (int)depthPrepass.mode;
+    if (ImGui::Combo("Depth pre-pass", &mode, modes, 3)) {
+        depthPrepass.mode = (DepthPrepassMode)mode;
     }
-
-    while (getline(stream, line))    // parse the shader file line by line
-    {
-        ss << line << '\n';
+    ImGui::Text("Estimated overdraw: %.2f, pre-pass %s", depthPrepass.estimatedOverdraw(),
+                depthPrepass.enabled() ? "on" : "off");
+    if (gpuTimer.hasResult()) {
+        ImGui::Text("GPU pre-pass: %.3f ms, colour: %.3f ms, resolve: %.3f ms, total: %.3f ms",
+                    gpuTimer.sectionMs(GPU_SECTION_PREPASS), gpuTimer.sectionMs(GPU_SECTION_COLOR),
+                    gpuTimer.sectionMs(GPU_SECTION_RESOLVE), gpuTimer.totalMs());
     }
-
-    return ss.str();
-}
-
-void CheckShaderStatus(unsigned int shaderID, unsigned int status)
-{
-    int success;
-    char infoLog[512];
-    glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(shaderID, 512, NULL, infoLog);
-        std::cout << "[ERROR] Shader failed.\n" << infoLog << std::endl;
+    ImGui::Text("Measured with pre-pass: %.3f ms, without: %.3f ms", depthPrepass.measuredMs(true),
+                depthPrepass.measuredMs(false));
+
+    ImGui::Separator();
+    const char* msaaModes[] = { "Auto", "Off", "2x", "4x", "8x" };
+    int msaaMode = msaaPolicy.fixedSamples == 0 ? 0 : 1;
+    while (msaaMode > 0 && (1 << msaaMode) <= msaaPolicy.fixedSamples) {
+        msaaMode++;
     }
-}
-
-unsigned int CreateShader(ShaderType shaderType, const std::string& filepath)
-{
-    std::string shaderSrc = ParseShader(filepath);
-    const char* shaderSrcCStr = shaderSrc.c_str();      // convert string to the format that OpenGL use
-
-    unsigned int shaderID = 0;
-    switch (shaderType)
-    {
-    case ShaderType::VERTEX:
-        shaderID = glCreateShader(GL_VERTEX_SHADER);    // generate an id for this shader
-        break;
-    case ShaderType::FRAGMENT:
-        shaderID = glCreateShader(GL_FRAGMENT_SHADER);
-        break;
-    default:
-        std::cout << "[Error] Invalid shader type " << (int)shaderType << std::endl;
-        break;
+    if (ImGui::Combo("MSAA", &msaaMode, msaaModes, 5)) {
+        msaaPolicy.fixedSamples = msaaMode == 0 ? 0 : 1 << (msaaMode - 1);
     }
-
-    glShaderSource(shaderID, 1, &shaderSrcCStr, NULL);  // load shader data from file          
-    glCompileShader(shaderID);                          // compile shader
-    CheckShaderStatus(shaderID, GL_COMPILE_STATUS);     // error check
-
-    return shaderID;
-}
-
-int GetUniformLocation(unsigned int shaderProgramID, const std::string& name)
-{
-    int location = glGetUniformLocation(shaderProgramID, name.c_str());   // send data to the vertex shader
-
-    if (location == -1)
-    {
-        std::cout << "Warning: uniform \""<< name << "\" doesn't exist or unused!" << std::endl;
+    ImGui::SliderFloat("MSAA GPU budget (ms)", &msaaPolicy.budgetMs, 1.0f, 33.0f);
+    ImGui::Text("%dx in use, measured 1x: %.3f ms, 2x: %.3f ms, 4x: %.3f ms, 8x: %.3f ms", msaaPolicy.samples(),
+                msaaPolicy.measuredMs(1), msaaPolicy.measuredMs(2), msaaPolicy.measuredMs(4), msaaPolicy.measuredMs(8));
+
+    ImGui::Separator();
+    ImGui::Checkbox("Occlusion culling", &occlusionCulling);
+    OcclusionStats occlusion = occlusionCuller.stats();
+    ImGui::Text("Culled %.1f%% of %u objects (%u frustum, %u occluded), %.3f ms CPU", occlusion.culledPercent(),
+                occlusion.tested, occlusion.frustumCulled, occlusion.occlusionCulled, occlusion.cpuMs);
+
+    ImGui::Checkbox("Overlap stress scene", &overlapStressScene);
+    ImGui::SliderInt("Overlap layers", &overlapStressLayers, 1, 64);
+
+    ImGui::Checkbox("Animated crowd", &animatedCrowd);
+    ImGui::SliderInt("Crowd size", &crowdSize, 1, 4096);
+    ImGui::Checkbox("Quantised tracks (new entities)", &quantisedCrowdTracks);
+    ImGui::Text("Tracks: %u with %u keys in %.1f KB, %u cursor hits, %u searches", crowdTracks.tracks,
+                crowdTracks.keys, crowdTracks.bytes / 1024.0f, crowdTracks.cursorHits, crowdTracks.searches);
+
+    ImGui::Separator();
+    ShaderBuildStats build = shaderBuild.stats();
+    ImGui::Text("Shaders: %u programs, %u building, %u reloads, %u failed (%s compile)", build.programs, build.building,
+                build.reloads, build.failures, build.parallel ? "parallel" : "serial");
+    ImGui::SliderFloat("No specular below (px)", &specularLodPixels, 0.0f, 200.0f);
+
+    ImGui::Separator();
+    if (!frameCapture.active()) {
+        if (ImGui::Button("Record scene")) {
+            // Frames are only read back while recording, the writer drops frames rather than slowing the UI down
+            frameCapture.start("captures/scene_" + std::to_string(std::time(nullptr)) + ".y4m", CaptureFormat::Y4M);
+        }
+    } else {
+        if (ImGui::Button("Stop recording")) {
+            frameCapture.stop();
+        }
+        CaptureStats capture = frameCapture.stats();
+        ImGui::Text("%s: %u written, %u queued, %u dropped", frameCapture.path().c_str(), capture.written,
+                    capture.queued, capture.dropped);
+        ImGui::Text("Readback %.2f ms, encode %.2f ms", capture.captureMs, capture.encodeMs);
     }
 
-    return location;
+    ImGui::End();
 }
 
 GLuint secondVaoID, secondVboID, secondIboID;
 
-int main()
+int main(int argc, char** argv)
 {
-	if (!glfwInit()) {
-		std::cout << "GLFW initialisation failed!\n";
-		glfwTerminate();
-		return 1;
-	}
+    // Measured up to the first swap so cold and warm program cache starts can be compared
+    auto startTime = std::chrono::steady_clock::now();
+
+    bool useProgramCache = true;
+    bool hotReload = true;
+    bool shadersFromDisk = false;
+    bool headless = false;
+    int headlessFrames = 120;
+    int headlessWidth = WIDTH;
+    int headlessHeight = HEIGHT;
+    std::string frameDirectory = "frames";
+    CaptureFormat headlessFormat = CaptureFormat::PPM;
+    bool headlessCapture = true;
+    int msaaSamples = 0;
+    bool headlessGovernor = false;
+    DepthPrepassMode prepassMode = DepthPrepassMode::AUTO;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--no-program-cache") == 0) {
+            useProgramCache = false;
+        } else if (std::strcmp(argv[i], "--no-hot-reload") == 0) {
+            hotReload = false;
+        } else if (std::strcmp(argv[i], "--shaders-from-disk") == 0) {
+            shadersFromDisk = true;
+        } else if (std::strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            headlessFrames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &headlessWidth, &headlessHeight) != 2 || headlessWidth <= 0
+                || headlessHeight <= 0) {
+                std::cout << "[ERROR][main] --size expects WIDTHxHEIGHT, e.g. 1920x1080" << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            frameDirectory = argv[++i];
+        } else if (std::strcmp(argv[i], "--msaa") == 0 && i + 1 < argc) {
+            msaaSamples = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--y4m") == 0) {
+            headlessFormat = CaptureFormat::Y4M;
+        } else if (std::strcmp(argv[i], "--no-capture") == 0) {
+            headlessCapture = false;
+        } else if (std::strcmp(argv[i], "--governor") == 0) {
+            headlessGovernor = true;
+        } else if (std::strcmp(argv[i], "--depth-prepass") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "off") == 0) {
+                prepassMode = DepthPrepassMode::OFF;
+            } else if (std::strcmp(argv[i], "on") == 0) {
+                prepassMode = DepthPrepassMode::ON;
+            } else if (std::strcmp(argv[i], "auto") == 0) {
+                prepassMode = DepthPrepassMode::AUTO;
+            } else {
+                std::cout << "[ERROR][main] --depth-prepass expects off, on or auto" << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--overlap-stress") == 0 && i + 1 < argc) {
+            overlapStressScene = true;
+            overlapStressLayers = std::max(std::atoi(argv[++i]), 1);
+        }
+    }
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    // Headless runs render the same scene through the same framebuffer, only without a window or UI, and write
+    // every frame to disk unless --no-capture
+    HeadlessContext headlessContext;
+    FrameCapture frameCapture;
+    GLFWwindow* mainWindow = nullptr;
+    if (headless) {
+        if (!headlessContext.create(3, 3)) {
+            return 1;
+        }
+        // Waits for the writer instead of dropping frames, every frame of the run ends up on disk
+        std::string capturePath = headlessFormat == CaptureFormat::Y4M
+                                  ? (std::filesystem::path(frameDirectory) / "scene.y4m").string() : frameDirectory;
+        if (headlessCapture && !frameCapture.start(capturePath, headlessFormat, 60, false)) {
+            headlessContext.release();
+            return 1;
+        }
+    } else {
+        if (!glfwInit()) {
+            std::cout << "GLFW initialisation failed!\n";
+            glfwTerminate();
+            return 1;
+        }
 
-	// Create the window
-	GLFWwindow *mainWindow = glfwCreateWindow(WIDTH, HEIGHT, "My Window", NULL, NULL);
-	if (!mainWindow)
-	{
-		std::cout << "GLFW creation failed!\n";
-		glfwTerminate();
-		return 1;
-	}
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+
+        // Create the window
+        mainWindow = glfwCreateWindow(WIDTH, HEIGHT, "My Window", NULL, NULL);
+        if (!mainWindow)
+        {
+            std::cout << "GLFW creation failed!\n";
+            glfwTerminate();
+            return 1;
+        }
 
-	int bufferWidth, bufferHeight;
-	glfwGetFramebufferSize(mainWindow, &bufferWidth, &bufferHeight);
-	glfwMakeContextCurrent(mainWindow);
+        glfwMakeContextCurrent(mainWindow);
+    }
 	glewExperimental = GL_TRUE;
 
-	if (glewInit() != GLEW_OK) {
+    // A GLEW built for GLX loads the GL entry points and then fails to find an X display, which an EGL context
+    // doesn't need
+	GLenum glewStatus = glewInit();
+	if (glewStatus != GLEW_OK && !(headless && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)) {
 		std::cout << "glew initialisation failed!\n";
-		glfwDestroyWindow(mainWindow);
-		glfwTerminate();
+		if (headless) {
+			headlessContext.release();
+		} else {
+			glfwDestroyWindow(mainWindow);
+			glfwTerminate();
+		}
 		return 1;
 	}
 
-	glViewport(0, 0, bufferWidth, bufferHeight);
+	if (!headless) {
+		int bufferWidth, bufferHeight;
+		glfwGetFramebufferSize(mainWindow, &bufferWidth, &bufferHeight);
+		glViewport(0, 0, bufferWidth, bufferHeight);
+	}
 
-	create_framebuffer();
+    // The scene is rendered offscreen and shown as an image in the "My Scene" window
+    SceneFramebuffer sceneFramebuffer;
 
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
-    io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard; 
-    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-    io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable; 
-
-    ImGui::StyleColorsDark();
-    ImGuiStyle& style = ImGui::GetStyle();
-    if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable){
-        style.WindowRounding = 0.0f;
-        style.Colors[ImGuiCol_WindowBg].w = 1.0f;
-    }
+    if (!headless) {
+        io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+        io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+        io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+
+        ImGui::StyleColorsDark();
+        ImGuiStyle& style = ImGui::GetStyle();
+        if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable){
+            style.WindowRounding = 0.0f;
+            style.Colors[ImGuiCol_WindowBg].w = 1.0f;
+        }
 
-    ImGui_ImplGlfw_InitForOpenGL(mainWindow, true);
-	ImGui_ImplOpenGL3_Init("#version 330");
+        ImGui_ImplGlfw_InitForOpenGL(mainWindow, true);
+        ImGui_ImplOpenGL3_Init("#version 330");
+    }
     /* ----------------------------------------------------
                         VAO Setup
     -----------------------------------------------------*/
@@ -365,10 +484,17 @@ int main()
 
     Mesh mesh = Mesh::loadMeshFromFile("src/models/unit_sphere.stl", glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), 0.05f, 1.0f, 0.2f, 100.0f);
 
+    // The mesh keeps positions and normals in separate arrays, the colour pass reads them interleaved
+    std::vector<Vertex> interleaved(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        interleaved[i].position = mesh.vertices[i];
+        interleaved[i].normal = i < mesh.vertex_normals.size() ? mesh.vertex_normals[i] : glm::vec3(0.0f);
+    }
+
     unsigned int vboID;
     glGenBuffers(1, &vboID);                    // generate an id for this buffer
     glBindBuffer(GL_ARRAY_BUFFER, vboID);       // actively working on this buffer id
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * 6 * sizeof(float), &mesh.vertices[0], GL_STATIC_DRAW);  // load vertices to this buffer
+    glBufferData(GL_ARRAY_BUFFER, interleaved.size() * sizeof(Vertex), interleaved.data(), GL_STATIC_DRAW);  // load vertices to this buffer
 
     /* ----------------------------------------------------
                            IBO
@@ -422,60 +548,116 @@ int main()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
+    /* ----------------------------------------------------
+              Depth pre-pass position-only stream
+    -----------------------------------------------------*/
+    // The positions of the interleaved buffer in the same vertex order, tightly packed so the pre-pass fetches half
+    // the vertex data of the colour pass
+    unsigned int depthVboID;
+    glGenBuffers(1, &depthVboID);
+    glBindBuffer(GL_ARRAY_BUFFER, depthVboID);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(glm::vec3), &mesh.vertices[0], GL_STATIC_DRAW);
+
+    unsigned int depthVaoID;
+    glGenVertexArrays(1, &depthVaoID);
+    glBindVertexArray(depthVaoID);
+    glBindBuffer(GL_ARRAY_BUFFER, depthVboID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
     /* ----------------------------------------------------
                       Shaders Setup
     -----------------------------------------------------*/
-    unsigned int shaderProgramID;
-    {
-        unsigned int vertexShaderID = CreateShader(ShaderType::VERTEX, "src/shaders/BasicVS.vert");
-        unsigned int fragShaderID = CreateShader(ShaderType::FRAGMENT, "src/shaders/BasicPS.frag");
-
-        // Link shaders with shader program
-        shaderProgramID = glCreateProgram();
-        glAttachShader(shaderProgramID, vertexShaderID);
-        glAttachShader(shaderProgramID, fragShaderID);
-        glLinkProgram(shaderProgramID);
-        CheckShaderStatus(shaderProgramID, GL_LINK_STATUS);
-
-        // delete shaders since we have linked them
-        glDeleteShader(vertexShaderID);
-        glDeleteShader(fragShaderID);
-    }
+    // Linked programs are cached on disk per driver, a warm start skips compiling and linking
+    ProgramCache programCache(".cache/shaders");
+    programCache.setEnabled(useProgramCache);
+
+    // All programs are compiled at once so the driver can work on them in parallel. Draws hold pointers to the
+    // programs, a hot reload swaps the program behind the pointer between frames.
+    ShaderBuildService shaderBuild(programCache);
+    shaderBuild.setSourcesFromDisk(shadersFromDisk);
+
+    // Lit objects get a specialised program per permutation instead of branching in the shader. The variants used
+    // every frame are built up front, any other one is compiled on first use.
+    ShaderVariants phongVariants(shaderBuild, "phong", "src/shaders/BasicVS.vert", "src/shaders/BasicPS.frag");
+    ShaderPermutation litPermutation;
+    ShaderPermutation distantPermutation;
+    distantPermutation.specular = SpecularModel::NONE;
+    phongVariants.prewarm(litPermutation);
+    phongVariants.prewarm(distantPermutation);
 
     /* ----------------------------------------------------
                    Light Shaders Setup
     -----------------------------------------------------*/
-    unsigned int lightShaderProgramID;
-    {
-        unsigned int vertexShaderID = CreateShader(ShaderType::VERTEX, "src/shaders/BasicVS.vert");
-        unsigned int fragShaderID = CreateShader(ShaderType::FRAGMENT, "src/shaders/LightPS.frag");
-
-        // Link shaders with shader program
-        lightShaderProgramID = glCreateProgram();
-        glAttachShader(lightShaderProgramID, vertexShaderID);
-        glAttachShader(lightShaderProgramID, fragShaderID);
-        glLinkProgram(lightShaderProgramID);
-        CheckShaderStatus(lightShaderProgramID, GL_LINK_STATUS);
-
-        // delete shaders since we have linked them
-        glDeleteShader(vertexShaderID);
-        glDeleteShader(fragShaderID);
+    ShaderProgram& lightProgram = *shaderBuild.add({ "light", "src/shaders/BasicVS.vert", "src/shaders/LightPS.frag", "" });
+
+    /* ----------------------------------------------------
+                 Depth Pre-pass Shaders Setup
+    -----------------------------------------------------*/
+    ShaderVariants depthVariants(shaderBuild, "depth", "src/shaders/DepthVS.vert", "src/shaders/DepthPS.frag");
+    ShaderProgram& depthProgram = *depthVariants.get(litPermutation.vertexOnly());
+
+    /* ----------------------------------------------------
+                   Path Rendering Setup
+    -----------------------------------------------------*/
+    CurveRenderer curveRenderer(shaderBuild);
+
+    shaderBuild.buildAll();
+    shaderBuild.finish();
+    if (hotReload && shadersFromDisk) {
+        shaderBuild.watch("src/shaders");
     }
 
     /* ----------------------------------------------------
            MVP (Model, View, Projection) Matrix Setup
     -----------------------------------------------------*/
-    // Model matrix. Transform the model from local space to world space.
-    glm::vec3 modelPos = glm::vec3(0.0f, -0.5f, 2.0f);
-    glm::mat4 model = glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(1.0f)), modelPos);
     glm::vec3 lightPos = glm::vec3(5.0f, 3.0f, 0.0f);
-    glm::mat4 lightModel = glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(0.2f)), lightPos);
 
+    // Every drawn object has a slot here, its model, MVP and normal matrices are derived in one batch per frame
+    TransformBatch transforms;
+    uint32_t objectTransform = transforms.add();
+    // Same as scale(0.2) followed by translate(lightPos), so the light cube sits at 0.2 * lightPos
+    uint32_t lightTransform = transforms.add(0.2f * lightPos, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.2f));
+    std::vector<uint32_t> stressTransforms;
+
+    // Every crowd entity has a position, a rotation and a scale track, added in that order, so the first 3 * n tracks
+    // belong to the first n entities
+    struct CrowdEntity {
+        uint32_t transform;
+        uint32_t position;
+        uint32_t rotation;
+        uint32_t scale;
+    };
+    AnimationTracks crowdTracks;
+    std::vector<CrowdEntity> crowd;
+    TrackStats crowdTrackStats;
+    const int CROWD_KEYS = 16;
+    const float CROWD_KEY_SECONDS = 0.5f;
+    float crowdTime = 0.0f;
+
+    // Progress along the paths. With constant speed it's the fraction of each path's length covered, otherwise the
+    // curve parameter itself.
     float t = 0.0f;
     float tIncrement = (1.0/2000.0); // Adjust this value to control the speed of movement along the curve
 
-    // Calculate the position on the Bezier curve for the camera
-    glm::vec3 cameraBezierPoint = calculateBezierPoint(t, cameraControlPoints);
+    // Paths of the object and the camera, rebuilt when the UI edits their control points. The overlay shows the cubic
+    // through the first four object control points.
+    CachedCurve objectCurve;
+    PiecewisePath objectPath;
+    CachedCurve cameraCurve;
+    CachedCurve overlayCurve;
+    // Nearest point queries on the overlay curve in pixels, rebuilt with the curve or when the window is resized
+    CurveBvh overlayBvh;
+    uint32_t overlayBvhVersion = 0;
+    glm::vec3 overlayBvhScale(0.0f);
+    OverlayRenderer overlayRenderer;
+    // Orientation of the object along its path, through the rotation control points
+    RotationSpline objectRotation;
 
     // View matrix. Also known as camera matrix
     glm::vec3 camPos = glm::vec3(0.0f, 0.0f, -1000.0f);
@@ -485,7 +667,10 @@ int main()
 
 
     // Projection matrix
-    glm::mat4 proj = glm::perspective(glm::radians(90.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 1000.0f);  // perspective projection
+    const float nearPlane = 0.1f;
+    const float farPlane = 1000.0f;
+    glm::mat4 proj = glm::perspective(glm::radians(90.0f), (float)WIDTH / (float)HEIGHT, nearPlane, farPlane);  // perspective projection
+    glm::mat4 viewProj = proj * view;
 
     /* ----------------------------------------------------
                        Draw loop
@@ -496,224 +681,543 @@ int main()
     // Enable depth test
     glEnable(GL_DEPTH_TEST);
 
-	while (!glfwWindowShouldClose(mainWindow))
-	{
-		glfwPollEvents();
-
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();    
-        
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
-
-        ImGui::NewFrame();
-        ImGui::Begin("My Scene");
-
-		const float window_width = ImGui::GetContentRegionAvail().x;
-		const float window_height = ImGui::GetContentRegionAvail().y;
-
-		rescale_framebuffer(window_width, window_height);
-		glViewport(0, 0, window_width, window_height);
-
-		ImVec2 pos = ImGui::GetCursorScreenPos();
-		
-		ImGui::GetWindowDrawList()->AddImage(
-			texture_id, 
-			ImVec2(pos.x, pos.y), 
-			ImVec2(pos.x + window_width, pos.y + window_height), 
-			ImVec2(0, 1), 
-			ImVec2(1, 0)
-		);
-
-        showBezierControlPoints();
-        std::vector<glm::vec3> curvePoints = generateBezierCurve(controlPoints.data(), 1000);
-
-		// Draw the Bezier curve with depth visualization
-		ImDrawList* draw_list = ImGui::GetWindowDrawList();
-		for (int i = 0; i < curvePoints.size() - 1; ++i) {
-			ImVec2 p1 = ImVec2(pos.x + curvePoints[i].x * window_width, pos.y + curvePoints[i].y * window_height);
-			ImVec2 p2 = ImVec2(pos.x + curvePoints[i + 1].x * window_width, pos.y + curvePoints[i + 1].y * window_height);
-
-			// Adjust color based on z-coordinate
-			float depth1 = (curvePoints[i].z + 1.0f) / 2.0f; // Normalize z to [0, 1]
-			float depth2 = (curvePoints[i + 1].z + 1.0f) / 2.0f; // Normalize z to [0, 1]
-			ImU32 color1 = HSVtoRGB(depth1 * 0.8f, 1.0f, 1.0f); // Adjust hue range for better visualization
-			ImU32 color2 = HSVtoRGB(depth2 * 0.8f, 1.0f, 1.0f); // Adjust hue range for better visualization
-
-			// Adjust thickness based on z-coordinate (thinner as it goes further back)
-			float thickness1 = 5.0f - depth1 * 4.0f; // Thickness range from 5 to 1
-			float thickness2 = 5.0f - depth2 * 4.0f; // Thickness range from 5 to 1
-
-			draw_list->AddLine(p1, p2, color1, thickness1);
-		}
-
-        for (int i = 0; i < cameraControlPoints.size() - 1; ++i) {
-            ImVec2 p1 = ImVec2(pos.x + cameraControlPoints[i].x * window_width, pos.y + cameraControlPoints[i].y * window_height);
-            ImVec2 p2 = ImVec2(pos.x + cameraControlPoints[i + 1].x * window_width, pos.y + cameraControlPoints[i + 1].y * window_height);
-            draw_list->AddLine(p1, p2, IM_COL32(0, 255, 0, 255), 1.0f);
+    // Material ids only need to be distinct, they group draws with identical per-material uniforms
+    const uint32_t objectMaterial = 0;
+    const uint32_t lightMaterial = 1;
+    RenderQueue renderQueue;
+
+    // Per-frame uniforms are set once per program bind, per-draw ones on every draw. Uniforms a program doesn't
+    // have are ignored, and unchanged values never reach GL.
+    auto applyUniforms = [&](const DrawCommand& command, bool programChanged) {
+        ShaderProgram& program = *command.program;
+        if (programChanged) {
+            program.set(U_LIGHT_COLOR, lightColor);
+            program.set(U_VIEW_PROJ, viewProj);
+            program.set(U_LIGHT_POS, lightPos);
+            program.set(U_CAM_POS, camPos);
         }
 
-		// Draw control points as draggable handles with smokey gray color
-		ImU32 controlPointColor = IM_COL32(169, 169, 169, 255); // Smokey gray color
-		for (int i = 0; i < 4; ++i) {
-			ImVec2 handle_pos = ImVec2(pos.x + controlPoints[i].x * window_width, pos.y + controlPoints[i].y * window_height);
-
-			draw_list->AddCircleFilled(handle_pos, 5.0f, controlPointColor);
+        program.set(U_MODEL, transforms.model(command.transform));
+        program.set(U_MVP, transforms.mvp(command.transform));
+        program.set(U_NORMAL_MATRIX, transforms.normalMatrix(command.transform));
+        program.set(U_OBJ_COLOR, command.color);
+    };
 
-			ImGui::SetCursorScreenPos(ImVec2(handle_pos.x - 5, handle_pos.y - 5)); // Adjust for handle size
-			ImGui::InvisibleButton(("Object Control Handle" + std::to_string(i)).c_str(), ImVec2(10, 10));
-
-			if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
-				ImVec2 mouse_delta = ImGui::GetMouseDragDelta(ImGuiMouseButton_Left);
-				controlPoints[i].x += mouse_delta.x / window_width;
-				controlPoints[i].y += mouse_delta.y / window_height;
-				ImGui::ResetMouseDragDelta(ImGuiMouseButton_Left);
-			}
-		}
-
-        // Draw control points for camera
-        for (int i = 0; i < cameraControlPoints.size(); ++i) {
-            ImVec2 handle_pos = ImVec2(pos.x + cameraControlPoints[i].x * window_width, pos.y + cameraControlPoints[i].y * window_height);
-
-            draw_list->AddCircleFilled(handle_pos, 5.0f, IM_COL32(0, 255, 0, 255));
-
-            ImGui::SetCursorScreenPos(ImVec2(handle_pos.x - 5, handle_pos.y - 5)); // Adjust for handle size
-            ImGui::InvisibleButton(("Camera Control Handle" + std::to_string(i)).c_str(), ImVec2(10, 10));
+    auto applyDepthUniforms = [&](const DrawCommand& command, bool programChanged) {
+        ShaderProgram& program = *command.program;
+        if (programChanged) {
+            program.set(U_VIEW_PROJ, viewProj);
+        }
 
-            if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
-                ImVec2 mouse_delta = ImGui::GetMouseDragDelta(ImGuiMouseButton_Left);
-                cameraControlPoints[i].x += mouse_delta.x / window_width;
-                cameraControlPoints[i].y += mouse_delta.y / window_height;
-                ImGui::ResetMouseDragDelta(ImGuiMouseButton_Left);
-            }
+        program.set(U_MVP, transforms.mvp(command.transform));
+    };
+
+    // View space centre of a model
+    auto viewCenter = [&](const glm::mat4& modelMatrix) {
+        glm::vec4 center = view * modelMatrix[3];
+        return glm::vec3(center) / center.w;
+    };
+
+    // Trades resolution, overlay tessellation and shading LOD for frame time. Headless runs render every frame at
+    // full quality so their output doesn't depend on the machine, unless --governor asks for it.
+    FrameGovernor frameGovernor;
+    frameGovernor.enabled = !headless || headlessGovernor;
+    // Refresh period of the monitor the window is probably on, a swap may wait this long. Headless runs never wait.
+    float refreshMs = 0.0f;
+    if (!headless) {
+        const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        if (videoMode && videoMode->refreshRate > 0) {
+            refreshMs = 1000.0f / (float) videoMode->refreshRate;
         }
+    }
 
-		// Draw lines connecting control points to the curve
-		ImU32 controlLineColor = IM_COL32(255, 0, 0, 255); // Red color for control lines
-		for (int i = 0; i < 3; ++i) {
-			ImVec2 p1 = ImVec2(pos.x + controlPoints[i].x * window_width, pos.y + controlPoints[i].y * window_height);
-			ImVec2 p2 = ImVec2(pos.x + controlPoints[i + 1].x * window_width, pos.y + controlPoints[i + 1].y * window_height);
-			draw_list->AddLine(p1, p2, controlLineColor, 1.0f);
+    // Specular highlights on objects only a few pixels across aren't worth their pow(), those get the cheaper variant
+    float sceneWidth = headless ? (float)headlessWidth : (float)WIDTH;
+    float sceneHeight = headless ? (float)headlessHeight : (float)HEIGHT;
+    auto phongFor = [&](const glm::mat4& modelMatrix) {
+        float depth = std::max(-viewCenter(modelMatrix).z, nearPlane);
+        float radius = glm::length(glm::vec3(modelMatrix[0])) / modelMatrix[3][3];
+        float pixels = radius / depth * proj[1][1] * 0.5f * sceneHeight;
+        float threshold = specularLodPixels * frameGovernor.settings().lodBias;
+        return phongVariants.select(pixels < threshold ? distantPermutation : litPermutation, litPermutation);
+    };
+
+    DepthPrepassPolicy depthPrepass;
+    depthPrepass.mode = prepassMode;
+    MsaaPolicy msaaPolicy;
+    // Headless runs are compared with each other, so they don't adapt the sample count unless asked to
+    msaaPolicy.fixedSamples = msaaSamples > 0 || !headless ? msaaSamples : HEADLESS_MSAA_SAMPLES;
+    GpuTimer gpuTimer;
+    OcclusionCuller occlusionCuller;
+    std::vector<DrawCommand> opaqueDraws;
+    std::vector<DrawCommand> visibleDraws;
+
+    // Opaque draws are collected up front so occlusion culling and the pre-pass decision see the whole frame.
+    // Every draw here uses the sphere mesh, so the occluder geometry is always that mesh.
+    auto addOpaqueDraw = [&](const DrawCommand& command, bool occluder) {
+        glm::vec4 center = command.model[3] / command.model[3][3];
+        float radius = glm::length(glm::vec3(command.model[0])) / command.model[3][3];
+        OcclusionJob& job = occlusionCuller.job();
+        job.bounds.push_back(glm::vec4(glm::vec3(center), radius));
+        if (occluder) {
+            OccluderInstance instance;
+            instance.vertices = &mesh.vertices;
+            instance.indices = &mesh.indices;
+            instance.model = command.model;
+            job.occluders.push_back(instance);
+        }
+        opaqueDraws.push_back(command);
+    };
+
+    // The scene renders at the governor's fraction of the size it's shown at and is stretched back up by AddImage.
+    // A recording keeps full resolution, its frames all need the same size.
+    int renderWidth = (int)sceneWidth;
+    int renderHeight = (int)sceneHeight;
+    auto resizeScene = [&]() {
+        float scale = frameCapture.active() ? 1.0f : frameGovernor.settings().resolutionScale;
+        renderWidth = std::max((int)(sceneWidth * scale), 1);
+        renderHeight = std::max((int)(sceneHeight * scale), 1);
+        // Only reallocates when the window outgrew the attachments, the scene uses their bottom-left corner
+        sceneFramebuffer.resize(renderWidth, renderHeight);
+        sceneFramebuffer.setSamples(msaaPolicy.decide(sceneFramebuffer.maxSamples()));
+    };
+
+    bool firstFrame = true;
+    int frameIndex = 0;
+    // Averaged for the summary of a headless run, the first frame (which builds the programs) left out
+    double cpuMsSum = 0.0;
+    double gpuMsSums[GpuTimer::MAX_SECTIONS] = {};
+    double gpuTotalMsSum = 0.0;
+    int gpuResults = 0;
+    int prepassFrames = 0;
+    // Moving average of the pre-pass and colour sections, -1 before the first timer result. See GPU_BLIND_SCENE_MS.
+    float gpuSceneMs = -1.0f;
+    // Frames are timed from the end of one to the end of the next, which includes the swap, the capture read-back or
+    // the glFinish of a headless run, so the rendering too when the GPU timer can't see it
+    auto previousFrameEnd = std::chrono::steady_clock::now();
+    double frameMsSum = 0.0;
+
+	while (headless ? frameIndex < headlessFrames : !glfwWindowShouldClose(mainWindow))
+	{
+        auto frameStart = std::chrono::steady_clock::now();
+		if (!headless) {
+			glfwPollEvents();
 		}
-
-		ImGui::End();
-		ImGui::Render();
-
-
-        // Render the scene to the ImGUI sub-window
-		bind_framebuffer();
-        // Clear the color and depth buffers
-        glViewport(0, 0, window_width, window_height);
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        shaderBuild.update();
+
+        // Animate and collect the frame's draws before building the UI. Occlusion culling for them then runs on the
+        // worker thread while the UI is built and the GPU is still busy with the previous frame.
+        opaqueDraws.clear();
+        OcclusionJob& occlusionJob = occlusionCuller.job();
+        occlusionJob.occluders.clear();
+        occlusionJob.bounds.clear();
         {
 
             /* ----------------------------------------------------
                              Draw the object cube
             -----------------------------------------------------*/
 
-            glm::vec3 cameraBezierPoint = calculateBezierPoint(t, cameraControlPoints);
+            cameraCurve.sync(cameraControlPoints, cameraControlPointsVersion);
+            float cameraT = constantSpeedPaths ? cameraCurve.arcLength().parameterAtFraction(t) : t;
+            glm::vec3 cameraBezierPoint = cameraCurve.curve().evaluate(cameraT);
             view = glm::lookAt(cameraBezierPoint, cameraBezierPoint + camFront, camUp);
 
-            glm::vec3 bezierPoint = calculateBezierPoint(t, controlPoints);
-            // cubeModel = glm::rotate(cubeModel, glm::radians(0.3f), glm::vec3(0.0f, 1.0f, 1.0f));    // Rotate the model
-            model = glm::translate(glm::mat4(0.5f), bezierPoint);
-            glm::quat rotationQuat = slerp(t, rotationControlPoints);
-            model = glm::rotate(model, glm::angle(rotationQuat), glm::axis(rotationQuat));
+            // A drag rebuilds only the path segments next to the moved point
+            float objectT = t;
+            glm::vec3 bezierPoint;
+            if (piecewiseObjectPath) {
+                objectPath.setBasis(objectPathBasis);
+                objectPath.sync(controlPoints, controlPointsVersion);
+                objectT = constantSpeedPaths ? objectPath.parameterAtFraction(t) : t;
+                bezierPoint = objectPath.evaluate(objectT);
+            } else {
+                objectCurve.sync(controlPoints, controlPointsVersion);
+                objectT = constantSpeedPaths ? objectCurve.arcLength().parameterAtFraction(t) : t;
+                bezierPoint = objectCurve.curve().evaluate(objectT);
+            }
 
+            // Only the transforms that move are set, update() then derives the matrices for all of them at once
+            objectRotation.sync(rotationControlPoints, rotationControlPointsVersion);
+            glm::quat rotationQuat = objectRotation.evaluate(objectT);
+            transforms.set(objectTransform, bezierPoint, rotationQuat, glm::vec3(1.0f));
 
-            // Set shader values
-            glUseProgram(shaderProgramID);      // activate shaders
-            {
-                // Object color
-                glm::vec3 objColor = glm::vec3(0.9f, 0.5f, 0.0f);
-                int location = GetUniformLocation(shaderProgramID, "u_objColor");
-                glUniform3f(location, objColor.x, objColor.y, objColor.z);
+            int stressCount = overlapStressScene ? overlapStressLayers * 16 : 0;
+            while ((int)stressTransforms.size() < stressCount) {
+                stressTransforms.push_back(transforms.add());
             }
-            {
-                // Light color
-                int location = GetUniformLocation(shaderProgramID, "u_lightColor");
-                glUniform3f(location, lightColor.x, lightColor.y, lightColor.z);
+            for (int i = 0; i < stressCount; ++i) {
+                int layer = i / 16;
+                glm::vec3 offset((i % 4) * 0.8f - 1.2f, (i % 16 / 4) * 0.8f - 1.2f, -2.0f - layer * 0.3f);
+                transforms.set(stressTransforms[i], cameraBezierPoint + offset, glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                               glm::vec3(0.6f));
             }
-            {
-                // Light position
-                int location = GetUniformLocation(shaderProgramID, "u_lightPos");
-                glUniform3f(location, lightPos.x, lightPos.y, lightPos.z);
+
+            int crowdCount = animatedCrowd ? crowdSize : 0;
+            while ((int)crowd.size() < crowdCount) {
+                // Random walks in a box around the object's path, keys every CROWD_KEY_SECONDS
+                std::vector<float> times(CROWD_KEYS);
+                std::vector<glm::vec3> positions(CROWD_KEYS), scales(CROWD_KEYS);
+                std::vector<glm::quat> rotations(CROWD_KEYS);
+                auto random = [] { return (float)std::rand() / (float)RAND_MAX; };
+                glm::vec3 position(random() * 8.0f - 4.0f, random() * 6.0f - 3.0f, random() * -6.0f);
+                for (int k = 0; k < CROWD_KEYS; ++k) {
+                    times[k] = k * CROWD_KEY_SECONDS;
+                    position += glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 0.6f;
+                    positions[k] = position;
+                    rotations[k] = glm::quat(glm::vec3(random(), random(), random()) * 6.2832f);
+                    scales[k] = glm::vec3(0.1f + 0.2f * random());
+                }
+                CrowdEntity entity;
+                entity.transform = transforms.add();
+                entity.position = crowdTracks.addTrack(TrackChannel::POSITION, times, positions, quantisedCrowdTracks);
+                entity.rotation = crowdTracks.addTrack(times, rotations, quantisedCrowdTracks);
+                entity.scale = crowdTracks.addTrack(TrackChannel::SCALE, times, scales, quantisedCrowdTracks);
+                crowd.push_back(entity);
             }
-            {
-                // Camera position
-                int location = GetUniformLocation(shaderProgramID, "u_camPos");
-                glUniform3f(location, camPos.x, camPos.y, camPos.z);
+            if (crowdCount > 0) {
+                // Loops over the keys, the wrap is the only jump the cursors see during playback
+                crowdTime = std::fmod(crowdTime + 1.0f / 60.0f, (CROWD_KEYS - 1) * CROWD_KEY_SECONDS);
+                crowdTracks.sample(crowdTime, 0, (uint32_t)crowdCount * 3);
+                for (int i = 0; i < crowdCount; ++i) {
+                    const CrowdEntity& entity = crowd[i];
+                    transforms.set(entity.transform, crowdTracks.vec3(entity.position),
+                                   crowdTracks.rotation(entity.rotation), crowdTracks.vec3(entity.scale));
+                }
             }
-            {
-                // MVP matrix
-                int location = GetUniformLocation(shaderProgramID, "u_model");
-                glUniformMatrix4fv(location, 1, GL_FALSE, &model[0][0]);
-
-                location = GetUniformLocation(shaderProgramID, "u_view");
-                glUniformMatrix4fv(location, 1, GL_FALSE, &view[0][0]);
-                
-                location = GetUniformLocation(shaderProgramID, "u_proj");
-                glUniformMatrix4fv(location, 1, GL_FALSE, &proj[0][0]);
+            crowdTrackStats = crowdTracks.takeStats();
+
+            viewProj = proj * view;
+            transforms.update(viewProj);
+
+            DrawCommand objectDraw;
+            objectDraw.transform = objectTransform;
+            objectDraw.model = transforms.model(objectTransform);
+            objectDraw.program = phongFor(objectDraw.model);
+            objectDraw.vao = vaoID;
+            objectDraw.indexCount = numIndicies;
+            objectDraw.material = objectMaterial;
+            objectDraw.color = glm::vec3(0.9f, 0.5f, 0.0f);
+            addOpaqueDraw(objectDraw, true);
+
+            // A 4x4 grid per layer, each layer a little further away, so most fragments are hidden. The first layer is
+            // the occluder for the software culling.
+            for (int i = 0; i < stressCount; ++i) {
+                int layer = i / 16;
+                DrawCommand stressDraw = objectDraw;
+                stressDraw.transform = stressTransforms[i];
+                stressDraw.model = transforms.model(stressTransforms[i]);
+                stressDraw.program = phongFor(stressDraw.model);
+                stressDraw.color = glm::vec3(0.2f + 0.8f * layer / overlapStressLayers, 0.5f, 1.0f - 0.8f * layer / overlapStressLayers);
+                addOpaqueDraw(stressDraw, layer == 0);
             }
 
-            // Draw this VAO
-            glBindVertexArray(vaoID);
-
-            // Draw
-            glDrawElements(GL_TRIANGLES, numIndicies, GL_UNSIGNED_INT, nullptr);
-
-            // Unbind
-            glUseProgram(0);
-            glBindVertexArray(0);
+            for (int i = 0; i < crowdCount; ++i) {
+                DrawCommand crowdDraw = objectDraw;
+                crowdDraw.transform = crowd[i].transform;
+                crowdDraw.model = transforms.model(crowd[i].transform);
+                crowdDraw.program = phongFor(crowdDraw.model);
+                crowdDraw.color = glm::vec3(0.3f + 0.7f * (i % 7) / 6.0f, 0.8f, 0.3f + 0.7f * (i % 5) / 4.0f);
+                addOpaqueDraw(crowdDraw, false);
+            }
         }
 
         {
             /* ----------------------------------------------------
                              Draw the light cube
             -----------------------------------------------------*/
-            // Set shader values
-            glUseProgram(lightShaderProgramID);      // activate shaders
-            {
-                // Light color
-                int location = GetUniformLocation(lightShaderProgramID, "u_lightColor");
-                glUniform3f(location, lightColor.x, lightColor.y, lightColor.z);
+            DrawCommand lightDraw;
+            lightDraw.program = &lightProgram;
+            lightDraw.vao = lightVaoID;
+            lightDraw.indexCount = numIndicies;
+            lightDraw.material = lightMaterial;
+            lightDraw.transform = lightTransform;
+            lightDraw.model = transforms.model(lightTransform);
+            lightDraw.color = lightColor;
+            addOpaqueDraw(lightDraw, false);
+        }
+
+        // The UI may flip the setting before the results are used, so remember what this frame did
+        const bool cullThisFrame = occlusionCulling;
+        occlusionJob.viewProj = viewProj;
+        if (cullThisFrame) {
+            occlusionCuller.submit();
+        }
+
+        if (!headless) {
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            ImGui::NewFrame();
+            ImGui::Begin("My Scene");
+
+            const float window_width = ImGui::GetContentRegionAvail().x;
+            const float window_height = ImGui::GetContentRegionAvail().y;
+            sceneWidth = window_width;
+            sceneHeight = window_height;
+            // Before AddImage so the texture coordinates match the size this frame renders at
+            resizeScene();
+
+            ImVec2 pos = ImGui::GetCursorScreenPos();
+
+            ImGui::GetWindowDrawList()->AddImage(
+                sceneFramebuffer.colorTexture(),
+                ImVec2(pos.x, pos.y),
+                ImVec2(pos.x + window_width, pos.y + window_height),
+                ImVec2(0, sceneFramebuffer.vMax()),
+                ImVec2(sceneFramebuffer.uMax(), 0)
+            );
+
+            overlayCurve.sync(controlPoints.data(), 4, controlPointsVersion);
+            showBezierControlPoints(overlayCurve, objectPath, curveRenderer, overlayRenderer.stats());
+            showRenderStats(renderQueue, depthPrepass, msaaPolicy, frameGovernor, gpuTimer, occlusionCuller, shaderBuild,
+                            transforms, sceneFramebuffer, frameCapture, crowdTrackStats);
+            // Adaptive tessellation measures flatness in pixels of this window. z sets hue and thickness, its weight
+            // keeps the hue error of a quarter pixel tolerance well below one 8-bit step. The governor's segment
+            // count caps the subdivision.
+            int overlaySegments = frameGovernor.settings().curveSegments;
+            const std::vector<glm::vec3>& curvePoints = adaptiveOverlay
+                ? overlayCurve.adaptiveTessellation(glm::vec3(window_width, window_height, 64.0f),
+                                                    overlayTolerancePixels, overlaySegments)
+                : overlayCurve.tessellation(overlaySegments);
+
+            // Draw the Bezier curve with depth visualization
+            ImDrawList* draw_list = ImGui::GetWindowDrawList();
+            overlayRenderer.drawDepthCurve(draw_list, curvePoints, pos, ImVec2(window_width, window_height));
+
+            // Highlight the point of the curve under the mouse
+            const glm::vec3 overlayScale(window_width, window_height, 0.0f);
+            if (overlayCurve.version() != overlayBvhVersion || overlayScale != overlayBvhScale) {
+                overlayBvh.build(controlPoints.data(), 1, 3, overlayScale);
+                overlayBvhVersion = overlayCurve.version();
+                overlayBvhScale = overlayScale;
+            }
+            if (ImGui::IsWindowHovered()) {
+                ImVec2 mouse = ImGui::GetIO().MousePos;
+                CurveHit hover = overlayBvh.nearest(glm::vec3(mouse.x - pos.x, mouse.y - pos.y, 0.0f), 8.0f);
+                if (hover.found) {
+                    draw_list->AddCircle(ImVec2(pos.x + hover.point.x, pos.y + hover.point.y), 6.0f,
+                                         IM_COL32(255, 255, 255, 255), 0, 2.0f);
+                    ImGui::SetTooltip("t = %.3f", hover.t);
+                }
             }
-            {
-                // MVP matrix
-                int location = GetUniformLocation(shaderProgramID, "u_model");
-                glUniformMatrix4fv(location, 1, GL_FALSE, &lightModel[0][0]);
 
-                location = GetUniformLocation(shaderProgramID, "u_view");
-                glUniformMatrix4fv(location, 1, GL_FALSE, &view[0][0]);
+            for (int i = 0; i < (int) cameraControlPoints.size() - 1; ++i) {
+                ImVec2 p1 = ImVec2(pos.x + cameraControlPoints[i].x * window_width, pos.y + cameraControlPoints[i].y * window_height);
+                ImVec2 p2 = ImVec2(pos.x + cameraControlPoints[i + 1].x * window_width, pos.y + cameraControlPoints[i + 1].y * window_height);
+                draw_list->AddLine(p1, p2, IM_COL32(0, 255, 0, 255), 1.0f);
+            }
+
+            // Draw control points as draggable handles with smokey gray color
+            ImU32 controlPointColor = IM_COL32(169, 169, 169, 255); // Smokey gray color
+            for (int i = 0; i < 4; ++i) {
+                ImVec2 handle_pos = ImVec2(pos.x + controlPoints[i].x * window_width, pos.y + controlPoints[i].y * window_height);
+
+                draw_list->AddCircleFilled(handle_pos, 5.0f, controlPointColor);
+
+                ImGui::SetCursorScreenPos(ImVec2(handle_pos.x - 5, handle_pos.y - 5)); // Adjust for handle size
+                ImGui::PushID(i);
+                ImGui::InvisibleButton("Object Control Handle", ImVec2(10, 10));
+                ImGui::PopID();
+
+                if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+                    ImVec2 mouse_delta = ImGui::GetMouseDragDelta(ImGuiMouseButton_Left);
+                    controlPoints[i].x += mouse_delta.x / window_width;
+                    controlPoints[i].y += mouse_delta.y / window_height;
+                    controlPointsVersion++;
+                    ImGui::ResetMouseDragDelta(ImGuiMouseButton_Left);
+                }
+            }
+
+            // Draw control points for camera
+            for (int i = 0; i < (int) cameraControlPoints.size(); ++i) {
+                ImVec2 handle_pos = ImVec2(pos.x + cameraControlPoints[i].x * window_width, pos.y + cameraControlPoints[i].y * window_height);
+
+                draw_list->AddCircleFilled(handle_pos, 5.0f, IM_COL32(0, 255, 0, 255));
+
+                ImGui::SetCursorScreenPos(ImVec2(handle_pos.x - 5, handle_pos.y - 5)); // Adjust for handle size
+                ImGui::PushID(i);
+                ImGui::InvisibleButton("Camera Control Handle", ImVec2(10, 10));
+                ImGui::PopID();
 
-                location = GetUniformLocation(shaderProgramID, "u_proj");
-                glUniformMatrix4fv(location, 1, GL_FALSE, &proj[0][0]);
+                if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+                    ImVec2 mouse_delta = ImGui::GetMouseDragDelta(ImGuiMouseButton_Left);
+                    cameraControlPoints[i].x += mouse_delta.x / window_width;
+                    cameraControlPoints[i].y += mouse_delta.y / window_height;
+                    cameraControlPointsVersion++;
+                    ImGui::ResetMouseDragDelta(ImGuiMouseButton_Left);
+                }
             }
 
-            // Draw this VAO
-            glBindVertexArray(lightVaoID);
+            // Draw lines connecting control points to the curve
+            ImU32 controlLineColor = IM_COL32(255, 0, 0, 255); // Red color for control lines
+            for (int i = 0; i < 3; ++i) {
+                ImVec2 p1 = ImVec2(pos.x + controlPoints[i].x * window_width, pos.y + controlPoints[i].y * window_height);
+                ImVec2 p2 = ImVec2(pos.x + controlPoints[i + 1].x * window_width, pos.y + controlPoints[i + 1].y * window_height);
+                draw_list->AddLine(p1, p2, controlLineColor, 1.0f);
+            }
+
+            ImGui::End();
+            ImGui::Render();
+        }
+
+        if (headless) {
+            resizeScene();
+        }
 
-            // Draw
-            glDrawElements(GL_TRIANGLES, numIndicies, GL_UNSIGNED_INT, nullptr);
 
-            // Unbind
-            glUseProgram(0);
-            glBindVertexArray(0);
+        // Render the scene to the ImGUI sub-window
+		sceneFramebuffer.bind();
+        // Clear the color and depth buffers
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderQueue.clear();
+        depthPrepass.beginFrame();
+
+        // Drop what the occlusion worker found hidden, the rest feeds the pre-pass estimate
+        if (cullThisFrame) {
+            occlusionCuller.wait();
+        }
+        visibleDraws.clear();
+        for (size_t i = 0; i < opaqueDraws.size(); ++i) {
+            if (cullThisFrame && !occlusionCuller.visibility()[i]) {
+                continue;
+            }
+            const DrawCommand& command = opaqueDraws[i];
+            float radius = glm::length(glm::vec3(command.model[0])) / command.model[3][3];
+            depthPrepass.addOpaque(viewCenter(command.model), radius, proj, (float)renderHeight);
+            visibleDraws.push_back(command);
+        }
+        // Every opaque draw goes into the pre-pass, otherwise it would fail the GL_EQUAL test in the colour pass
+        bool usePrepass = depthPrepass.decide((float)renderWidth, (float)renderHeight);
+        // Linked, so an opaque draw dropped by its cap takes its depth with it
+        for (const DrawCommand& command : visibleDraws) {
+            float depth = -viewCenter(command.model).z;
+            uint32_t opaque = renderQueue.submit(RenderPass::OPAQUE, command, depth, nearPlane, farPlane);
+            if (usePrepass) {
+                DrawCommand depthDraw = command;
+                depthDraw.program = &depthProgram;
+                depthDraw.vao = depthVaoID;
+                renderQueue.submitLinked(opaque, RenderPass::DEPTH_PREPASS, depthDraw, depth, nearPlane, farPlane);
+            }
+        }
+
+        // Sort by pass, state and depth, then issue pass by pass
+        renderQueue.sort();
+        // The tag says which configuration a late result belongs to: pre-pass in bit 0, the sample count above it
+        gpuTimer.beginFrame((usePrepass ? 1u : 0u) | (uint32_t)sceneFramebuffer.samples() << 1);
+        if (usePrepass) {
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            renderQueue.executePass(RenderPass::DEPTH_PREPASS, applyDepthUniforms);
+            gpuTimer.endSection(GPU_SECTION_PREPASS);
+
+            // Depth is final, only shade the visible fragment of each pixel
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
+        renderQueue.executePass(RenderPass::OPAQUE, applyUniforms);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        if (drawPathInScene) {
+            // Only the control points are uploaded, and only after an edit
+            if (piecewiseObjectPath) {
+                curveRenderer.setCurve(objectPath.bezierPoints().data(), objectPath.segmentCount(), 3,
+                                       objectPath.version());
+            } else {
+                curveRenderer.setCurve(controlPoints.data(), 1, (int)controlPoints.size() - 1, controlPointsVersion);
+            }
+            int segmentCount = piecewiseObjectPath ? std::max((int)objectPath.segmentCount(), 1) : 1;
+            curveRenderer.draw(viewProj, std::max(frameGovernor.settings().curveSegments / segmentCount, 1),
+                               tessellatePath);
+        }
+        gpuTimer.endSection(GPU_SECTION_COLOR);
+        sceneFramebuffer.resolve();
+        gpuTimer.endSection(GPU_SECTION_RESOLVE);
+        gpuTimer.endFrame();
+
+        if (gpuTimer.takeNewResult()) {
+            float sceneMs = gpuTimer.sectionMs(GPU_SECTION_PREPASS) + gpuTimer.sectionMs(GPU_SECTION_COLOR);
+            gpuSceneMs = gpuSceneMs < 0.0f ? sceneMs : gpuSceneMs + (sceneMs - gpuSceneMs) * 0.1f;
+            // A blind timer's total is mostly the resolve and would let MSAA climb to 8x whatever the scene costs.
+            // Without timings the sample count stays where it is.
+            if (gpuSceneMs >= GPU_BLIND_SCENE_MS) {
+                depthPrepass.reportTiming((gpuTimer.resultTag() & 1) != 0, gpuTimer.totalMs());
+                msaaPolicy.reportTiming((int)(gpuTimer.resultTag() >> 1), gpuTimer.totalMs());
+            }
+            for (int section = 0; section < GpuTimer::MAX_SECTIONS; ++section) {
+                gpuMsSums[section] += gpuTimer.sectionMs(section);
+            }
+            gpuTotalMsSum += gpuTimer.totalMs();
+            gpuResults++;
         }
+        prepassFrames += usePrepass ? 1 : 0;
+
+        // The resolved framebuffer is still bound, so a recording reads straight from it. Does nothing when not
+        // recording.
+        frameCapture.capture(renderWidth, renderHeight);
 		
-		unbind_framebuffer();	
+		sceneFramebuffer.unbind();
 
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());	
-        if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
-        {
-            GLFWwindow* backup_current_context = glfwGetCurrentContext();
-            ImGui::UpdatePlatformWindows();
-            ImGui::RenderPlatformWindowsDefault();
-            glfwMakeContextCurrent(backup_current_context);
+        if (!headless) {
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+            {
+                GLFWwindow* backup_current_context = glfwGetCurrentContext();
+                ImGui::UpdatePlatformWindows();
+                ImGui::RenderPlatformWindowsDefault();
+                glfwMakeContextCurrent(backup_current_context);
+            }
+
+        }
+        if (headless && !frameCapture.active()) {
+            // Nothing reads the frame back, so wait for it here as a swap would. Otherwise the driver may still be
+            // rendering it and the frame time says nothing about the cost of capturing.
+            glFinish();
+        }
+        // Waiting for the swap isn't work, vsync would hold every frame at the refresh interval
+        float cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        if (!firstFrame) {
+            cpuMsSum += cpuMs;
+        }
+        if (!headless) {
+            glfwSwapBuffers(mainWindow);
         }
 
-		glfwSwapBuffers(mainWindow);
+        auto frameEnd = std::chrono::steady_clock::now();
+        float frameMs = std::chrono::duration<float, std::milli>(frameEnd - previousFrameEnd).count();
+        previousFrameEnd = frameEnd;
+        bool gpuTimerBlind = gpuSceneMs >= 0.0f && gpuSceneMs < GPU_BLIND_SCENE_MS;
+        // A headless frame ends in glFinish or the capture read-back and never waits for vsync, so its time is the
+        // cost of its pre-pass choice. A window's frame time may be the refresh interval either way, without a usable
+        // timer the estimate decides alone there.
+        depthPrepass.timed = !gpuTimerBlind || headless;
+        if (gpuTimerBlind && headless && !firstFrame) {
+            depthPrepass.reportTiming(usePrepass, frameMs);
+        }
+        // The governor needs the rendering in its cost too, a blind timer leaves only the interval between frames
+        if (gpuTimerBlind) {
+            if (!firstFrame) {
+                frameGovernor.reportInterval(frameMs, refreshMs);
+            }
+        } else {
+            frameGovernor.reportFrame(cpuMs, gpuTimer.hasResult() ? gpuTimer.totalMs() : 0.0f);
+        }
+        if (!firstFrame) {
+            frameMsSum += frameMs;
+        }
+        frameIndex++;
+        if (firstFrame) {
+            firstFrame = false;
+            double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            const ProgramCacheStats& cacheStats = programCache.stats();
+            std::cout << "[INFO] Time to first frame: " << elapsedMs << " ms, programs: " << shaderBuild.stats().startupMs
+                      << " ms (" << cacheStats.hits << " cached, " << cacheStats.misses << " compiled, "
+                      << cacheStats.rejected << " rejected" << (programCache.supported() ? "" : ", binaries unsupported")
+                      << (useProgramCache ? "" : ", cache off") << ")" << std::endl;
+        }
         // Increment t to move along the Bezier curve
         t += tIncrement;
         if (t > 1.0f) {
@@ -721,16 +1225,45 @@ int main()
         }
 	}
 
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+    if (headless && frameIndex > 1) {
+        double timed = std::max(gpuResults, 1);
+        std::cout << "[INFO] " << frameIndex << " frames at " << headlessWidth << "x" << headlessHeight << ", pre-pass "
+                  << depthPrepassModeName(depthPrepass.mode) << " (used in " << prepassFrames << "), MSAA "
+                  << msaaPolicy.samples() << "x, "
+                  << (frameCapture.active() ? "captured" : "not captured") << ", frame "
+                  << frameMsSum / (frameIndex - 1) << " ms, CPU " << cpuMsSum / (frameIndex - 1)
+                  << " ms/frame, GPU pre-pass " << gpuMsSums[GPU_SECTION_PREPASS] / timed
+                  << " ms, colour " << gpuMsSums[GPU_SECTION_COLOR] / timed << " ms, resolve "
+                  << gpuMsSums[GPU_SECTION_RESOLVE] / timed << " ms, total " << gpuTotalMsSum / timed << " ms ("
+                  << gpuResults << " frames timed)" << std::endl;
+        if (frameGovernor.enabled) {
+            std::cout << "[INFO] Frame governor ended at quality " << frameGovernor.level() << "/"
+                      << frameGovernor.levels() - 1 << ", p" << (int) (frameGovernor.percentile * 100.0f) << " "
+                      << frameGovernor.percentileMs() << " ms against a budget of " << frameGovernor.budgetMs << " ms"
+                      << std::endl;
+        }
+    }
+
+    if (!headless) {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+    }
     ImGui::DestroyContext();
 
-	glDeleteFramebuffers(1, &FBO);
-	glDeleteTextures(1, &texture_id);
-	glDeleteRenderbuffers(1, &RBO);
+    gpuTimer.release();
+    curveRenderer.release();
+    shaderBuild.release();
+    frameCapture.stop();
+    frameCapture.release();
 
-    glfwDestroyWindow(mainWindow);
-    glfwTerminate();
+    sceneFramebuffer.release();
+
+    if (headless) {
+        headlessContext.release();
+    } else {
+        glfwDestroyWindow(mainWindow);
+        glfwTerminate();
+    }
 
 	return 0;
 }
\ No newline at end of file
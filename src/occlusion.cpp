@@ -0,0 +1,313 @@
+#include "occlusion.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Occluder triangles closer than this in clip w are skipped rather than clipped. Skipping an occluder only makes
+// the culling less effective, never wrong.
+static const float MIN_CLIP_W = 1.0e-3f;
+
+OcclusionBuffer::OcclusionBuffer() : depth(WIDTH * HEIGHT, 1.0f) {
+    clear();
+}
+
+void OcclusionBuffer::clear() {
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    for (int y = 0; y < TILES_Y; ++y) {
+        for (int x = 0; x < TILES_X; ++x) {
+            tileMax[y][x] = 1.0f;
+        }
+    }
+    for (int y = 0; y < COARSE_TILES_Y; ++y) {
+        for (int x = 0; x < COARSE_TILES_X; ++x) {
+            coarseTileMax[y][x] = 1.0f;
+        }
+    }
+}
+
+void OcclusionBuffer::rasterizeOccluder(const std::vector<glm::vec3>& vertices, const std::vector<GLuint>& indices,
+                                        const glm::mat4& mvp) {
+    // Transform every vertex once, triangles share most of them
+    screen.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        glm::vec4 clip = mvp * glm::vec4(vertices[i], 1.0f);
+        if (clip.w < MIN_CLIP_W) {
+            screen[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+            continue;
+        }
+        float invW = 1.0f / clip.w;
+        screen[i] = glm::vec4((clip.x * invW * 0.5f + 0.5f) * WIDTH, (clip.y * invW * 0.5f + 0.5f) * HEIGHT,
+                              clip.z * invW * 0.5f + 0.5f, 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec4& a = screen[indices[i]];
+        const glm::vec4& b = screen[indices[i + 1]];
+        const glm::vec4& c = screen[indices[i + 2]];
+        if (a.w < 0.0f || b.w < 0.0f || c.w < 0.0f) {
+            continue;
+        }
+        rasterizeTriangle(glm::vec3(a), glm::vec3(b), glm::vec3(c));
+    }
+}
+
+void OcclusionBuffer::rasterizeTriangle(const glm::vec3& v0, const glm::vec3& in1, const glm::vec3& in2) {
+    // Make the winding consistent instead of culling back faces, mesh winding isn't trusted here
+    float area = (in1.x - v0.x) * (in2.y - v0.y) - (in1.y - v0.y) * (in2.x - v0.x);
+    if (std::fabs(area) < 1.0e-6f) {
+        return;
+    }
+    glm::vec3 v1 = area > 0.0f ? in1 : in2;
+    glm::vec3 v2 = area > 0.0f ? in2 : in1;
+    area = std::fabs(area);
+
+    int minX = std::max((int) std::floor(std::min(v0.x, std::min(v1.x, v2.x))), 0);
+    int maxX = std::min((int) std::ceil(std::max(v0.x, std::max(v1.x, v2.x))), WIDTH - 1);
+    int minY = std::max((int) std::floor(std::min(v0.y, std::min(v1.y, v2.y))), 0);
+    int maxY = std::min((int) std::ceil(std::max(v0.y, std::max(v1.y, v2.y))), HEIGHT - 1);
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+    // Process whole groups of four pixels, the edge functions reject the extra ones
+    minX &= ~3;
+
+    // Edge function e(p) = a * p.x + b * p.y + c for each edge, positive inside
+    float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v1.y * v2.x;
+    float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v2.y * v0.x;
+    float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v0.y * v1.x;
+
+    // Depth is linear in screen space: z = v0.z + e1 * dz1 + e2 * dz2
+    float invArea = 1.0f / area;
+    float dz1 = (v1.z - v0.z) * invArea;
+    float dz2 = (v2.z - v0.z) * invArea;
+
+    for (int y = minY; y <= maxY; ++y) {
+        float py = y + 0.5f;
+        float* row = &depth[y * WIDTH];
+        float px = minX + 0.5f;
+        float e0 = a0 * px + b0 * py + c0;
+        float e1 = a1 * px + b1 * py + c1;
+        float e2 = a2 * px + b2 * py + c2;
+
+#ifdef OCCLUSION_USE_SSE
+        const __m128 steps = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+        __m128 w0 = _mm_add_ps(_mm_set1_ps(e0), _mm_mul_ps(steps, _mm_set1_ps(a0)));
+        __m128 w1 = _mm_add_ps(_mm_set1_ps(e1), _mm_mul_ps(steps, _mm_set1_ps(a1)));
+        __m128 w2 = _mm_add_ps(_mm_set1_ps(e2), _mm_mul_ps(steps, _mm_set1_ps(a2)));
+        const __m128 step0 = _mm_set1_ps(4.0f * a0);
+        const __m128 step1 = _mm_set1_ps(4.0f * a1);
+        const __m128 step2 = _mm_set1_ps(4.0f * a2);
+        const __m128 z0 = _mm_set1_ps(v0.z);
+        const __m128 dz1v = _mm_set1_ps(dz1);
+        const __m128 dz2v = _mm_set1_ps(dz2);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (int x = minX; x <= maxX; x += 4) {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+                                       _mm_cmpge_ps(w2, zero));
+            if (_mm_movemask_ps(inside)) {
+                __m128 z = _mm_add_ps(z0, _mm_add_ps(_mm_mul_ps(w1, dz1v), _mm_mul_ps(w2, dz2v)));
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+            }
+            w0 = _mm_add_ps(w0, step0);
+            w1 = _mm_add_ps(w1, step1);
+            w2 = _mm_add_ps(w2, step2);
+        }
+#else
+        for (int x = minX; x <= maxX; ++x) {
+            if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) {
+                float z = v0.z + e1 * dz1 + e2 * dz2;
+                row[x] = std::min(row[x], z);
+            }
+            e0 += a0;
+            e1 += a1;
+            e2 += a2;
+        }
+#endif
+    }
+}
+
+void OcclusionBuffer::buildHierarchy() {
+    for (int ty = 0; ty < TILES_Y; ++ty) {
+        for (int tx = 0; tx < TILES_X; ++tx) {
+            const float* tile = &depth[ty * TILE_SIZE * WIDTH + tx * TILE_SIZE];
+#ifdef OCCLUSION_USE_SSE
+            __m128 m = _mm_setzero_ps();
+            for (int y = 0; y < TILE_SIZE; ++y) {
+                m = _mm_max_ps(m, _mm_loadu_ps(tile + y * WIDTH));
+                m = _mm_max_ps(m, _mm_loadu_ps(tile + y * WIDTH + 4));
+            }
+            m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+            m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+            tileMax[ty][tx] = _mm_cvtss_f32(m);
+#else
+            float m = 0.0f;
+            for (int y = 0; y < TILE_SIZE; ++y) {
+                for (int x = 0; x < TILE_SIZE; ++x) {
+                    m = std::max(m, tile[y * WIDTH + x]);
+                }
+            }
+            tileMax[ty][tx] = m;
+#endif
+        }
+    }
+
+    const int ratio = COARSE_TILE_SIZE / TILE_SIZE;
+    for (int cy = 0; cy < COARSE_TILES_Y; ++cy) {
+        for (int cx = 0; cx < COARSE_TILES_X; ++cx) {
+            float m = 0.0f;
+            for (int y = 0; y < ratio; ++y) {
+                for (int x = 0; x < ratio; ++x) {
+                    m = std::max(m, tileMax[cy * ratio + y][cx * ratio + x]);
+                }
+            }
+            coarseTileMax[cy][cx] = m;
+        }
+    }
+}
+
+bool OcclusionBuffer::isRectVisible(int minX, int minY, int maxX, int maxY, float nearestDepth) const {
+    const int ratio = COARSE_TILE_SIZE / TILE_SIZE;
+    int fineMinX = minX / TILE_SIZE, fineMaxX = maxX / TILE_SIZE;
+    int fineMinY = minY / TILE_SIZE, fineMaxY = maxY / TILE_SIZE;
+
+    for (int cy = fineMinY / ratio; cy <= fineMaxY / ratio; ++cy) {
+        for (int cx = fineMinX / ratio; cx <= fineMaxX / ratio; ++cx) {
+            // Everything under this coarse tile is nearer than the object
+            if (nearestDepth > coarseTileMax[cy][cx]) {
+                continue;
+            }
+            int y0 = std::max(fineMinY, cy * ratio), y1 = std::min(fineMaxY, cy * ratio + ratio - 1);
+            int x0 = std::max(fineMinX, cx * ratio), x1 = std::min(fineMaxX, cx * ratio + ratio - 1);
+            for (int ty = y0; ty <= y1; ++ty) {
+                for (int tx = x0; tx <= x1; ++tx) {
+                    if (nearestDepth <= tileMax[ty][tx]) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool OcclusionBuffer::isSphereVisible(const glm::vec3& center, float radius, const glm::mat4& viewProj,
+                                      bool& onScreen) const {
+    // Project the corners of the sphere's bounding box, that gives a conservative screen rectangle and depth
+    float minX = 1.0e30f, minY = 1.0e30f, maxX = -1.0e30f, maxY = -1.0e30f, nearest = 1.0f;
+    onScreen = true;
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner = center + glm::vec3(i & 1 ? radius : -radius, i & 2 ? radius : -radius,
+                                              i & 4 ? radius : -radius);
+        glm::vec4 clip = viewProj * glm::vec4(corner, 1.0f);
+        if (clip.w < MIN_CLIP_W) {
+            return true;
+        }
+        float invW = 1.0f / clip.w;
+        float sx = (clip.x * invW * 0.5f + 0.5f) * WIDTH;
+        float sy = (clip.y * invW * 0.5f + 0.5f) * HEIGHT;
+        minX = std::min(minX, sx);
+        maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy);
+        maxY = std::max(maxY, sy);
+        nearest = std::min(nearest, clip.z * invW * 0.5f + 0.5f);
+    }
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= WIDTH || minY >= HEIGHT || nearest > 1.0f) {
+        onScreen = false;
+        return false;
+    }
+    if (nearest <= 0.0f) {
+        return true;
+    }
+
+    int x0 = std::max((int) minX, 0), x1 = std::min((int) maxX, WIDTH - 1);
+    int y0 = std::max((int) minY, 0), y1 = std::min((int) maxY, HEIGHT - 1);
+    return isRectVisible(x0, y0, x1, y1, nearest);
+}
+
+OcclusionCuller::OcclusionCuller() {
+    worker = std::thread(&OcclusionCuller::run, this);
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeWorker.notify_one();
+    worker.join();
+}
+
+void OcclusionCuller::submit() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        hasJob = true;
+    }
+    wakeWorker.notify_one();
+}
+
+OcclusionStats OcclusionCuller::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastStats;
+}
+
+void OcclusionCuller::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobDone.wait(lock, [this] { return !hasJob; });
+}
+
+void OcclusionCuller::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeWorker.wait(lock, [this] { return hasJob || quit; });
+        if (quit) {
+            return;
+        }
+
+        // The main thread doesn't touch the job between submit() and wait(), so no lock is needed while working
+        lock.unlock();
+        process();
+        lock.lock();
+
+        hasJob = false;
+        lastStats = workerStats;
+        jobDone.notify_all();
+    }
+}
+
+void OcclusionCuller::process() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    buffer.clear();
+    for (const OccluderInstance& occluder : pendingJob.occluders) {
+        buffer.rasterizeOccluder(*occluder.vertices, *occluder.indices, pendingJob.viewProj * occluder.model);
+    }
+    buffer.buildHierarchy();
+
+    OcclusionStats stats;
+    visible.resize(pendingJob.bounds.size());
+    for (size_t i = 0; i < pendingJob.bounds.size(); ++i) {
+        const glm::vec4& sphere = pendingJob.bounds[i];
+        bool onScreen = true;
+        bool isVisible = buffer.isSphereVisible(glm::vec3(sphere), sphere.w, pendingJob.viewProj, onScreen);
+        visible[i] = isVisible ? 1 : 0;
+        stats.tested++;
+        if (!onScreen) {
+            stats.frustumCulled++;
+        } else if (!isVisible) {
+            stats.occlusionCulled++;
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.cpuMs = std::chrono::duration<float, std::milli>(end - start).count();
+    workerStats = stats;
+}
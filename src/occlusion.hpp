@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Low resolution CPU depth buffer for occlusion culling.
+//
+// Occluders are rasterised at 256x128 with depth in [0, 1] (1 is the far plane). After rasterisation the buffer is
+// reduced to two levels of max-depth tiles: an object is hidden when its nearest depth is behind the farthest occluder
+// depth of every tile its screen rectangle touches.
+class OcclusionBuffer {
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 128;
+    static const int TILE_SIZE = 8;                          // fine tiles, 32x16 of them
+    static const int COARSE_TILE_SIZE = 32;                  // coarse tiles, 8x4 of them
+    static const int TILES_X = WIDTH / TILE_SIZE;
+    static const int TILES_Y = HEIGHT / TILE_SIZE;
+    static const int COARSE_TILES_X = WIDTH / COARSE_TILE_SIZE;
+    static const int COARSE_TILES_Y = HEIGHT / COARSE_TILE_SIZE;
+
+    OcclusionBuffer();
+
+    void clear();
+    void rasterizeOccluder(const std::vector<glm::vec3>& vertices, const std::vector<GLuint>& indices,
+                           const glm::mat4& mvp);
+    void buildHierarchy();
+
+    // Tests a world space bounding sphere. Spheres crossing the near plane are always visible.
+    bool isSphereVisible(const glm::vec3& center, float radius, const glm::mat4& viewProj, bool& onScreen) const;
+
+private:
+    std::vector<float> depth;
+    std::vector<glm::vec4> screen;     // per-vertex scratch, kept to avoid reallocating for every occluder
+    float tileMax[TILES_Y][TILES_X];
+    float coarseTileMax[COARSE_TILES_Y][COARSE_TILES_X];
+
+    void rasterizeTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+    bool isRectVisible(int minX, int minY, int maxX, int maxY, float nearestDepth) const;
+};
+
+struct OccluderInstance {
+    const std::vector<glm::vec3>* vertices;
+    const std::vector<GLuint>* indices;
+    glm::mat4 model;
+};
+
+struct OcclusionJob {
+    glm::mat4 viewProj;
+    std::vector<OccluderInstance> occluders;
+    std::vector<glm::vec4> bounds;      // xyz centre, w radius, world space
+};
+
+struct OcclusionStats {
+    uint32_t tested = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t occlusionCulled = 0;
+    float cpuMs = 0.0f;
+
+    float culledPercent() const {
+        return tested == 0 ? 0.0f : 100.0f * (float) (frustumCulled + occlusionCulled) / (float) tested;
+    }
+};
+
+// Runs OcclusionBuffer on a worker thread. The main thread fills job(), calls submit() as early in the frame as it
+// can, does its other CPU work while the worker rasterises (and the GPU is still busy with the previous frame), then
+// calls wait() right before issuing draws.
+class OcclusionCuller {
+public:
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    OcclusionJob& job() { return pendingJob; }
+    void submit();
+    // Blocks until the submitted job is done. visibility()[i] then belongs to job().bounds[i].
+    void wait();
+
+    const std::vector<uint8_t>& visibility() const { return visible; }
+    // Stats of the last finished job, safe to call while a job is running
+    OcclusionStats stats() const;
+
+private:
+    OcclusionBuffer buffer;
+    OcclusionJob pendingJob;
+    std::vector<uint8_t> visible;
+    OcclusionStats workerStats;
+    OcclusionStats lastStats;
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable wakeWorker;
+    std::condition_variable jobDone;
+    bool hasJob = false;
+    bool quit = false;
+
+    void run();
+    void process();
+};
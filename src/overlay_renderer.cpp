@@ -0,0 +1,166 @@
+#include "overlay_renderer.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Normals of joins get longer as the angle gets sharper, up to this squared inverse length (10 times at most), as
+// ImGui limits its own mitres
+static const float MAX_MITRE_SQUARED = 100.0f;
+static const float FRINGE = 1.0f;
+
+static ImU32 HSVtoRGB(float h, float s, float v) {
+    float r, g, b;
+
+    int i = int(h * 6);
+    float f = h * 6 - i;
+    float p = v * (1 - s);
+    float q = v * (1 - f * s);
+    float t = v * (1 - (1 - f) * s);
+
+    switch (i % 6) {
+        case 0: r = v, g = t, b = p; break;
+        case 1: r = q, g = v, b = p; break;
+        case 2: r = p, g = v, b = t; break;
+        case 3: r = p, g = q, b = v; break;
+        case 4: r = t, g = p, b = v; break;
+        case 5: r = v, g = p, b = q; break;
+    }
+
+    return IM_COL32(int(r * 255), int(g * 255), int(b * 255), 255);
+}
+
+OverlayRenderer::OverlayRenderer() {
+    for (int k = 0; k < HUE_STEPS; ++k) {
+        hueRamp[k] = HSVtoRGB((k + 0.5f) / HUE_STEPS, 1.0f, 1.0f);
+    }
+}
+
+void OverlayRenderer::drawDepthCurve(ImDrawList* drawList, const glm::vec3* points, size_t count, const ImVec2& origin,
+                                     const ImVec2& size) {
+    lastStats = OverlayStats();
+    if (count < 2) {
+        return;
+    }
+
+    screen.resize(count);
+    normals.resize(count);
+    halfWidths.resize(count);
+    colors.resize(count);
+    visible.resize(count - 1);
+
+    for (size_t i = 0; i < count; ++i) {
+        screen[i] = ImVec2(origin.x + points[i].x * size.x, origin.y + points[i].y * size.y);
+        float depth = (points[i].z + 1.0f) * 0.5f;
+        // Thinner further back. Points behind z = 1 stay at one pixel, hues wrap around as HSV does.
+        halfWidths[i] = std::max(1.0f, std::min(5.0f - depth * 4.0f, 5.0f)) * 0.5f;
+        float hue = std::max(depth, 0.0f) * 0.8f;
+        hue -= std::floor(hue);
+        colors[i] = hueRamp[std::min((int) (hue * HUE_STEPS), HUE_STEPS - 1)];
+    }
+
+    // A point's normal is the mean of the normals of the segments either side of it, divided by its squared length:
+    // offsetting both edges by it keeps them at the half width from each segment
+    ImVec2 previous(0.0f, 0.0f);
+    for (size_t i = 0; i < count; ++i) {
+        ImVec2 next = previous;
+        if (i + 1 < count) {
+            float dx = screen[i + 1].x - screen[i].x;
+            float dy = screen[i + 1].y - screen[i].y;
+            float length = std::sqrt(dx * dx + dy * dy);
+            next = length > 0.0f ? ImVec2(dy / length, -dx / length) : previous;
+        }
+        if (i == 0) {
+            previous = next;
+        }
+        ImVec2 mean((previous.x + next.x) * 0.5f, (previous.y + next.y) * 0.5f);
+        float lengthSquared = mean.x * mean.x + mean.y * mean.y;
+        float scale = lengthSquared > 1e-6f ? std::min(1.0f / lengthSquared, MAX_MITRE_SQUARED) : 1.0f;
+        normals[i] = ImVec2(mean.x * scale, mean.y * scale);
+        previous = next;
+    }
+
+    const bool antiAliased = (drawList->Flags & ImDrawListFlags_AntiAliasedLines) != 0;
+    const float fringe = antiAliased ? FRINGE : 0.0f;
+    const ImVec2 clipMin = drawList->GetClipRectMin();
+    const ImVec2 clipMax = drawList->GetClipRectMax();
+    for (size_t i = 0; i + 1 < count; ++i) {
+        // Everything the segment's vertices can reach
+        float reach = 0.0f;
+        for (size_t k = i; k <= i + 1; ++k) {
+            float normalLength = std::sqrt(normals[k].x * normals[k].x + normals[k].y * normals[k].y);
+            reach = std::max(reach, halfWidths[k] * normalLength + fringe);
+        }
+        float minX = std::min(screen[i].x, screen[i + 1].x) - reach;
+        float maxX = std::max(screen[i].x, screen[i + 1].x) + reach;
+        float minY = std::min(screen[i].y, screen[i + 1].y) - reach;
+        float maxY = std::max(screen[i].y, screen[i + 1].y) + reach;
+        visible[i] = maxX >= clipMin.x && minX <= clipMax.x && maxY >= clipMin.y && minY <= clipMax.y;
+    }
+
+    // Runs of visible segments, each one strip
+    size_t i = 0;
+    while (i + 1 < count) {
+        if (!visible[i]) {
+            lastStats.culled++;
+            i++;
+            continue;
+        }
+        size_t first = i;
+        while (i + 1 < count && visible[i]) {
+            i++;
+        }
+        writeStrip(drawList, first, i, antiAliased);
+    }
+}
+
+void OverlayRenderer::writeStrip(ImDrawList* drawList, size_t first, size_t last, bool antiAliased) {
+    const int perPoint = antiAliased ? 4 : 2;
+    const int perSegment = antiAliased ? 18 : 6;
+    const ImVec2 uv = drawList->_Data->TexUvWhitePixel;
+
+    // Chunks share their end points, so the strip stays closed across them
+    for (size_t start = first; start < last; start += MAX_CHUNK_POINTS - 1) {
+        size_t end = std::min(start + MAX_CHUNK_POINTS - 1, last);
+        int pointCount = (int) (end - start + 1);
+        drawList->PrimReserve((pointCount - 1) * perSegment, pointCount * perPoint);
+        // After PrimReserve(), which may have started a new draw command with its own vertex offset
+        unsigned int base = drawList->_VtxCurrentIdx;
+
+        for (size_t k = start; k <= end; ++k) {
+            const ImVec2& p = screen[k];
+            const ImVec2& n = normals[k];
+            ImU32 color = colors[k];
+            if (antiAliased) {
+                // Full colour inside, fading out over the fringe
+                float inner = std::max(halfWidths[k] - FRINGE * 0.5f, 0.0f);
+                float outer = inner + FRINGE;
+                ImU32 transparent = color & ~IM_COL32_A_MASK;
+                drawList->PrimWriteVtx(ImVec2(p.x + n.x * outer, p.y + n.y * outer), uv, transparent);
+                drawList->PrimWriteVtx(ImVec2(p.x + n.x * inner, p.y + n.y * inner), uv, color);
+                drawList->PrimWriteVtx(ImVec2(p.x - n.x * inner, p.y - n.y * inner), uv, color);
+                drawList->PrimWriteVtx(ImVec2(p.x - n.x * outer, p.y - n.y * outer), uv, transparent);
+            } else {
+                float w = halfWidths[k];
+                drawList->PrimWriteVtx(ImVec2(p.x + n.x * w, p.y + n.y * w), uv, color);
+                drawList->PrimWriteVtx(ImVec2(p.x - n.x * w, p.y - n.y * w), uv, color);
+            }
+        }
+
+        // One quad per pair of neighbouring edges, between a point's vertices and the next one's
+        for (int k = 0; k + 1 < pointCount; ++k) {
+            unsigned int v = base + k * perPoint;
+            unsigned int next = v + perPoint;
+            for (int q = 0; q + 1 < perPoint; ++q) {
+                drawList->PrimWriteIdx((ImDrawIdx) (v + q));
+                drawList->PrimWriteIdx((ImDrawIdx) (v + q + 1));
+                drawList->PrimWriteIdx((ImDrawIdx) (next + q + 1));
+                drawList->PrimWriteIdx((ImDrawIdx) (v + q));
+                drawList->PrimWriteIdx((ImDrawIdx) (next + q + 1));
+                drawList->PrimWriteIdx((ImDrawIdx) (next + q));
+            }
+        }
+
+        lastStats.segments += (uint32_t) (pointCount - 1);
+        lastStats.vertices += (uint32_t) (pointCount * perPoint);
+        lastStats.reservations++;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "imgui.h"
+
+struct OverlayStats {
+    uint32_t segments = 0;      // drawn by the last drawDepthCurve()
+    uint32_t culled = 0;        // outside the clip rect
+    uint32_t vertices = 0;
+    uint32_t reservations = 0;  // PrimReserve() calls
+};
+
+// Draws the overlay curves straight into an ImDrawList.
+//
+// AddLine() builds a path, strokes it and reserves vertices once per segment, and the overlay used to convert a colour
+// from HSV twice for each. drawDepthCurve() instead computes the screen position, width and colour of every point
+// once, the colour from a precomputed hue ramp, and writes the whole curve as one triangle strip with mitred joins:
+// four vertices per point (an anti-aliasing fringe on either side, as ImGui draws thick lines) or two when the draw
+// list doesn't anti-alias. Segments outside the clip rect are skipped, the strip restarting after them. Vertices are
+// reserved in chunks of at most MAX_CHUNK_POINTS points so the indices of one reservation always fit 16 bits.
+class OverlayRenderer {
+public:
+    static const int HUE_STEPS = 256;
+    static const size_t MAX_CHUNK_POINTS = 4096;
+
+    OverlayRenderer();
+
+    // A polyline with x and y in [0, 1] of the rectangle at origin, z in [-1, 1] setting hue and width: 5 pixels wide
+    // in front, 1 at the back
+    void drawDepthCurve(ImDrawList* drawList, const glm::vec3* points, size_t count, const ImVec2& origin,
+                        const ImVec2& size);
+    void drawDepthCurve(ImDrawList* drawList, const std::vector<glm::vec3>& points, const ImVec2& origin,
+                        const ImVec2& size) {
+        drawDepthCurve(drawList, points.data(), points.size(), origin, size);
+    }
+
+    const OverlayStats& stats() const { return lastStats; }
+
+private:
+    ImU32 hueRamp[HUE_STEPS];   // hue 0 .. 1 at full saturation and value
+    // Per point, kept between frames so drawing doesn't allocate
+    std::vector<ImVec2> screen;
+    std::vector<ImVec2> normals;    // mitred, scaled so offsetting by the half width keeps the edges parallel
+    std::vector<float> halfWidths;
+    std::vector<ImU32> colors;
+    std::vector<uint8_t> visible;   // per segment
+    OverlayStats lastStats;
+
+    void writeStrip(ImDrawList* drawList, size_t first, size_t last, bool antiAliased);
+};
@@ -0,0 +1,163 @@
+#include "piecewise_path.hpp"
+#include <algorithm>
+
+void PiecewisePath::setBasis(PathBasis basis) {
+    if (basis == pathBasis) {
+        return;
+    }
+    pathBasis = basis;
+    resize();
+}
+
+bool PiecewisePath::sync(const glm::vec3* source, size_t count, uint32_t sourceVersion) {
+    if (sourceVersion == seenSourceVersion) {
+        return false;
+    }
+    seenSourceVersion = sourceVersion;
+
+    if (count != points.size()) {
+        points.assign(source, source + count);
+        resize();
+        return true;
+    }
+
+    lastStats.rebuiltSegments = 0;
+    bool changed = false;
+    for (size_t i = 0; i < count; ++i) {
+        if (source[i] != points[i]) {
+            points[i] = source[i];
+            rebuildAround(i);
+            changed = true;
+        }
+    }
+    if (changed) {
+        updateStarts();
+    }
+    return changed;
+}
+
+void PiecewisePath::setPoint(size_t index, const glm::vec3& point) {
+    if (index >= points.size() || points[index] == point) {
+        return;
+    }
+    points[index] = point;
+    lastStats.rebuiltSegments = 0;
+    rebuildAround(index);
+    updateStarts();
+}
+
+void PiecewisePath::resize() {
+    int count = (int) points.size();
+    segments.assign(count < 2 ? 0 : (size_t) (count - 3 + 2 * lead()), Segment());
+    segmentPoints.resize(segments.size() * 4);
+    lastStats.segments = (uint32_t) segments.size();
+    lastStats.rebuiltSegments = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        rebuildSegment(i);
+    }
+    updateStarts();
+    tessellatedPointsPerSegment = -1;
+}
+
+void PiecewisePath::rebuildSegment(size_t index) {
+    int last = (int) points.size() - 1;
+    glm::vec3 p[4];
+    for (int k = 0; k < 4; ++k) {
+        p[k] = points[std::max(0, std::min((int) index - lead() + k, last))];
+    }
+
+    glm::vec3 bezier[4];
+    if (pathBasis == PathBasis::B_SPLINE) {
+        bezier[0] = (p[0] + 4.0f * p[1] + p[2]) / 6.0f;
+        bezier[1] = (2.0f * p[1] + p[2]) / 3.0f;
+        bezier[2] = (p[1] + 2.0f * p[2]) / 3.0f;
+        bezier[3] = (p[1] + 4.0f * p[2] + p[3]) / 6.0f;
+    } else {
+        bezier[0] = p[1];
+        bezier[1] = p[1] + (p[2] - p[0]) / 6.0f;
+        bezier[2] = p[2] - (p[3] - p[1]) / 6.0f;
+        bezier[3] = p[2];
+    }
+
+    std::copy(bezier, bezier + 4, &segmentPoints[index * 4]);
+    Segment& segment = segments[index];
+    segment.curve.setControlPoints(bezier, 4);
+    segment.arcLength.build(bezier, 4, ARC_LENGTH_INTERVALS);
+    segment.tessellationDirty = true;
+    lastStats.rebuiltSegments++;
+}
+
+void PiecewisePath::rebuildAround(size_t point) {
+    // Segment i uses points i - lead() .. i - lead() + 3
+    int first = std::max((int) point + lead() - 3, 0);
+    int last = std::min((int) point + lead(), (int) segments.size() - 1);
+    for (int i = first; i <= last; ++i) {
+        rebuildSegment((size_t) i);
+    }
+}
+
+void PiecewisePath::updateStarts() {
+    pathVersion++;
+    segmentStarts.resize(segments.size() + 1);
+    segmentStarts[0] = 0.0f;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        segmentStarts[i + 1] = segmentStarts[i] + segments[i].arcLength.length();
+    }
+}
+
+glm::vec3 PiecewisePath::evaluate(float u) const {
+    if (segments.empty()) {
+        return points.empty() ? glm::vec3(0.0f) : points[0];
+    }
+    float position = std::max(0.0f, std::min(u, 1.0f)) * (float) segments.size();
+    size_t index = std::min((size_t) position, segments.size() - 1);
+    return segments[index].curve.evaluate(position - (float) index);
+}
+
+float PiecewisePath::parameterAt(float distance) const {
+    float total = length();
+    if (total <= 0.0f) {
+        return std::max(0.0f, std::min(distance, 1.0f));
+    }
+    if (distance <= 0.0f) {
+        return 0.0f;
+    }
+    if (distance >= total) {
+        // total - start of the last segment needn't round to its length, which near a clamped end is far from t = 1
+        return 1.0f;
+    }
+
+    size_t index = (size_t) (std::upper_bound(segmentStarts.begin() + 1, segmentStarts.end(), distance) -
+                             segmentStarts.begin()) - 1;
+    index = std::min(index, segments.size() - 1);
+    float t = segments[index].arcLength.parameterAt(distance - segmentStarts[index]);
+    return ((float) index + t) / (float) segments.size();
+}
+
+const std::vector<glm::vec3>& PiecewisePath::tessellation(int pointsPerSegment) {
+    pointsPerSegment = std::max(pointsPerSegment, 1);
+    bool all = pointsPerSegment != tessellatedPointsPerSegment;
+    tessellated.resize(segments.size() * pointsPerSegment + 1);
+    tessellatedPointsPerSegment = pointsPerSegment;
+    if (all) {
+        segmentTs.resize(pointsPerSegment);
+        for (int i = 0; i < pointsPerSegment; ++i) {
+            segmentTs[i] = (float) i / (float) pointsPerSegment;
+        }
+    }
+
+    uint32_t count = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        Segment& segment = segments[i];
+        if (all || segment.tessellationDirty) {
+            segment.curve.evaluate(segmentTs.data(), &tessellated[i * pointsPerSegment], segmentTs.size());
+            segment.tessellationDirty = false;
+            count++;
+        }
+    }
+    tessellated.back() = segments.empty() ? evaluate(0.0f) : segments.back().curve.evaluate(1.0f);
+    if (count > 0) {
+        lastStats.tessellatedSegments = count;
+    }
+    return tessellated;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "arc_length.hpp"
+#include "bezier_curve.hpp"
+
+enum class PathBasis : uint8_t {
+    CATMULL_ROM = 0,    // through every control point
+    B_SPLINE = 1        // uniform cubic B-spline, through the end points only
+};
+
+struct PathStats {
+    uint32_t segments = 0;
+    uint32_t rebuiltSegments = 0;       // by the last change
+    uint32_t tessellatedSegments = 0;   // by the last tessellation() that did any work
+};
+
+// A path of cubic segments through (or near) a list of control points.
+//
+// Every segment depends on four consecutive control points only, the ends are clamped by repeating the first and last
+// point. Segments are converted to cubic Bezier form and keep their own arc-length table and tessellated points, so
+// moving one control point rebuilds at most four segments whatever the path length. Only the running sum of segment
+// lengths is redone for the whole path, which is one addition per segment.
+//
+// The path parameter u runs from 0 to 1 with every segment taking an equal share.
+class PiecewisePath {
+public:
+    static const int ARC_LENGTH_INTERVALS = 8;  // per segment
+
+    void setBasis(PathBasis basis);
+    PathBasis basis() const { return pathBasis; }
+
+    // Takes the control points if sourceVersion differs from the last sync, rebuilding only the segments around points
+    // that actually moved. Returns true if anything changed.
+    bool sync(const glm::vec3* points, size_t count, uint32_t sourceVersion);
+    bool sync(const std::vector<glm::vec3>& points, uint32_t sourceVersion) {
+        return sync(points.data(), points.size(), sourceVersion);
+    }
+    void setPoint(size_t index, const glm::vec3& point);
+
+    glm::vec3 evaluate(float u) const;
+    float length() const { return segmentStarts.empty() ? 0.0f : segmentStarts.back(); }
+    // u at which the path is distance long
+    float parameterAt(float distance) const;
+    float parameterAtFraction(float fraction) const { return parameterAt(fraction * length()); }
+
+    // pointsPerSegment points for every segment plus the end point. Only segments changed since the last call are
+    // re-evaluated, as long as pointsPerSegment stays the same.
+    const std::vector<glm::vec3>& tessellation(int pointsPerSegment);
+
+    // Control points of every segment in Bezier form, four per segment, e.g. for CurveRenderer
+    const std::vector<glm::vec3>& bezierPoints() const { return segmentPoints; }
+    // Changes whenever the segments do
+    uint32_t version() const { return pathVersion; }
+
+    size_t segmentCount() const { return segments.size(); }
+    const PathStats& stats() const { return lastStats; }
+
+private:
+    struct Segment {
+        BezierCurve curve;
+        ArcLengthTable arcLength;
+        bool tessellationDirty = true;
+    };
+
+    PathBasis pathBasis = PathBasis::B_SPLINE;
+    std::vector<glm::vec3> points;
+    std::vector<Segment> segments;
+    std::vector<float> segmentStarts;   // length up to each segment, and the total last
+    std::vector<glm::vec3> segmentPoints;
+    uint32_t pathVersion = 0;
+    uint32_t seenSourceVersion = 0;     // sources start at 1, so the first sync always builds
+    std::vector<glm::vec3> tessellated;
+    int tessellatedPointsPerSegment = -1;
+    std::vector<float> segmentTs;       // segment parameters of the tessellated points
+    PathStats lastStats;
+
+    // Points before segment i starts at its first control point
+    int lead() const { return pathBasis == PathBasis::B_SPLINE ? 2 : 1; }
+    void resize();
+    void rebuildSegment(size_t index);
+    void rebuildAround(size_t point);
+    void updateStarts();
+};
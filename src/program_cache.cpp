@@ -0,0 +1,227 @@
+#include "program_cache.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const char CACHE_MAGIC[4] = { 'P', 'B', 'I', 'N' };
+static const uint32_t CACHE_FORMAT_VERSION = 1;
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t length;
+};
+
+uint64_t fnv1a64(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hashString(const std::string& str, uint64_t seed) {
+    // Hash the length too so ("ab", "c") and ("a", "bc") differ
+    uint64_t length = str.size();
+    return fnv1a64(str.data(), str.size(), fnv1a64(&length, sizeof(length), seed));
+}
+
+static std::string glString(GLenum name) {
+    const GLubyte* str = glGetString(name);
+    return str ? std::string((const char*) str) : std::string();
+}
+
+std::string InjectDefines(const std::string& source, const std::string& defines) {
+    if (defines.empty()) {
+        return source;
+    }
+    size_t versionLine = source.find("#version");
+    if (versionLine == std::string::npos) {
+        return defines + "\n" + source;
+    }
+    size_t lineEnd = source.find('\n', versionLine);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + defines + "\n";
+    }
+    return source.substr(0, lineEnd + 1) + defines + "\n" + source.substr(lineEnd + 1);
+}
+
+ProgramCache::ProgramCache(const std::string& directory) : directory(directory), enabled(true) {
+    driverHash = hashString(glString(GL_VENDOR), 14695981039346656037ull);
+    driverHash = hashString(glString(GL_RENDERER), driverHash);
+    driverHash = hashString(glString(GL_VERSION), driverHash);
+    driverHash = hashString(glString(GL_SHADING_LANGUAGE_VERSION), driverHash);
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    GLint formats = 0;
+    if (major > 4 || (major == 4 && minor >= 1) || GLEW_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    binarySupported = formats > 0;
+
+    if (binarySupported) {
+        std::error_code error;
+        fs::create_directories(directory, error);
+        if (error) {
+            std::cout << "[WARNING][ProgramCache] Can't create \"" << directory << "\": " << error.message() << std::endl;
+            binarySupported = false;
+        }
+    }
+}
+
+uint64_t ProgramCache::key(const std::string& vertexSource, const std::string& fragmentSource,
+                           const std::string& defines) const {
+    uint64_t hash = hashString(vertexSource, driverHash);
+    hash = hashString(fragmentSource, hash);
+    return hashString(defines, hash);
+}
+
+uint64_t ProgramCache::key(uint64_t vertexHash, uint64_t fragmentHash) const {
+    uint64_t hash = fnv1a64(&vertexHash, sizeof(vertexHash), driverHash);
+    return fnv1a64(&fragmentHash, sizeof(fragmentHash), hash);
+}
+
+std::string ProgramCache::pathFor(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) key);
+    return (fs::path(directory) / name).string();
+}
+
+ShaderProgram ProgramCache::loadFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                                      const std::string& defines) {
+    return load(ParseShader(vertexPath), ParseShader(fragmentPath), defines);
+}
+
+ShaderProgram ProgramCache::load(const std::string& vertexSource, const std::string& fragmentSource,
+                                 const std::string& defines) {
+    auto start = std::chrono::steady_clock::now();
+    bool useCache = usable();
+    uint64_t programKey = key(vertexSource, fragmentSource, defines);
+
+    GLuint program = useCache ? loadBinary(programKey) : 0;
+    if (program == 0) {
+        program = compile(InjectDefines(vertexSource, defines), InjectDefines(fragmentSource, defines), useCache);
+        if (program != 0 && useCache) {
+            storeBinary(programKey, program);
+        }
+    }
+
+    cacheStats.loadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return program != 0 ? ShaderProgram(program) : ShaderProgram();
+}
+
+GLuint ProgramCache::loadBinary(uint64_t key) {
+    std::string path = pathFor(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return 0;
+    }
+
+    CacheHeader header;
+    if (!file.read((char*) &header, sizeof(header))
+        || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.version != CACHE_FORMAT_VERSION || header.key != key) {
+        file.close();
+        std::remove(path.c_str());
+        cacheStats.rejected++;
+        return 0;
+    }
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), header.length)) {
+        file.close();
+        std::remove(path.c_str());
+        cacheStats.rejected++;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei) header.length);
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // The driver changed underneath us, fall back to compiling
+        glDeleteProgram(program);
+        file.close();
+        std::remove(path.c_str());
+        cacheStats.rejected++;
+        return 0;
+    }
+    cacheStats.hits++;
+    return program;
+}
+
+void ProgramCache::storeBinary(uint64_t key, GLuint program) {
+    cacheStats.misses++;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum binaryFormat = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &binaryFormat, binary.data());
+    if (written <= 0) {
+        return;
+    }
+
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_FORMAT_VERSION;
+    header.key = key;
+    header.binaryFormat = binaryFormat;
+    header.length = (uint32_t) written;
+
+    // Write to a temporary file and rename, so a crash or a second instance never sees half a binary
+    std::string path = pathFor(key);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write((const char*) &header, sizeof(header)) || !file.write(binary.data(), written)) {
+            std::cout << "[WARNING][ProgramCache] Can't write \"" << temporary << "\"" << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    fs::rename(temporary, path, error);
+    if (error) {
+        fs::remove(temporary, error);
+    }
+}
+
+GLuint ProgramCache::compile(const std::string& vertexSource, const std::string& fragmentSource, bool retrievable) {
+    unsigned int vertexShaderID = CompileShaderSource(ShaderType::VERTEX, vertexSource);
+    unsigned int fragShaderID = CompileShaderSource(ShaderType::FRAGMENT, fragmentSource);
+
+    GLuint program = glCreateProgram();
+    if (retrievable) {
+        // Has to be set before linking for glGetProgramBinary to return anything
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(program, vertexShaderID);
+    glAttachShader(program, fragShaderID);
+    glLinkProgram(program);
+
+    // delete shaders since we have linked them
+    glDeleteShader(vertexShaderID);
+    glDeleteShader(fragShaderID);
+
+    if (!CheckProgramStatus(program)) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <GL/glew.h>
+#include "shader_program.hpp"
+
+// 64-bit FNV-1a over raw bytes, chainable through seed
+uint64_t fnv1a64(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+// Inserts a block of "#define ..." lines right after the #version line, which must stay the first statement
+std::string InjectDefines(const std::string& source, const std::string& defines);
+
+struct ProgramCacheStats {
+    uint32_t hits = 0;
+    uint32_t misses = 0;     // compiled from source, binary written
+    uint32_t rejected = 0;   // binary found but the driver refused it
+    double loadMs = 0.0;     // total time spent in load()
+};
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+//
+// The key hashes both shader sources, the injected defines and the GL vendor, renderer, version and GLSL version
+// strings; the version string is where drivers report their own version. A binary for another driver or other sources
+// simply has a different file name. If the driver still rejects a binary (e.g. after an update that didn't change the
+// version string) the file is deleted and the program is compiled from source.
+class ProgramCache {
+public:
+    // Must be constructed with a current GL context
+    explicit ProgramCache(const std::string& directory);
+
+    ShaderProgram load(const std::string& vertexSource, const std::string& fragmentSource,
+                       const std::string& defines = "");
+    ShaderProgram loadFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                            const std::string& defines = "");
+
+    // For callers that compile themselves (e.g. asynchronously): returns 0 on a miss
+    GLuint loadBinary(uint64_t key);
+    // program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    void storeBinary(uint64_t key, GLuint program);
+
+    // Program binaries need GL 4.1 or ARB_get_program_binary and at least one binary format
+    bool supported() const { return binarySupported; }
+    bool usable() const { return enabled && binarySupported; }
+    void setEnabled(bool enable) { enabled = enable; }
+    const ProgramCacheStats& stats() const { return cacheStats; }
+
+    uint64_t key(const std::string& vertexSource, const std::string& fragmentSource, const std::string& defines) const;
+    // From content hashes known in advance, e.g. computed when the shaders were embedded at build time
+    uint64_t key(uint64_t vertexHash, uint64_t fragmentHash) const;
+
+private:
+    std::string directory;
+    uint64_t driverHash;
+    bool binarySupported;
+    bool enabled;
+    ProgramCacheStats cacheStats;
+
+    std::string pathFor(uint64_t key) const;
+    GLuint compile(const std::string& vertexSource, const std::string& fragmentSource, bool retrievable);
+};
@@ -0,0 +1,202 @@
+#include "render_queue.hpp"
+#include <algorithm>
+#include <cstring>
+
+static const int PASS_SHIFT = 60;
+static const int PROGRAM_SHIFT = 48;
+static const int MATERIAL_SHIFT = 36;
+static const int VAO_SHIFT = 24;
+static const uint64_t FIELD_MASK_12 = 0xFFFu;
+static const uint64_t DEPTH_MASK = 0xFFFFFFu;
+
+uint64_t makeDrawKey(RenderPass pass, GLuint program, uint32_t material, GLuint vao, uint32_t depthBucket) {
+    return ((uint64_t) pass & 0xFu) << PASS_SHIFT
+           | ((uint64_t) program & FIELD_MASK_12) << PROGRAM_SHIFT
+           | ((uint64_t) material & FIELD_MASK_12) << MATERIAL_SHIFT
+           | ((uint64_t) vao & FIELD_MASK_12) << VAO_SHIFT
+           | ((uint64_t) depthBucket & DEPTH_MASK);
+}
+
+uint32_t depthBucket(float viewDepth, float nearPlane, float farPlane) {
+    float normalized = (viewDepth - nearPlane) / (farPlane - nearPlane);
+    normalized = std::min(std::max(normalized, 0.0f), 1.0f);
+    return (uint32_t) (normalized * (float) DEPTH_MASK);
+}
+
+static RenderPass passOfKey(uint64_t key) {
+    return (RenderPass) (key >> PASS_SHIFT);
+}
+
+const char* renderPassName(RenderPass pass) {
+    switch (pass) {
+        case RenderPass::DEPTH_PREPASS: return "Depth pre-pass";
+        case RenderPass::OPAQUE: return "Opaque";
+        default: return "Unknown";
+    }
+}
+
+RenderQueue::RenderQueue() {
+    for (uint32_t& cap : passCaps) {
+        cap = NO_CAP;
+    }
+}
+
+void RenderQueue::clear() {
+    // Keep the capacity, the same number of draws usually comes back next frame
+    commands.clear();
+    owners.clear();
+    kept.clear();
+    entries.clear();
+    for (RenderPassStats& s : passStats) {
+        s = RenderPassStats();
+    }
+}
+
+uint32_t RenderQueue::submit(RenderPass pass, const DrawCommand& command, float viewDepth, float nearPlane,
+                             float farPlane) {
+    uint32_t bucket = depthBucket(viewDepth, nearPlane, farPlane);
+    SortEntry entry;
+    entry.key = makeDrawKey(pass, command.program->id(), command.material, command.vao, bucket);
+    entry.index = (uint32_t) commands.size();
+    entries.push_back(entry);
+    commands.push_back(command);
+    owners.push_back(NO_OWNER);
+    kept.push_back(1);
+    passStats[(size_t) pass].submitted++;
+    return entry.index;
+}
+
+void RenderQueue::submitLinked(uint32_t owner, RenderPass pass, const DrawCommand& command, float viewDepth,
+                               float nearPlane, float farPlane) {
+    owners[submit(pass, command, viewDepth, nearPlane, farPlane)] = owner;
+}
+
+void RenderQueue::sort() {
+    radixSort();
+    applyCaps();
+}
+
+// Caps keep the first draws of each pass in sorted order. Linked draws follow their owner instead, which may sort
+// quite differently in its own pass (the pre-pass sorts by depth, the opaque pass by state first).
+void RenderQueue::applyCaps() {
+    uint32_t counts[(size_t) RenderPass::COUNT] = {};
+    for (const SortEntry& entry : entries) {
+        if (owners[entry.index] != NO_OWNER) {
+            continue;
+        }
+        size_t pass = (size_t) passOfKey(entry.key);
+        kept[entry.index] = counts[pass] < passCaps[pass];
+        counts[pass] += kept[entry.index];
+    }
+    for (size_t i = 0; i < commands.size(); ++i) {
+        if (owners[i] != NO_OWNER) {
+            kept[i] = kept[owners[i]];
+        }
+    }
+}
+
+// LSD radix sort on 8-bit digits. All eight histograms are built in a single pass over the keys, and digits where
+// every key falls into the same bucket (common for the high pass/program bytes) are skipped entirely.
+void RenderQueue::radixSort() {
+    const size_t count = entries.size();
+    if (count < 2) {
+        return;
+    }
+
+    uint32_t histograms[8][256];
+    std::memset(histograms, 0, sizeof(histograms));
+    for (const SortEntry& entry : entries) {
+        for (int digit = 0; digit < 8; ++digit) {
+            histograms[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+        }
+    }
+
+    scratch.resize(count);
+    SortEntry* src = entries.data();
+    SortEntry* dst = scratch.data();
+
+    for (int digit = 0; digit < 8; ++digit) {
+        uint32_t* histogram = histograms[digit];
+        if (histogram[(src[0].key >> (digit * 8)) & 0xFF] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket) {
+            uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            dst[histogram[(src[i].key >> (digit * 8)) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != entries.data()) {
+        entries.swap(scratch);
+    }
+}
+
+void RenderQueue::execute(const DrawCallback& applyUniforms) {
+    executeRange(0, entries.size(), applyUniforms);
+}
+
+void RenderQueue::executePass(RenderPass pass, const DrawCallback& applyUniforms) {
+    auto byPass = [](const SortEntry& entry, RenderPass p) { return passOfKey(entry.key) < p; };
+    auto begin = std::lower_bound(entries.begin(), entries.end(), pass, byPass);
+    auto end = begin;
+    while (end != entries.end() && passOfKey(end->key) == pass) {
+        ++end;
+    }
+    executeRange(begin - entries.begin(), end - entries.begin(), applyUniforms);
+}
+
+void RenderQueue::executeRange(size_t begin, size_t end, const DrawCallback& applyUniforms) {
+    // GL state may have been changed by the caller between passes, so the cache starts empty for every range
+    GLuint boundProgram = 0;
+    GLuint boundVao = 0;
+
+    for (size_t i = begin; i < end; ++i) {
+        const SortEntry& entry = entries[i];
+        RenderPass pass = passOfKey(entry.key);
+        RenderPassStats& s = passStats[(size_t) pass];
+        if (!kept[entry.index]) {
+            s.dropped++;
+            continue;
+        }
+
+        const DrawCommand& command = commands[entry.index];
+        bool programChanged = command.program->id() != boundProgram;
+        if (programChanged) {
+            command.program->use();
+            boundProgram = command.program->id();
+            s.programBinds++;
+        }
+        if (command.vao != boundVao) {
+            glBindVertexArray(command.vao);
+            boundVao = command.vao;
+            s.vaoBinds++;
+        }
+
+        applyUniforms(command, programChanged);
+        glDrawElements(GL_TRIANGLES, command.indexCount, GL_UNSIGNED_INT, nullptr);
+        s.drawn++;
+    }
+
+    glUseProgram(0);
+    glBindVertexArray(0);
+}
+
+void RenderQueue::setPassCap(RenderPass pass, uint32_t maxDraws) {
+    passCaps[(size_t) pass] = maxDraws;
+}
+
+uint32_t RenderQueue::passCap(RenderPass pass) const {
+    return passCaps[(size_t) pass];
+}
+
+const RenderPassStats& RenderQueue::stats(RenderPass pass) const {
+    return passStats[(size_t) pass];
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader_program.hpp"
+
+// Passes are the most significant part of a draw key, so the queue executes them in this order.
+enum class RenderPass : uint8_t {
+    DEPTH_PREPASS = 0,
+    OPAQUE = 1,
+    COUNT
+};
+
+// Everything needed to issue one draw. The sorted key only refers to this by index.
+struct DrawCommand {
+    ShaderProgram* program;
+    GLuint vao;
+    GLsizei indexCount;
+    uint32_t material;
+    uint32_t transform;     // TransformBatch handle with the model, MVP and normal matrices
+    glm::mat4 model;        // copy of the model matrix for culling and sorting
+    glm::vec3 color;
+};
+
+struct RenderPassStats {
+    uint32_t submitted = 0;
+    uint32_t drawn = 0;
+    uint32_t dropped = 0;      // draws over the pass cap
+    uint32_t programBinds = 0;
+    uint32_t vaoBinds = 0;
+};
+
+// 64-bit draw key, most significant bits first:
+//   pass (4) | program (12) | material (12) | vao (12) | depth bucket (24)
+// GL names and material ids are masked to their field width, which only affects grouping, never the draw itself.
+uint64_t makeDrawKey(RenderPass pass, GLuint program, uint32_t material, GLuint vao, uint32_t depthBucket);
+
+// Quantises a positive view-space distance to a 24-bit bucket, near objects first.
+uint32_t depthBucket(float viewDepth, float nearPlane, float farPlane);
+
+class RenderQueue {
+public:
+    // Called before each draw with the program already bound, so command.program->set() applies to it.
+    // programChanged is true on the first draw after a program bind so per-frame uniforms (view, projection, lights)
+    // only need to be set then.
+    using DrawCallback = std::function<void(const DrawCommand& command, bool programChanged)>;
+
+    static constexpr uint32_t NO_CAP = 0xFFFFFFFFu;
+
+    RenderQueue();
+
+    void clear();
+    // Returns the index of the command, for submitLinked()
+    uint32_t submit(RenderPass pass, const DrawCommand& command, float viewDepth, float nearPlane, float farPlane);
+    // A draw that only makes sense together with an earlier submitted one, e.g. the pre-pass depth of an opaque draw.
+    // It ignores the cap of its own pass and is drawn exactly when the owner is, so the two passes never disagree
+    // about which objects made it. The owner must not be linked itself.
+    void submitLinked(uint32_t owner, RenderPass pass, const DrawCommand& command, float viewDepth, float nearPlane,
+                      float farPlane);
+    // Also decides which draws the caps keep, in the sorted order of each pass
+    void sort();
+    void execute(const DrawCallback& applyUniforms);
+
+    // Executes only the draws of one pass. Used when a pass needs different fixed-function state.
+    void executePass(RenderPass pass, const DrawCallback& applyUniforms);
+
+    void setPassCap(RenderPass pass, uint32_t maxDraws);
+    uint32_t passCap(RenderPass pass) const;
+    const RenderPassStats& stats(RenderPass pass) const;
+    size_t size() const { return commands.size(); }
+
+    // After sort(): the index of the command drawn at position, and whether a command survived the caps
+    uint32_t commandAt(size_t position) const { return entries[position].index; }
+    bool keeps(uint32_t index) const { return kept[index] != 0; }
+
+private:
+    struct SortEntry {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    static constexpr uint32_t NO_OWNER = 0xFFFFFFFFu;
+
+    std::vector<DrawCommand> commands;
+    std::vector<uint32_t> owners;       // per command, NO_OWNER unless submitted with submitLinked()
+    std::vector<uint8_t> kept;          // per command, whether it survived the caps
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+    RenderPassStats passStats[(size_t) RenderPass::COUNT];
+    uint32_t passCaps[(size_t) RenderPass::COUNT];
+
+    void radixSort();
+    void applyCaps();
+    void executeRange(size_t begin, size_t end, const DrawCallback& applyUniforms);
+};
+
+// Human readable name for stats output.
+const char* renderPassName(RenderPass pass);
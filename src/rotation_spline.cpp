@@ -0,0 +1,70 @@
+#include "rotation_spline.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Logarithm of a unit quaternion, the pure quaternion axis * angle / 2 returned as its vector part
+static glm::vec3 logUnit(const glm::quat& q) {
+    glm::vec3 v(q.x, q.y, q.z);
+    float length = std::sqrt(glm::dot(v, v));
+    if (length < 1e-7f) {
+        return v;
+    }
+    return v * (std::atan2(length, q.w) / length);
+}
+
+static glm::quat expPure(const glm::vec3& v) {
+    float angle = std::sqrt(glm::dot(v, v));
+    if (angle < 1e-7f) {
+        return glm::normalize(glm::quat(1.0f, v.x, v.y, v.z));
+    }
+    glm::vec3 axis = v * (std::sin(angle) / angle);
+    return glm::quat(std::cos(angle), axis.x, axis.y, axis.z);
+}
+
+bool RotationSpline::sync(const glm::quat* source, size_t count, uint32_t sourceVersion) {
+    if (sourceVersion == seenSourceVersion) {
+        return false;
+    }
+    seenSourceVersion = sourceVersion;
+
+    keys.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        // The UI edits raw components, so keys aren't necessarily unit length
+        glm::quat q = glm::normalize(source[i]);
+        if (i > 0 && glm::dot(keys[i - 1], q) < 0.0f) {
+            q = -q;
+        }
+        keys[i] = q;
+    }
+
+    intermediates.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (i == 0 || i + 1 == count) {
+            // Zero tangent at the ends
+            intermediates[i] = keys[i];
+            continue;
+        }
+        glm::quat inverse = glm::conjugate(keys[i]);
+        glm::vec3 tangent = logUnit(inverse * keys[i - 1]) + logUnit(inverse * keys[i + 1]);
+        intermediates[i] = keys[i] * expPure(tangent * -0.25f);
+    }
+    return true;
+}
+
+glm::quat RotationSpline::evaluate(float t) const {
+    if (keys.empty()) {
+        return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+    if (keys.size() == 1) {
+        return keys[0];
+    }
+
+    float position = std::max(0.0f, std::min(t, 1.0f)) * (float)(keys.size() - 1);
+    size_t i = std::min((size_t)position, keys.size() - 2);
+    float h = position - (float)i;
+
+    // glm::mix rather than glm::slerp: the keys are already in one hemisphere and the outer interpolation must not flip
+    glm::quat keyPath = glm::mix(keys[i], keys[i + 1], h);
+    glm::quat tangentPath = glm::mix(intermediates[i], intermediates[i + 1], h);
+    return glm::mix(keyPath, tangentPath, 2.0f * h * (1.0f - h));
+}
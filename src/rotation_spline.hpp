@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// A SQUAD spline through rotation keys spaced evenly over t = 0 .. 1.
+//
+// sync() normalises the keys, flips each into the hemisphere of the one before so the spline takes the short way,
+// and precomputes the intermediate quaternion of every key from the logarithms towards its neighbours:
+// s_i = q_i exp(-(log(q_i^-1 q_i-1) + log(q_i^-1 q_i+1)) / 4). evaluate() then costs the same three slerps (no logs or
+// exps) whatever the key count, and the orientation and its angular velocity are continuous across keys.
+class RotationSpline {
+public:
+    // Rebuilds the spline if sourceVersion differs from the last sync. Returns true if it did.
+    bool sync(const glm::quat* source, size_t count, uint32_t sourceVersion);
+    bool sync(const std::vector<glm::quat>& source, uint32_t sourceVersion) {
+        return sync(source.data(), source.size(), sourceVersion);
+    }
+
+    glm::quat evaluate(float t) const;
+
+    size_t size() const { return keys.size(); }
+
+private:
+    std::vector<glm::quat> keys;
+    std::vector<glm::quat> intermediates;
+    uint32_t seenSourceVersion = 0;     // sources start at 1, so the first sync always builds
+};
@@ -0,0 +1,163 @@
+#include "scene_framebuffer.hpp"
+#include <algorithm>
+#include <iostream>
+
+static int bucketed(int size) {
+    return std::max((size + SceneFramebuffer::BUCKET - 1) / SceneFramebuffer::BUCKET, 1) * SceneFramebuffer::BUCKET;
+}
+
+SceneFramebuffer::SceneFramebuffer()
+    : fbo(0), colorTex(0), depthStencil(0), msaaFbo(0), msaaColor(0), msaaDepthStencil(0), sampleCount(1),
+      maxSampleCount(0), shrinkFrames(0) {}
+
+void SceneFramebuffer::release() {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &colorTex);
+    glDeleteRenderbuffers(1, &depthStencil);
+    glDeleteFramebuffers(1, &msaaFbo);
+    glDeleteRenderbuffers(1, &msaaColor);
+    glDeleteRenderbuffers(1, &msaaDepthStencil);
+    fbo = colorTex = depthStencil = 0;
+    msaaFbo = msaaColor = msaaDepthStencil = 0;
+    stats = FramebufferStats();
+    stats.samples = sampleCount;
+}
+
+bool SceneFramebuffer::resize(int width, int height) {
+    // A collapsed or minimised window asks for nothing, keep what we have
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    stats.width = width;
+    stats.height = height;
+
+    bool fits = fbo != 0 && width <= stats.allocatedWidth && height <= stats.allocatedHeight;
+    bool wasteful = fits && (width * 2 < stats.allocatedWidth || height * 2 < stats.allocatedHeight)
+                    && (bucketed(width) < stats.allocatedWidth || bucketed(height) < stats.allocatedHeight);
+    shrinkFrames = wasteful ? shrinkFrames + 1 : 0;
+    if (fits && shrinkFrames < SHRINK_DELAY_FRAMES) {
+        return false;
+    }
+
+    // Growing keeps the larger dimension so resizing one axis doesn't shrink the other
+    int newWidth = bucketed(width);
+    int newHeight = bucketed(height);
+    if (!wasteful) {
+        newWidth = std::max(newWidth, stats.allocatedWidth);
+        newHeight = std::max(newHeight, stats.allocatedHeight);
+    }
+    allocate(newWidth, newHeight);
+    shrinkFrames = 0;
+    return true;
+}
+
+void SceneFramebuffer::allocate(int width, int height) {
+    if (fbo == 0) {
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &colorTex);
+        glGenRenderbuffers(1, &depthStencil);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glBindTexture(GL_TEXTURE_2D, colorTex);
+    // RGBA so readbacks for capture match the storage layout, RGB8 is padded to 4 bytes by most drivers anyway
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Linear filtering at the used corner's edge must not pull in the unused part
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "[ERROR][SceneFramebuffer] Framebuffer is not complete!" << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    stats.allocatedWidth = width;
+    stats.allocatedHeight = height;
+    stats.reallocations++;
+
+    if (sampleCount > 1) {
+        allocateMultisampled();
+    }
+}
+
+void SceneFramebuffer::allocateMultisampled() {
+    if (msaaFbo == 0) {
+        glGenFramebuffers(1, &msaaFbo);
+        glGenRenderbuffers(1, &msaaColor);
+        glGenRenderbuffers(1, &msaaDepthStencil);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, msaaFbo);
+
+    // Renderbuffers rather than multisample textures, the samples are only ever resolved, never sampled
+    glBindRenderbuffer(GL_RENDERBUFFER, msaaColor);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, sampleCount, GL_RGBA8, stats.allocatedWidth,
+                                     stats.allocatedHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, msaaColor);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, msaaDepthStencil);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, sampleCount, GL_DEPTH24_STENCIL8, stats.allocatedWidth,
+                                     stats.allocatedHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, msaaDepthStencil);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "[ERROR][SceneFramebuffer] Multisampled framebuffer (" << sampleCount << "x) is not complete!"
+                  << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+int SceneFramebuffer::maxSamples() {
+    if (maxSampleCount == 0) {
+        glGetIntegerv(GL_MAX_SAMPLES, &maxSampleCount);
+        maxSampleCount = std::max(maxSampleCount, 1);
+    }
+    return maxSampleCount;
+}
+
+void SceneFramebuffer::setSamples(int samples) {
+    int supported = 1;
+    while (supported * 2 <= std::min(samples, maxSamples())) {
+        supported *= 2;
+    }
+    if (supported == sampleCount) {
+        return;
+    }
+    sampleCount = supported;
+    stats.samples = supported;
+    // Without attachments yet the next resize() allocates everything
+    if (fbo != 0 && sampleCount > 1) {
+        allocateMultisampled();
+        stats.reallocations++;
+    }
+}
+
+void SceneFramebuffer::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, sampleCount > 1 ? msaaFbo : fbo);
+    glViewport(0, 0, stats.width, stats.height);
+}
+
+void SceneFramebuffer::resolve() const {
+    if (sampleCount > 1) {
+        // Only the used corner, and only colour: depth and stencil aren't needed after the scene
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, msaaFbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+        glBlitFramebuffer(0, 0, stats.width, stats.height, 0, 0, stats.width, stats.height, GL_COLOR_BUFFER_BIT,
+                          GL_NEAREST);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void SceneFramebuffer::unbind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <GL/glew.h>
+
+struct FramebufferStats {
+    uint32_t reallocations = 0;
+    int width = 0;              // size rendered this frame
+    int height = 0;
+    int allocatedWidth = 0;     // size of the attachments
+    int allocatedHeight = 0;
+    int samples = 1;            // MSAA samples per pixel of the render target, 1 without MSAA
+};
+
+// Offscreen colour + depth-stencil target for the scene, shown in an ImGui window.
+//
+// The attachments are only reallocated when the requested size no longer fits, and then rounded up to a multiple of
+// BUCKET so dragging a window edge grows the storage in steps instead of every frame. The scene renders into the
+// bottom-left width x height corner through the viewport, uvMax() gives the matching texture coordinates. Shrinking
+// only happens once the requested size stayed below half the allocation for SHRINK_DELAY_FRAMES frames in a row.
+//
+// With more than one sample the scene renders into multisampled renderbuffers instead, and resolve() blits the used
+// corner into the colour texture. The single-sample attachments stay allocated so switching back costs nothing.
+class SceneFramebuffer {
+public:
+    static const int BUCKET = 128;
+    static const int SHRINK_DELAY_FRAMES = 60;
+
+    SceneFramebuffer();
+
+    // Deletes the GL objects, must be called while the context is still current
+    void release();
+
+    // Call once per frame with the size the scene is shown at. Returns true if the attachments were reallocated.
+    bool resize(int width, int height);
+
+    // Sample count for the following frames, rounded down to a power of two the driver supports. Reallocates the
+    // multisampled attachments when the count changes.
+    void setSamples(int samples);
+    int samples() const { return sampleCount; }
+    int maxSamples();
+
+    // Binds the framebuffer to render into and sets the viewport to the used corner
+    void bind() const;
+    // Resolves the multisampled attachments into the colour texture and leaves the resolved framebuffer bound, so
+    // reads see the final image. Does nothing but bind without MSAA.
+    void resolve() const;
+    void unbind() const;
+
+    GLuint colorTexture() const { return colorTex; }
+    // Texture coordinates of the used corner's top right, the bottom left is (0, 0)
+    float uMax() const { return stats.allocatedWidth > 0 ? (float)stats.width / stats.allocatedWidth : 0.0f; }
+    float vMax() const { return stats.allocatedHeight > 0 ? (float)stats.height / stats.allocatedHeight : 0.0f; }
+
+    const FramebufferStats& frameStats() const { return stats; }
+
+private:
+    GLuint fbo;
+    GLuint colorTex;
+    GLuint depthStencil;
+    GLuint msaaFbo;
+    GLuint msaaColor;
+    GLuint msaaDepthStencil;
+    int sampleCount;
+    int maxSampleCount;
+    int shrinkFrames;
+    FramebufferStats stats;
+
+    void allocate(int width, int height);
+    void allocateMultisampled();
+};
@@ -0,0 +1,377 @@
+#include "shader_build.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// How often the watcher checks for shutdown, and the polling interval without inotify
+static const int WATCH_INTERVAL_MS = 250;
+
+static std::string fileName(const std::string& path) {
+    return fs::path(path).filename().string();
+}
+
+ShaderBuildService::ShaderBuildService(ProgramCache& cache)
+    : cache(cache), parallel(false), fromDisk(false), startupDone(false), reloads(0), failures(0), startupMs(0.0),
+      quit(false) {
+    // Let the driver use as many compiler threads as it likes
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+        parallel = true;
+    } else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+        parallel = true;
+    }
+}
+
+ShaderBuildService::~ShaderBuildService() {
+    stopWatching();
+}
+
+void ShaderBuildService::release() {
+    stopWatching();
+    // Finished programs are deleted with the context, only unfinished builds are cleaned up
+    for (const PendingBuild& build : pending) {
+        deleteShaders(build);
+        glDeleteProgram(build.program);
+    }
+    pending.clear();
+}
+
+ShaderProgram* ShaderBuildService::add(const ProgramDesc& desc) {
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->desc = desc;
+
+    ShaderProgram* program = &entry->program;
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back(std::move(entry));
+    return program;
+}
+
+void ShaderBuildService::buildAll() {
+    buildStart = std::chrono::steady_clock::now();
+    startupDone = false;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (!entries[i]->started) {
+            start(preprocess(i, entries[i]->desc), false);
+        }
+    }
+}
+
+// Only reads the files, safe on the watcher thread without the mutex
+ShaderBuildService::ChangedSources ShaderBuildService::preprocess(size_t entry, const ProgramDesc& desc) const {
+    ChangedSources sources;
+    sources.entry = entry;
+    sources.vertex = PreprocessShader(desc.vertexPath, desc.defines, fromDisk);
+    sources.fragment = PreprocessShader(desc.fragmentPath, desc.defines, fromDisk);
+    if (!desc.tessControlPath.empty()) {
+        sources.tessControl = PreprocessShader(desc.tessControlPath, desc.defines, fromDisk);
+        sources.tessEvaluation = PreprocessShader(desc.tessEvaluationPath, desc.defines, fromDisk);
+    }
+    return sources;
+}
+
+void ShaderBuildService::start(const ChangedSources& sources, bool reload) {
+    Entry& target = *entries[sources.entry];
+    target.started = true;
+    {
+        // Includes may have changed, so the files to watch for this program are updated on every build
+        std::lock_guard<std::mutex> lock(mutex);
+        target.dependencies.clear();
+        for (const ShaderSource* source : { &sources.vertex, &sources.fragment, &sources.tessControl,
+                                            &sources.tessEvaluation }) {
+            for (const std::string& file : source->files) {
+                target.dependencies.push_back(fileName(file));
+            }
+        }
+    }
+    if (!sources.ok()) {
+        std::cout << "[ERROR][ShaderBuildService] Can't read the sources of \"" << target.desc.name << "\"" << std::endl;
+        failures++;
+        return;
+    }
+
+    // The source hashes already cover includes and defines. Tessellation stages are chained onto the vertex hash.
+    uint64_t vertexHash = sources.vertex.hash;
+    if (!sources.tessControl.files.empty()) {
+        vertexHash = fnv1a64(&sources.tessControl.hash, sizeof(uint64_t), vertexHash);
+        vertexHash = fnv1a64(&sources.tessEvaluation.hash, sizeof(uint64_t), vertexHash);
+    }
+    uint64_t key = cache.key(vertexHash, sources.fragment.hash);
+    if (cache.usable()) {
+        GLuint binary = cache.loadBinary(key);
+        if (binary != 0) {
+            PendingBuild build = { sources.entry, key, 0, 0, binary, reload };
+            complete(build);
+            return;
+        }
+    }
+
+    const char* vertexCStr = sources.vertex.text.c_str();
+    const char* fragmentCStr = sources.fragment.text.c_str();
+
+    // No status queries here, those would wait for the compiler
+    PendingBuild build;
+    build.entry = sources.entry;
+    build.key = key;
+    build.reload = reload;
+    build.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(build.vertexShader, 1, &vertexCStr, NULL);
+    glCompileShader(build.vertexShader);
+    build.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(build.fragmentShader, 1, &fragmentCStr, NULL);
+    glCompileShader(build.fragmentShader);
+    if (!sources.tessControl.files.empty()) {
+        const char* controlCStr = sources.tessControl.text.c_str();
+        const char* evaluationCStr = sources.tessEvaluation.text.c_str();
+        build.tessControlShader = glCreateShader(GL_TESS_CONTROL_SHADER);
+        glShaderSource(build.tessControlShader, 1, &controlCStr, NULL);
+        glCompileShader(build.tessControlShader);
+        build.tessEvaluationShader = glCreateShader(GL_TESS_EVALUATION_SHADER);
+        glShaderSource(build.tessEvaluationShader, 1, &evaluationCStr, NULL);
+        glCompileShader(build.tessEvaluationShader);
+    }
+
+    build.program = glCreateProgram();
+    if (cache.usable()) {
+        glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(build.program, build.vertexShader);
+    glAttachShader(build.program, build.fragmentShader);
+    if (build.tessControlShader != 0) {
+        glAttachShader(build.program, build.tessControlShader);
+        glAttachShader(build.program, build.tessEvaluationShader);
+    }
+    glLinkProgram(build.program);
+    pending.push_back(build);
+}
+
+// glDeleteShader ignores 0, the shaders of a program without tessellation
+void ShaderBuildService::deleteShaders(const PendingBuild& build) {
+    glDeleteShader(build.vertexShader);
+    glDeleteShader(build.fragmentShader);
+    glDeleteShader(build.tessControlShader);
+    glDeleteShader(build.tessEvaluationShader);
+}
+
+bool ShaderBuildService::done(const PendingBuild& build) const {
+    if (!parallel) {
+        // Nothing to poll, the status query in complete() waits instead
+        return true;
+    }
+    GLint status = GL_FALSE;
+    glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &status);
+    return status == GL_TRUE;
+}
+
+void ShaderBuildService::complete(const PendingBuild& build) {
+    Entry& entry = *entries[build.entry];
+
+    bool linked = true;
+    if (build.vertexShader != 0) {
+        // Check every stage so all errors are printed, not just the first
+        bool compiled = CheckShaderStatus(build.vertexShader);
+        compiled = CheckShaderStatus(build.fragmentShader) && compiled;
+        if (build.tessControlShader != 0) {
+            compiled = CheckShaderStatus(build.tessControlShader) && compiled;
+            compiled = CheckShaderStatus(build.tessEvaluationShader) && compiled;
+        }
+        linked = compiled && CheckProgramStatus(build.program);
+        deleteShaders(build);
+    }
+
+    if (!linked) {
+        std::cout << "[ERROR][ShaderBuildService] Failed to build \"" << entry.desc.name << "\""
+                  << (entry.program.valid() ? ", keeping the previous version" : "") << std::endl;
+        glDeleteProgram(build.program);
+        failures++;
+        return;
+    }
+
+    if (build.vertexShader != 0 && cache.usable()) {
+        cache.storeBinary(build.key, build.program);
+    }
+
+    GLuint previous = entry.program.id();
+    entry.program = ShaderProgram(build.program);
+    if (previous != 0) {
+        glDeleteProgram(previous);
+    }
+    if (build.reload) {
+        reloads++;
+        std::cout << "[INFO][ShaderBuildService] Reloaded \"" << entry.desc.name << "\"" << std::endl;
+    }
+}
+
+void ShaderBuildService::finish() {
+    for (const PendingBuild& build : pending) {
+        complete(build);
+    }
+    pending.clear();
+    if (!startupDone) {
+        startupDone = true;
+        startupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    }
+}
+
+void ShaderBuildService::update() {
+    std::vector<ChangedSources> work;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        work.swap(changed);
+    }
+
+    for (const ChangedSources& sources : work) {
+        // A newer edit supersedes a rebuild of the same program that is still in flight
+        for (size_t i = 0; i < pending.size();) {
+            if (pending[i].entry == sources.entry) {
+                deleteShaders(pending[i]);
+                glDeleteProgram(pending[i].program);
+                pending[i] = pending.back();
+                pending.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        start(sources, true);
+    }
+
+    // Programs added since buildAll(), e.g. shader variants requested for the first time
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (!entries[i]->started) {
+            start(preprocess(i, entries[i]->desc), false);
+        }
+    }
+
+    for (size_t i = 0; i < pending.size();) {
+        if (done(pending[i])) {
+            complete(pending[i]);
+            pending[i] = pending.back();
+            pending.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
+
+void ShaderBuildService::watch(const std::string& directory) {
+    stopWatching();
+    watchDirectory = directory;
+    quit = false;
+    watcher = std::thread(&ShaderBuildService::watchLoop, this);
+}
+
+void ShaderBuildService::stopWatching() {
+    if (watcher.joinable()) {
+        quit = true;
+        watcher.join();
+    }
+}
+
+// Watcher thread: reads the sources of every program that uses the file, so the GL thread only compiles. The mutex is
+// only held to find the programs and to queue their sources, start() and update() never wait for the disk.
+void ShaderBuildService::fileChanged(const std::string& name) {
+    // Copies of the descriptions, entries can grow while the files are read
+    std::vector<std::pair<size_t, ProgramDesc>> affected;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const Entry& entry = *entries[i];
+            if (std::find(entry.dependencies.begin(), entry.dependencies.end(), name) != entry.dependencies.end()) {
+                affected.emplace_back(i, entry.desc);
+            }
+        }
+    }
+
+    for (const std::pair<size_t, ProgramDesc>& program : affected) {
+        size_t i = program.first;
+        ChangedSources sources = preprocess(i, program.second);
+        if (!sources.ok()) {
+            // Probably caught mid-save, the next write event brings the complete file
+            continue;
+        }
+
+        // Editors often write a file more than once per save, only the latest sources matter
+        std::lock_guard<std::mutex> lock(mutex);
+        auto queued = std::find_if(changed.begin(), changed.end(),
+                                   [i](const ChangedSources& c) { return c.entry == i; });
+        if (queued != changed.end()) {
+            *queued = std::move(sources);
+        } else {
+            changed.push_back(std::move(sources));
+        }
+    }
+}
+
+void ShaderBuildService::watchLoop() {
+#ifdef __linux__
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, watchDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cout << "[ERROR][ShaderBuildService] Can't watch \"" << watchDirectory << "\"" << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (!quit) {
+        pollfd descriptor = { fd, POLLIN, 0 };
+        if (poll(&descriptor, 1, WATCH_INTERVAL_MS) <= 0) {
+            continue;
+        }
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = (const inotify_event*) (buffer + offset);
+            if (event->len > 0) {
+                fileChanged(event->name);
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+    close(fd);
+#else
+    // No inotify (e.g. macOS), compare modification times instead
+    std::map<std::string, fs::file_time_type> modified;
+    bool initial = true;
+    while (!quit) {
+        std::error_code error;
+        for (fs::directory_iterator it(watchDirectory, error), end; !error && it != end; it.increment(error)) {
+            if (!it->is_regular_file(error)) {
+                continue;
+            }
+            std::string name = it->path().filename().string();
+            fs::file_time_type time = it->last_write_time(error);
+            auto known = modified.find(name);
+            if (known == modified.end() || known->second != time) {
+                modified[name] = time;
+                if (!initial) {
+                    fileChanged(name);
+                }
+            }
+        }
+        initial = false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+    }
+#endif
+}
+
+ShaderBuildStats ShaderBuildService::stats() const {
+    ShaderBuildStats s;
+    s.programs = (uint32_t) entries.size();
+    s.building = (uint32_t) pending.size();
+    s.reloads = reloads;
+    s.failures = failures;
+    s.parallel = parallel;
+    s.startupMs = startupMs;
+    return s;
+}
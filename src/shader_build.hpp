@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include "program_cache.hpp"
+#include "shader_preprocessor.hpp"
+#include "shader_program.hpp"
+
+// Defaults let brace initialisation stop after the last field it needs
+struct ProgramDesc {
+    std::string name = "";
+    std::string vertexPath = "";
+    std::string fragmentPath = "";
+    std::string defines = "";
+    // Optional, both or neither. Needs GL 4.0 or ARB_tessellation_shader, check before adding such a program.
+    std::string tessControlPath = "";
+    std::string tessEvaluationPath = "";
+};
+
+struct ShaderBuildStats {
+    uint32_t programs = 0;
+    uint32_t building = 0;      // compiles/links the driver hasn't finished yet
+    uint32_t reloads = 0;       // successful hot reloads
+    uint32_t failures = 0;      // failed builds, the previous program was kept
+    bool parallel = false;      // KHR/ARB_parallel_shader_compile available
+    double startupMs = 0.0;     // time from buildAll() until every program was usable
+};
+
+// Builds every registered program up front and rebuilds them when their sources change on disk.
+//
+// Compiles are issued for all programs before any status is queried. With KHR_parallel_shader_compile the driver
+// compiles on its own threads and GL_COMPLETION_STATUS_KHR is polled once per frame, so neither startup nor a hot
+// reload waits on the compiler. Without the extension the status query blocks like a plain compile would.
+//
+// Programs are handed out as stable pointers. A rebuilt program replaces the old one in place between frames, so draw
+// commands never see a half built program; a failed rebuild prints the log and keeps the old one.
+class ShaderBuildService {
+public:
+    // Must be constructed with a current GL context, cache must outlive the service
+    explicit ShaderBuildService(ProgramCache& cache);
+    ~ShaderBuildService();
+    // Stops the watcher and drops unfinished builds, call before the GL context is destroyed
+    void release();
+
+    // The returned program is invalid until its first build finished. Programs added after buildAll() are built by
+    // the next update().
+    ShaderProgram* add(const ProgramDesc& desc);
+
+    // Starts building every registered program that isn't in the binary cache, doesn't wait for the driver
+    void buildAll();
+    // Waits for all outstanding builds. Startup needs the programs before the first frame.
+    void finish();
+    // Once per frame on the GL thread: swaps in finished builds, starts new programs and rebuilds for changed files
+    void update();
+
+    // Read shader files from disk instead of the copies embedded at build time, set before buildAll()
+    void setSourcesFromDisk(bool enable) { fromDisk = enable; }
+    bool sourcesFromDisk() const { return fromDisk; }
+
+    // Watches a directory for changed shader files on a background thread (inotify on Linux, mtime polling elsewhere).
+    // Only useful with sources from disk, embedded ones can't change.
+    void watch(const std::string& directory);
+    void stopWatching();
+
+    ShaderBuildStats stats() const;
+
+private:
+    struct Entry {
+        ProgramDesc desc;
+        ShaderProgram program;
+        std::vector<std::string> dependencies;  // file names the program was built from, includes too
+        bool started = false;
+    };
+
+    struct PendingBuild {
+        size_t entry;
+        uint64_t key;
+        GLuint vertexShader;
+        GLuint fragmentShader;
+        GLuint program;
+        bool reload;
+        GLuint tessControlShader = 0;
+        GLuint tessEvaluationShader = 0;
+    };
+
+    // Sources read on the watcher thread, waiting to be compiled on the GL thread
+    struct ChangedSources {
+        size_t entry;
+        ShaderSource vertex;
+        ShaderSource fragment;
+        ShaderSource tessControl;       // empty and ok without tessellation
+        ShaderSource tessEvaluation;
+
+        bool ok() const { return vertex.ok && fragment.ok && tessControl.ok && tessEvaluation.ok; }
+    };
+
+    ProgramCache& cache;
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::vector<PendingBuild> pending;
+    bool parallel;
+    bool fromDisk;
+    bool startupDone;
+    uint32_t reloads;
+    uint32_t failures;
+    double startupMs;
+    std::chrono::steady_clock::time_point buildStart;
+
+    std::thread watcher;
+    std::atomic<bool> quit;
+    std::string watchDirectory;
+    mutable std::mutex mutex;
+    std::vector<ChangedSources> changed;
+
+    ChangedSources preprocess(size_t entry, const ProgramDesc& desc) const;
+    void start(const ChangedSources& sources, bool reload);
+    bool done(const PendingBuild& build) const;
+    static void deleteShaders(const PendingBuild& build);
+    void complete(const PendingBuild& build);
+    void fileChanged(const std::string& fileName);
+    void watchLoop();
+};
@@ -0,0 +1,109 @@
+#include "shader_preprocessor.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include "embedded_shaders.hpp"
+#include "program_cache.hpp"
+#include "shader_program.hpp"
+
+namespace fs = std::filesystem;
+
+static const int MAX_INCLUDE_DEPTH = 16;
+
+// Returns the quoted file name of an #include line, or an empty string if the line isn't one
+static std::string includeName(const std::string& line) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+        return std::string();
+    }
+    size_t open = line.find('"', start + 8);
+    size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+    if (close == std::string::npos) {
+        return std::string();
+    }
+    return line.substr(open + 1, close - open - 1);
+}
+
+static bool isVersion(const std::string& line) {
+    size_t start = line.find_first_not_of(" \t");
+    return start != std::string::npos && line.compare(start, 8, "#version") == 0;
+}
+
+static bool readSource(const std::string& path, bool fromDisk, std::string& source, uint64_t& hash) {
+    if (!fromDisk) {
+        if (const EmbeddedShader* embedded = FindEmbeddedShader(path)) {
+            source.assign(embedded->source.data(), embedded->source.size());
+            hash = embedded->hash;
+            return true;
+        }
+        std::cout << "[WARNING][PreprocessShader] \"" << path << "\" isn't embedded, reading it from disk" << std::endl;
+    }
+    source = ParseShader(path);
+    hash = fnv1a64(source.data(), source.size());
+    return !source.empty();
+}
+
+static void process(const std::string& path, const std::string& defines, bool fromDisk, int depth,
+                    ShaderSource& result) {
+    int fileIndex = (int) result.files.size();
+    result.files.push_back(path);
+
+    std::string source;
+    uint64_t hash = 0;
+    if (!readSource(path, fromDisk, source, hash)) {
+        result.ok = false;
+        return;
+    }
+    result.hash = fnv1a64(&hash, sizeof(hash), result.hash);
+
+    size_t position = 0;
+    int lineNumber = 0;
+    while (position < source.size()) {
+        size_t end = source.find('\n', position);
+        if (end == std::string::npos) {
+            end = source.size();
+        }
+        std::string line = source.substr(position, end - position);
+        position = end + 1;
+        lineNumber++;
+
+        std::string name = includeName(line);
+        if (name.empty()) {
+            result.text += line;
+            result.text += '\n';
+            if (depth == 0 && !defines.empty() && isVersion(line)) {
+                result.text += defines;
+                result.text += "\n#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+            }
+            continue;
+        }
+
+        if (depth >= MAX_INCLUDE_DEPTH) {
+            std::cout << "[ERROR][PreprocessShader] Includes nested too deeply in \"" << path << "\"" << std::endl;
+            result.ok = false;
+            return;
+        }
+
+        std::string included = (fs::path(path).parent_path() / name).lexically_normal().generic_string();
+        if (std::find(result.files.begin(), result.files.end(), included) != result.files.end()) {
+            // Already part of this shader. The directive is dropped, so renumber the lines after it.
+            result.text += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+            continue;
+        }
+
+        result.text += "#line 1 " + std::to_string(result.files.size()) + "\n";
+        process(included, defines, fromDisk, depth + 1, result);
+        if (!result.ok) {
+            std::cout << "[ERROR][PreprocessShader] Included from \"" << path << "\" line " << lineNumber << std::endl;
+            return;
+        }
+        result.text += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+    }
+}
+
+ShaderSource PreprocessShader(const std::string& path, const std::string& defines, bool fromDisk) {
+    ShaderSource result;
+    result.hash = fnv1a64(defines.data(), defines.size());
+    process(fs::path(path).lexically_normal().generic_string(), defines, fromDisk, 0, result);
+    return result;
+}
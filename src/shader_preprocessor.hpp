@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ShaderSource {
+    std::string text;
+    // Every file the text was built from, the shader itself first. #line directives use indices into this list as
+    // source string numbers, so a driver error "0(12)" or "1:12" means line 12 of files[0] or files[1].
+    std::vector<std::string> files;
+    // Content hashes of all files chained together, for cache keys. Embedded files carry one computed at build time.
+    uint64_t hash = 0;
+    bool ok = true;
+};
+
+// Resolves #include "file" (relative to the including file) and inserts defines right after #version.
+//
+// Each file is included at most once per shader, like an implicit #pragma once, so shared headers can include each
+// other freely. Conditional compilation is left to the GLSL compiler, an #include inside an #if is always expanded.
+//
+// Files come from the shaders embedded at build time, without opening any file, unless fromDisk is set. A file missing
+// from the embedded set (e.g. added since the last build) is read from disk with a warning.
+ShaderSource PreprocessShader(const std::string& path, const std::string& defines = "", bool fromDisk = false);
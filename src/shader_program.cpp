@@ -0,0 +1,305 @@
+#include "shader_program.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+std::string ParseShader(const std::string& filepath)
+{
+    std::ifstream stream(filepath, std::ios::binary | std::ios::ate);
+
+    if (stream.fail())
+    {
+        std::cout << "[ERROR][ParseShader] The filepath  \"" << filepath << "\" doesn't exist." << std::endl;
+        return std::string();
+    }
+
+    // read the whole file in one go, the size is known from opening at the end
+    std::string source((size_t) stream.tellg(), '\0');
+    stream.seekg(0);
+    stream.read(&source[0], (std::streamsize) source.size());
+
+    return source;
+}
+
+bool CheckShaderStatus(unsigned int shaderID)
+{
+    int success;
+    char infoLog[512];
+    glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(shaderID, 512, NULL, infoLog);
+        std::cout << "[ERROR] Shader failed.\n" << infoLog << std::endl;
+    }
+    return success;
+}
+
+bool CheckProgramStatus(unsigned int programID)
+{
+    int success;
+    char infoLog[512];
+    glGetProgramiv(programID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(programID, 512, NULL, infoLog);
+        std::cout << "[ERROR] Program link failed.\n" << infoLog << std::endl;
+    }
+    return success;
+}
+
+unsigned int CreateShader(ShaderType shaderType, const std::string& filepath)
+{
+    return CompileShaderSource(shaderType, ParseShader(filepath));
+}
+
+unsigned int CompileShaderSource(ShaderType shaderType, const std::string& source)
+{
+    const char* shaderSrcCStr = source.c_str();         // convert string to the format that OpenGL use
+
+    unsigned int shaderID = 0;
+    switch (shaderType)
+    {
+    case ShaderType::VERTEX:
+        shaderID = glCreateShader(GL_VERTEX_SHADER);    // generate an id for this shader
+        break;
+    case ShaderType::FRAGMENT:
+        shaderID = glCreateShader(GL_FRAGMENT_SHADER);
+        break;
+    default:
+        std::cout << "[Error] Invalid shader type " << (int)shaderType << std::endl;
+        break;
+    }
+
+    glShaderSource(shaderID, 1, &shaderSrcCStr, NULL);  // load shader data
+    glCompileShader(shaderID);                          // compile shader
+    CheckShaderStatus(shaderID);                        // error check
+
+    return shaderID;
+}
+
+// Number of floats needed to cache one element of a uniform type, 0 for types that aren't cached
+static uint32_t cachedFloats(GLenum type) {
+    switch (type) {
+        case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL:
+        case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_BUFFER:
+            return 1;
+        case GL_FLOAT_VEC2: return 2;
+        case GL_FLOAT_VEC3: return 3;
+        case GL_FLOAT_VEC4: return 4;
+        case GL_FLOAT_MAT3: return 9;
+        case GL_FLOAT_MAT4: return 16;
+        default: return 0;
+    }
+}
+
+ShaderProgram::ShaderProgram() : program(0) {}
+
+ShaderProgram::ShaderProgram(GLuint programID) : program(programID) {
+    reflect();
+}
+
+ShaderProgram ShaderProgram::fromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
+    unsigned int vertexShaderID = CreateShader(ShaderType::VERTEX, vertexPath);
+    unsigned int fragShaderID = CreateShader(ShaderType::FRAGMENT, fragmentPath);
+
+    // Link shaders with shader program
+    GLuint programID = glCreateProgram();
+    glAttachShader(programID, vertexShaderID);
+    glAttachShader(programID, fragShaderID);
+    glLinkProgram(programID);
+
+    // delete shaders since we have linked them
+    glDeleteShader(vertexShaderID);
+    glDeleteShader(fragShaderID);
+
+    if (!CheckProgramStatus(programID)) {
+        std::cout << "[ERROR][ShaderProgram] Failed to link \"" << vertexPath << "\" with \"" << fragmentPath << "\""
+                  << std::endl;
+        glDeleteProgram(programID);
+        return ShaderProgram();
+    }
+    return ShaderProgram(programID);
+}
+
+void ShaderProgram::reflect() {
+    uniforms.clear();
+    blocks.clear();
+    cache.clear();
+    table.clear();
+    if (program == 0) {
+        return;
+    }
+
+    GLint activeUniforms = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &activeUniforms);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<char> name(maxNameLength > 0 ? maxNameLength : 1);
+
+    for (GLint i = 0; i < activeUniforms; ++i) {
+        GLsizei length = 0;
+        GLint count = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, (GLuint) i, (GLsizei) name.size(), &length, &count, &type, name.data());
+
+        // Arrays are reported as "name[0]", they are set through the plain name
+        std::string uniformName(name.data(), length);
+        size_t bracket = uniformName.find('[');
+        if (bracket != std::string::npos) {
+            uniformName.resize(bracket);
+        }
+
+        // Members of uniform blocks have no location and are set through the block's buffer
+        GLint location = glGetUniformLocation(program, uniformName.c_str());
+        if (location < 0) {
+            continue;
+        }
+
+        Uniform uniform;
+        uniform.hash = fnv1a(uniformName.c_str());
+        uniform.location = location;
+        uniform.type = type;
+        uniform.count = count;
+        uniform.cacheOffset = (uint32_t) cache.size();
+        uniform.cacheSize = cachedFloats(type) * (uint32_t) count;
+        uniform.cached = false;
+        cache.resize(cache.size() + uniform.cacheSize);
+        uniforms.push_back(uniform);
+    }
+
+    GLint activeBlocks = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &activeBlocks);
+    for (GLint i = 0; i < activeBlocks; ++i) {
+        GLint length = 0;
+        glGetActiveUniformBlockiv(program, (GLuint) i, GL_UNIFORM_BLOCK_NAME_LENGTH, &length);
+        std::vector<char> blockName(length > 0 ? length : 1);
+        glGetActiveUniformBlockName(program, (GLuint) i, (GLsizei) blockName.size(), nullptr, blockName.data());
+
+        Block block;
+        block.hash = fnv1a(blockName.data());
+        block.index = (GLuint) i;
+        blocks.push_back(block);
+    }
+
+    // Keep the table at most half full so probes stay short
+    size_t tableSize = 8;
+    while (tableSize < uniforms.size() * 2) {
+        tableSize *= 2;
+    }
+    table.assign(tableSize, 0);
+    for (size_t i = 0; i < uniforms.size(); ++i) {
+        size_t slot = uniforms[i].hash & (tableSize - 1);
+        while (table[slot] != 0) {
+            if (uniforms[table[slot] - 1].hash == uniforms[i].hash) {
+                std::cout << "[WARNING][ShaderProgram] Uniform name hash collision in program " << program << std::endl;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        table[slot] = (uint16_t) (i + 1);
+    }
+}
+
+int ShaderProgram::find(uint32_t nameHash) const {
+    if (table.empty()) {
+        return -1;
+    }
+    size_t mask = table.size() - 1;
+    for (size_t slot = nameHash & mask; table[slot] != 0; slot = (slot + 1) & mask) {
+        if (uniforms[table[slot] - 1].hash == nameHash) {
+            return table[slot] - 1;
+        }
+    }
+    return -1;
+}
+
+GLint ShaderProgram::location(uint32_t nameHash) const {
+    int index = find(nameHash);
+    return index < 0 ? -1 : uniforms[index].location;
+}
+
+// Returns the uniform if it exists and the new value differs from the cached one, updating the cache
+ShaderProgram::Uniform* ShaderProgram::changed(uint32_t nameHash, const void* data, size_t bytes) {
+    int index = find(nameHash);
+    if (index < 0) {
+        return nullptr;
+    }
+    Uniform& uniform = uniforms[index];
+    if (bytes > uniform.cacheSize * sizeof(float)) {
+        // Type mismatch or a type we don't cache, always upload
+        return &uniform;
+    }
+    float* cached = &cache[uniform.cacheOffset];
+    if (uniform.cached && std::memcmp(cached, data, bytes) == 0) {
+        return nullptr;
+    }
+    std::memcpy(cached, data, bytes);
+    uniform.cached = true;
+    return &uniform;
+}
+
+void ShaderProgram::set(uint32_t nameHash, int value) {
+    if (Uniform* uniform = changed(nameHash, &value, sizeof(value))) {
+        glUniform1i(uniform->location, value);
+    }
+}
+
+void ShaderProgram::set(uint32_t nameHash, float value) {
+    if (Uniform* uniform = changed(nameHash, &value, sizeof(value))) {
+        glUniform1f(uniform->location, value);
+    }
+}
+
+void ShaderProgram::set(uint32_t nameHash, const glm::vec3& value) {
+    if (Uniform* uniform = changed(nameHash, &value[0], sizeof(float) * 3)) {
+        glUniform3f(uniform->location, value.x, value.y, value.z);
+    }
+}
+
+void ShaderProgram::set(uint32_t nameHash, const glm::vec4& value) {
+    if (Uniform* uniform = changed(nameHash, &value[0], sizeof(float) * 4)) {
+        glUniform4f(uniform->location, value.x, value.y, value.z, value.w);
+    }
+}
+
+void ShaderProgram::set(uint32_t nameHash, const glm::mat3& value) {
+    if (Uniform* uniform = changed(nameHash, &value[0][0], sizeof(float) * 9)) {
+        glUniformMatrix3fv(uniform->location, 1, GL_FALSE, &value[0][0]);
+    }
+}
+
+void ShaderProgram::set(uint32_t nameHash, const glm::mat4& value) {
+    if (Uniform* uniform = changed(nameHash, &value[0][0], sizeof(float) * 16)) {
+        glUniformMatrix4fv(uniform->location, 1, GL_FALSE, &value[0][0]);
+    }
+}
+
+void ShaderProgram::set(uint32_t nameHash, const glm::vec3* values, int count) {
+    if (Uniform* uniform = changed(nameHash, values, sizeof(float) * 3 * count)) {
+        glUniform3fv(uniform->location, count, &values[0][0]);
+    }
+}
+
+GLuint ShaderProgram::blockIndex(uint32_t nameHash) const {
+    for (const Block& block : blocks) {
+        if (block.hash == nameHash) {
+            return block.index;
+        }
+    }
+    return GL_INVALID_INDEX;
+}
+
+bool ShaderProgram::bindBlock(uint32_t nameHash, GLuint bindingPoint) {
+    GLuint index = blockIndex(nameHash);
+    if (index == GL_INVALID_INDEX) {
+        return false;
+    }
+    glUniformBlockBinding(program, index, bindingPoint);
+    return true;
+}
+
+void ShaderProgram::invalidateCache() {
+    for (Uniform& uniform : uniforms) {
+        uniform.cached = false;
+    }
+}
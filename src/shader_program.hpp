@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+enum class ShaderType
+{
+    NONE = -1,
+    VERTEX = 0,
+    FRAGMENT = 1
+};
+
+std::string ParseShader(const std::string& filepath);
+bool CheckShaderStatus(unsigned int shaderID);
+bool CheckProgramStatus(unsigned int programID);
+unsigned int CompileShaderSource(ShaderType shaderType, const std::string& source);
+unsigned int CreateShader(ShaderType shaderType, const std::string& filepath);
+
+// 32-bit FNV-1a. constexpr so uniform names can be hashed at compile time:
+//     constexpr uint32_t U_MODEL = fnv1a("u_model");
+constexpr uint32_t fnv1a(const char* str) {
+    uint32_t hash = 2166136261u;
+    while (*str) {
+        hash = (hash ^ (uint32_t) (unsigned char) *str++) * 16777619u;
+    }
+    return hash;
+}
+
+// A linked GL program with its active uniforms and uniform blocks reflected once after linking.
+//
+// Uniforms are looked up by the FNV-1a hash of their name in a small open addressed table, so a set() is a couple of
+// array reads and no string work. Every uniform has a cached copy of its last value and setters skip the glUniform
+// call when the value didn't change. Setters apply to the currently bound program, call use() first.
+class ShaderProgram {
+public:
+    ShaderProgram();
+    explicit ShaderProgram(GLuint programID);
+
+    // Compiles, links and reflects. Returns an invalid program (id() == 0) on failure.
+    static ShaderProgram fromFiles(const std::string& vertexPath, const std::string& fragmentPath);
+
+    GLuint id() const { return program; }
+    bool valid() const { return program != 0; }
+    void use() const { glUseProgram(program); }
+
+    bool has(uint32_t nameHash) const { return find(nameHash) >= 0; }
+    GLint location(uint32_t nameHash) const;
+
+    // Setting a uniform the program doesn't have (e.g. optimised out) is silently ignored, use has() to check
+    void set(uint32_t nameHash, int value);
+    void set(uint32_t nameHash, float value);
+    void set(uint32_t nameHash, const glm::vec3& value);
+    void set(uint32_t nameHash, const glm::vec4& value);
+    void set(uint32_t nameHash, const glm::mat3& value);
+    void set(uint32_t nameHash, const glm::mat4& value);
+    // Arrays, count must not exceed the declared size
+    void set(uint32_t nameHash, const glm::vec3* values, int count);
+
+    GLuint blockIndex(uint32_t nameHash) const;
+    bool bindBlock(uint32_t nameHash, GLuint bindingPoint);
+
+    // Forget all cached values, needed if something outside this class changed the program's uniforms
+    void invalidateCache();
+
+    size_t uniformCount() const { return uniforms.size(); }
+
+private:
+    struct Uniform {
+        uint32_t hash;
+        GLint location;
+        GLenum type;
+        GLint count;
+        uint32_t cacheOffset;   // in floats, into cache
+        uint32_t cacheSize;
+        bool cached;
+    };
+
+    struct Block {
+        uint32_t hash;
+        GLuint index;
+    };
+
+    GLuint program;
+    std::vector<Uniform> uniforms;
+    std::vector<Block> blocks;
+    std::vector<float> cache;
+    // Open addressed hash -> uniforms index + 1 (0 is an empty slot), size is a power of two
+    std::vector<uint16_t> table;
+
+    void reflect();
+    int find(uint32_t nameHash) const;
+    Uniform* changed(uint32_t nameHash, const void* data, size_t bytes);
+};
@@ -0,0 +1,66 @@
+#include "shader_variants.hpp"
+#include <algorithm>
+
+static const char* specularDefine(SpecularModel specular) {
+    switch (specular) {
+        case SpecularModel::NONE: return "SPECULAR_NONE";
+        case SpecularModel::BLINN_PHONG: return "SPECULAR_BLINN_PHONG";
+        default: return "SPECULAR_PHONG";
+    }
+}
+
+uint32_t ShaderPermutation::key() const {
+    uint32_t lights = std::min(std::max(lightCount, 1u), MAX_LIGHTS);
+    return (instancing ? 1u : 0u)
+           | (quantisedAttributes ? 1u : 0u) << 1
+           | (lights & 0xFu) << 2
+           | ((uint32_t) specular & 0x3u) << 6;
+}
+
+std::string ShaderPermutation::defines() const {
+    std::string result;
+    if (instancing) {
+        result += "#define INSTANCING 1\n";
+    }
+    if (quantisedAttributes) {
+        result += "#define QUANTISED_ATTRIBUTES 1\n";
+    }
+    result += "#define LIGHT_COUNT " + std::to_string(std::min(std::max(lightCount, 1u), MAX_LIGHTS)) + "\n";
+    result += "#define ";
+    result += specularDefine(specular);
+    result += " 1";
+    return result;
+}
+
+ShaderPermutation ShaderPermutation::vertexOnly() const {
+    ShaderPermutation result;
+    result.instancing = instancing;
+    result.quantisedAttributes = quantisedAttributes;
+    return result;
+}
+
+ShaderVariants::ShaderVariants(ShaderBuildService& builder, const std::string& name, const std::string& vertexPath,
+                               const std::string& fragmentPath)
+    : builder(builder), name(name), vertexPath(vertexPath), fragmentPath(fragmentPath) {}
+
+ShaderProgram* ShaderVariants::get(const ShaderPermutation& permutation) {
+    uint32_t key = permutation.key();
+    auto it = programs.find(key);
+    if (it != programs.end()) {
+        return it->second;
+    }
+
+    ProgramDesc desc;
+    desc.name = name + "#" + std::to_string(key);
+    desc.vertexPath = vertexPath;
+    desc.fragmentPath = fragmentPath;
+    desc.defines = permutation.defines();
+    ShaderProgram* program = builder.add(desc);
+    programs.emplace(key, program);
+    return program;
+}
+
+ShaderProgram* ShaderVariants::select(const ShaderPermutation& wanted, const ShaderPermutation& fallback) {
+    ShaderProgram* program = get(wanted);
+    return program->valid() ? program : get(fallback);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "shader_build.hpp"
+#include "shader_program.hpp"
+
+enum class SpecularModel : uint8_t {
+    NONE = 0,
+    PHONG = 1,
+    BLINN_PHONG = 2
+};
+
+// The features a specialised program is compiled for. Each field becomes a #define, the shaders pick their code path
+// with #if instead of branching at runtime.
+struct ShaderPermutation {
+    static constexpr uint32_t MAX_LIGHTS = 8;
+
+    bool instancing = false;            // INSTANCING: per-instance model matrix at attribute locations 2-5
+    bool quantisedAttributes = false;   // QUANTISED_ATTRIBUTES: normalised 16-bit positions, see u_posScale/u_posOffset
+    uint32_t lightCount = 1;            // LIGHT_COUNT, 1 to MAX_LIGHTS
+    SpecularModel specular = SpecularModel::PHONG;  // SPECULAR_NONE / SPECULAR_PHONG / SPECULAR_BLINN_PHONG
+
+    // Packed as instancing (1) | quantised (1) | light count (4) | specular (2), the low bits first
+    uint32_t key() const;
+    std::string defines() const;
+
+    // Only the fields a vertex stage depends on, so e.g. depth programs aren't built once per specular model
+    ShaderPermutation vertexOnly() const;
+};
+
+// All permutations of one vertex/fragment shader pair. Variants are registered with the build service on first use
+// and compiled without blocking, prewarm() the ones needed for the first frame before ShaderBuildService::buildAll().
+class ShaderVariants {
+public:
+    ShaderVariants(ShaderBuildService& builder, const std::string& name, const std::string& vertexPath,
+                   const std::string& fragmentPath);
+
+    // The program is invalid until its build finished
+    ShaderProgram* get(const ShaderPermutation& permutation);
+    void prewarm(const ShaderPermutation& permutation) { get(permutation); }
+
+    // The wanted variant if it's ready, otherwise fallback (which should be prewarmed). Requests the wanted one.
+    ShaderProgram* select(const ShaderPermutation& wanted, const ShaderPermutation& fallback);
+
+    size_t size() const { return programs.size(); }
+
+private:
+    ShaderBuildService& builder;
+    std::string name;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::unordered_map<uint32_t, ShaderProgram*> programs;
+};
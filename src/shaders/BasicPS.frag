@@ -1,39 +1,31 @@
 #version 330 core
+#include "lighting.glsl"
 out vec4 FragColor;
 
 in vec3 Normal;
 in vec3 WorldPos;
 
 uniform vec3 u_objColor;
-uniform vec3 u_lightColor;
-uniform vec3 u_lightPos;
+uniform vec3 u_lightColor[LIGHT_COUNT];
+uniform vec3 u_lightPos[LIGHT_COUNT];
 uniform vec3 u_camPos;
 
 void main()
 {
-	// Set color
-	vec3 objColor = u_objColor;
-	vec3 lightColor = u_lightColor;
-
-	// Ambient light
-	float ambientStrength = 0.2f;
-	vec3 ambientLight = ambientStrength * lightColor;
-
-	// Diffuse light
-	vec3 lightDir = normalize(u_lightPos - WorldPos);
 	vec3 norm = normalize(Normal);
-	float diffuseStrength = max(dot(lightDir, norm), 0.0f);
-	vec3 diffuseLight = diffuseStrength * lightColor;
-
-	// Specular light
 	vec3 viewDir = normalize(u_camPos - WorldPos);
-	vec3 reflectDir = reflect(-lightDir, Normal);
+
+	float ambientStrength = 0.2f;
 	float specularStrength = 1.0f;
-	float spec = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
-	vec3 specularLight = specularStrength * spec * lightColor;
 
-	// Combine all light factors together
-	vec3 finalLight = ambientLight + diffuseLight + specularLight;
+	// Ambient, diffuse and specular light of every light combined
+	vec3 finalLight = vec3(0.0f);
+	for (int i = 0; i < LIGHT_COUNT; ++i)
+	{
+		vec3 lightDir = normalize(u_lightPos[i] - WorldPos);
+		LightTerms terms = phongTerms(norm, viewDir, lightDir, 32.0f);
+		finalLight += (ambientStrength + terms.diffuse + specularStrength * terms.specular) * u_lightColor[i];
+	}
 
-	FragColor = vec4(finalLight * objColor, 1.0f);
+	FragColor = vec4(finalLight * u_objColor, 1.0f);
 }
\ No newline at end of file
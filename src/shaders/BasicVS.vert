@@ -1,20 +1,18 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;		// vertex attributes
+#include "vertex_input.glsl"
 layout (location = 1) in vec3 aNormal;
 
 out vec3 Normal;	// forward normal vector from vertex shaderes to fragment shaders
 out vec3 WorldPos;	// world space position of this vertex
 
-uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_proj;
+invariant gl_Position;	// the depth pre-pass (DepthVS.vert) relies on bit-identical depth
 
 void main()
 {
-	// Check this article for how normal vector is transformed: https://learnopengl.com/Lighting/Basic-Lightings
-	Normal = mat3(transpose(inverse(u_model))) * aNormal; 
+	// The normal matrix (see https://learnopengl.com/Lighting/Basic-Lightings) comes precomputed from the CPU
+	Normal = normalMatrix() * aNormal;
 
-	WorldPos = (u_model * vec4(aPos, 1.0)).xyz;
+	WorldPos = (modelMatrix() * vec4(localPosition(), 1.0)).xyz;
 
-	gl_Position = u_proj * u_view * u_model * vec4(aPos, 1.0);
+	gl_Position = clipPosition();
 }
\ No newline at end of file
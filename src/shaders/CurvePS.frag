@@ -0,0 +1,11 @@
+#version 330 core
+in float CurveParameter;
+out vec4 FragColor;
+
+uniform vec3 u_startColor;
+uniform vec3 u_endColor;
+
+void main()
+{
+	FragColor = vec4(mix(u_startColor, u_endColor, CurveParameter), 1.0);
+}
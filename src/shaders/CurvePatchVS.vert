@@ -0,0 +1,7 @@
+#version 330 core
+
+// One patch of one vertex per segment, the evaluation shader finds its segment through gl_PrimitiveID
+void main()
+{
+	gl_Position = vec4(0.0);
+}
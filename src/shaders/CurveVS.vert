@@ -0,0 +1,14 @@
+#version 330 core
+#include "curve_eval.glsl"
+
+// No vertex attributes: vertex i of the line strip is the curve at i / u_lastVertex
+uniform int u_lastVertex;
+uniform mat4 u_viewProj;
+
+out float CurveParameter;
+
+void main()
+{
+	CurveParameter = float(gl_VertexID) / float(u_lastVertex);
+	gl_Position = u_viewProj * vec4(curvePoint(CurveParameter), 1.0);
+}
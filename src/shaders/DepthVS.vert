@@ -0,0 +1,10 @@
+#version 330 core
+#include "vertex_input.glsl"	// position-only stream, no normals needed for depth
+
+// Must match BasicVS.vert exactly so the colour pass passes a GL_EQUAL depth test
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = clipPosition();
+}
@@ -0,0 +1,45 @@
+// Curves drawn by CurveRenderer: consecutive Bezier segments of one degree, their control points in a uniform block
+// already multiplied by the binomial coefficients, so evaluation is Horner's rule like BezierCurve::evaluate().
+
+#define MAX_CURVE_POINTS 256	// CurveRenderer::MAX_POINTS
+
+layout (std140) uniform CurvePoints
+{
+	vec4 u_curvePoints[MAX_CURVE_POINTS];
+};
+
+uniform int u_segmentCount;
+uniform int u_degree;
+
+vec3 curveSegmentPoint(int segment, float t)
+{
+	int first = segment * (u_degree + 1);
+	float u = 1.0 - t;
+	float scale = 1.0;
+	vec3 sum;
+	if (t <= 0.5) {
+		// (1 - t)^n * sum(w_i s^i), s = t / (1 - t)
+		float s = t / u;
+		sum = u_curvePoints[first + u_degree].xyz;
+		for (int i = u_degree - 1; i >= 0; --i) {
+			sum = sum * s + u_curvePoints[first + i].xyz;
+			scale *= u;
+		}
+	} else {
+		float s = u / t;
+		sum = u_curvePoints[first].xyz;
+		for (int i = 1; i <= u_degree; ++i) {
+			sum = sum * s + u_curvePoints[first + i].xyz;
+			scale *= t;
+		}
+	}
+	return sum * scale;
+}
+
+// u from 0 to 1 over the whole curve, every segment taking an equal share
+vec3 curvePoint(float u)
+{
+	float position = clamp(u, 0.0, 1.0) * float(u_segmentCount);
+	int segment = min(int(position), u_segmentCount - 1);
+	return curveSegmentPoint(segment, position - float(segment));
+}
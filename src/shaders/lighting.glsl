@@ -0,0 +1,36 @@
+// Shared Phong lighting terms, included by the lit fragment shaders.
+// The specular model is chosen at compile time: SPECULAR_NONE, SPECULAR_PHONG (default) or SPECULAR_BLINN_PHONG.
+
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 1
+#endif
+
+#if !defined(SPECULAR_NONE) && !defined(SPECULAR_BLINN_PHONG) && !defined(SPECULAR_PHONG)
+#define SPECULAR_PHONG 1
+#endif
+
+struct LightTerms
+{
+	float diffuse;
+	float specular;
+};
+
+// N: unit surface normal, V: unit direction to the eye, L: unit direction to the light
+LightTerms phongTerms(vec3 N, vec3 V, vec3 L, float shininess)
+{
+	LightTerms terms;
+	terms.diffuse = max(dot(N, L), 0.0);
+
+#if defined(SPECULAR_PHONG)
+	vec3 R = reflect(-L, N);
+	terms.specular = pow(max(dot(R, V), 0.0), shininess);
+#elif defined(SPECULAR_BLINN_PHONG)
+	// Blinn-Phong highlights are wider for the same exponent, roughly 4x matches Phong
+	vec3 H = normalize(L + V);
+	terms.specular = pow(max(dot(N, H), 0.0), 4.0 * shininess);
+#else
+	terms.specular = 0.0;
+#endif
+
+	return terms;
+}
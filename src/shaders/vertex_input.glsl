@@ -0,0 +1,57 @@
+// Vertex inputs shared by every program that draws meshes. BasicVS.vert and DepthVS.vert must compute gl_Position
+// through clipPosition() so the depth pre-pass produces bit-identical depth for the GL_EQUAL test.
+
+layout (location = 0) in vec3 aPos;
+
+// Model, MVP and normal matrices are derived on the CPU (TransformBatch), the shaders only multiply
+#ifdef INSTANCING
+layout (location = 2) in mat4 aModel;			// per-instance, occupies locations 2-5
+layout (location = 6) in mat3 aNormalMatrix;	// per-instance, occupies locations 6-8
+uniform mat4 u_viewProj;
+#else
+uniform mat4 u_model;
+uniform mat4 u_mvp;
+uniform mat3 u_normalMatrix;
+#endif
+
+#ifdef QUANTISED_ATTRIBUTES
+// Positions are normalised 16-bit integers in [0, 1] across the mesh bounds
+uniform vec3 u_posScale;
+uniform vec3 u_posOffset;
+#endif
+
+mat4 modelMatrix()
+{
+#ifdef INSTANCING
+	return aModel;
+#else
+	return u_model;
+#endif
+}
+
+mat3 normalMatrix()
+{
+#ifdef INSTANCING
+	return aNormalMatrix;
+#else
+	return u_normalMatrix;
+#endif
+}
+
+vec3 localPosition()
+{
+#ifdef QUANTISED_ATTRIBUTES
+	return aPos * u_posScale + u_posOffset;
+#else
+	return aPos;
+#endif
+}
+
+vec4 clipPosition()
+{
+#ifdef INSTANCING
+	return u_viewProj * (aModel * vec4(localPosition(), 1.0));
+#else
+	return u_mvp * vec4(localPosition(), 1.0);
+#endif
+}
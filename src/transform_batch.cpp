@@ -0,0 +1,164 @@
+#include "transform_batch.hpp"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+uint32_t TransformBatch::add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    uint32_t handle = (uint32_t) count++;
+    size_t padded = (count + 3) & ~(size_t) 3;
+    for (std::vector<float>* component : { &px, &py, &pz, &qx, &qy, &qz, &qw, &sx, &sy, &sz }) {
+        component->resize(padded, 0.0f);
+    }
+    dirty.resize(padded, 0);
+    models.resize(count);
+    mvps.resize(count);
+    normals.resize(count);
+    set(handle, position, rotation, scale);
+    return handle;
+}
+
+void TransformBatch::set(uint32_t handle, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    px[handle] = position.x;
+    py[handle] = position.y;
+    pz[handle] = position.z;
+    qx[handle] = rotation.x;
+    qy[handle] = rotation.y;
+    qz[handle] = rotation.z;
+    qw[handle] = rotation.w;
+    sx[handle] = scale.x;
+    sy[handle] = scale.y;
+    sz[handle] = scale.z;
+    dirty[handle] = 1;
+    anyDirty = true;
+}
+
+// Derives model and normal matrices for objects first .. first + 3. The inputs of unused lanes are zero, which gives
+// finite garbage that is never written out.
+void TransformBatch::composeGroup(size_t first) {
+    // Rows of the 3x3 parts, one lane per object: m[column * 3 + row]
+    alignas(16) float m[9][4];
+    alignas(16) float n[9][4];
+
+#ifdef TRANSFORM_USE_SSE
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 x = _mm_loadu_ps(&qx[first]);
+    __m128 y = _mm_loadu_ps(&qy[first]);
+    __m128 z = _mm_loadu_ps(&qz[first]);
+    __m128 w = _mm_loadu_ps(&qw[first]);
+
+    // 2 / |q|^2 instead of 2 so unnormalised quaternions still give a pure rotation
+    __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                 _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+    __m128 valid = _mm_cmpgt_ps(lengthSq, _mm_setzero_ps());
+    __m128 s = _mm_and_ps(_mm_div_ps(_mm_set1_ps(2.0f), _mm_or_ps(lengthSq, _mm_andnot_ps(valid, one))), valid);
+
+    __m128 xs = _mm_mul_ps(x, s), ys = _mm_mul_ps(y, s), zs = _mm_mul_ps(z, s);
+    __m128 xx = _mm_mul_ps(x, xs), yy = _mm_mul_ps(y, ys), zz = _mm_mul_ps(z, zs);
+    __m128 xy = _mm_mul_ps(x, ys), xz = _mm_mul_ps(x, zs), yz = _mm_mul_ps(y, zs);
+    __m128 wx = _mm_mul_ps(w, xs), wy = _mm_mul_ps(w, ys), wz = _mm_mul_ps(w, zs);
+
+    __m128 r[9];
+    r[0] = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+    r[1] = _mm_add_ps(xy, wz);
+    r[2] = _mm_sub_ps(xz, wy);
+    r[3] = _mm_sub_ps(xy, wz);
+    r[4] = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+    r[5] = _mm_add_ps(yz, wx);
+    r[6] = _mm_add_ps(xz, wy);
+    r[7] = _mm_sub_ps(yz, wx);
+    r[8] = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+
+    __m128 scale[3] = { _mm_loadu_ps(&sx[first]), _mm_loadu_ps(&sy[first]), _mm_loadu_ps(&sz[first]) };
+    for (int column = 0; column < 3; ++column) {
+        // A zero scale has no inverse, its normals are left unscaled
+        __m128 nonZero = _mm_cmpneq_ps(scale[column], _mm_setzero_ps());
+        __m128 inverse = _mm_div_ps(one, _mm_or_ps(_mm_and_ps(scale[column], nonZero), _mm_andnot_ps(nonZero, one)));
+        for (int row = 0; row < 3; ++row) {
+            _mm_store_ps(m[column * 3 + row], _mm_mul_ps(r[column * 3 + row], scale[column]));
+            _mm_store_ps(n[column * 3 + row], _mm_mul_ps(r[column * 3 + row], inverse));
+        }
+    }
+#else
+    for (int lane = 0; lane < 4; ++lane) {
+        size_t i = first + lane;
+        float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+        float lengthSq = x * x + y * y + z * z + w * w;
+        float s = lengthSq > 0.0f ? 2.0f / lengthSq : 0.0f;
+        float r[9] = {
+            1.0f - (y * y + z * z) * s, (x * y + w * z) * s, (x * z - w * y) * s,
+            (x * y - w * z) * s, 1.0f - (x * x + z * z) * s, (y * z + w * x) * s,
+            (x * z + w * y) * s, (y * z - w * x) * s, 1.0f - (x * x + y * y) * s
+        };
+        float scale[3] = { sx[i], sy[i], sz[i] };
+        for (int column = 0; column < 3; ++column) {
+            float inverse = scale[column] != 0.0f ? 1.0f / scale[column] : 1.0f;
+            for (int row = 0; row < 3; ++row) {
+                m[column * 3 + row][lane] = r[column * 3 + row] * scale[column];
+                n[column * 3 + row][lane] = r[column * 3 + row] * inverse;
+            }
+        }
+    }
+#endif
+
+    for (int lane = 0; lane < 4 && first + lane < count; ++lane) {
+        size_t i = first + lane;
+        glm::mat4& model = models[i];
+        glm::mat3& normal = normals[i];
+        for (int column = 0; column < 3; ++column) {
+            for (int row = 0; row < 3; ++row) {
+                model[column][row] = m[column * 3 + row][lane];
+                normal[column][row] = n[column * 3 + row][lane];
+            }
+            model[column][3] = 0.0f;
+        }
+        model[3] = glm::vec4(px[i], py[i], pz[i], 1.0f);
+    }
+}
+
+static void multiply(const glm::mat4& viewProj, const glm::mat4& model, glm::mat4& result) {
+#ifdef TRANSFORM_USE_SSE
+    __m128 vp[4];
+    for (int k = 0; k < 4; ++k) {
+        vp[k] = _mm_loadu_ps(&viewProj[k][0]);
+    }
+    for (int column = 0; column < 4; ++column) {
+        __m128 sum = _mm_mul_ps(vp[0], _mm_set1_ps(model[column][0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(vp[1], _mm_set1_ps(model[column][1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(vp[2], _mm_set1_ps(model[column][2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(vp[3], _mm_set1_ps(model[column][3])));
+        _mm_storeu_ps(&result[column][0], sum);
+    }
+#else
+    result = viewProj * model;
+#endif
+}
+
+void TransformBatch::update(const glm::mat4& viewProj) {
+    lastStats = TransformStats();
+    lastStats.objects = (uint32_t) count;
+
+    if (anyDirty) {
+        for (size_t first = 0; first < count; first += 4) {
+            if (dirty[first] | dirty[first + 1] | dirty[first + 2] | dirty[first + 3]) {
+                composeGroup(first);
+            }
+        }
+    }
+
+    bool viewChanged = std::memcmp(&viewProj[0][0], &lastViewProj[0][0], sizeof(glm::mat4)) != 0;
+    lastViewProj = viewProj;
+    if (viewChanged || anyDirty) {
+        for (size_t i = 0; i < count; ++i) {
+            if (viewChanged || dirty[i]) {
+                multiply(viewProj, models[i], mvps[i]);
+                lastStats.mvpsUpdated++;
+            }
+            lastStats.modelsUpdated += dirty[i];
+            dirty[i] = 0;
+        }
+    }
+    anyDirty = false;
+}
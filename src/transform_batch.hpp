@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+struct TransformStats {
+    uint32_t objects = 0;
+    uint32_t modelsUpdated = 0;     // model and normal matrices recomputed last update()
+    uint32_t mvpsUpdated = 0;
+};
+
+// Translation, rotation and scale of every object, with the matrices the shaders need derived in one batch.
+//
+// Inputs are stored as structure of arrays and update() derives model and normal matrices four objects at a time with
+// SSE, only for objects set() since the last update. MVPs are rebuilt for every object when the view-projection
+// changed and only for the dirty ones otherwise. The normal matrix of T * R * S is R * S^-1, so no inverse is needed.
+class TransformBatch {
+public:
+    // Returns the handle used for everything else, handles stay valid for the batch's lifetime
+    uint32_t add(const glm::vec3& position = glm::vec3(0.0f),
+                 const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                 const glm::vec3& scale = glm::vec3(1.0f));
+    // Rotation doesn't need to be normalised
+    void set(uint32_t handle, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+    void update(const glm::mat4& viewProj);
+
+    const glm::mat4& model(uint32_t handle) const { return models[handle]; }
+    const glm::mat4& mvp(uint32_t handle) const { return mvps[handle]; }
+    const glm::mat3& normalMatrix(uint32_t handle) const { return normals[handle]; }
+
+    size_t size() const { return count; }
+    const TransformStats& stats() const { return lastStats; }
+
+private:
+    size_t count = 0;
+    // Inputs, padded to a multiple of 4 so the SIMD path can always load whole groups
+    std::vector<float> px, py, pz;
+    std::vector<float> qx, qy, qz, qw;
+    std::vector<float> sx, sy, sz;
+    std::vector<uint8_t> dirty;
+    bool anyDirty = false;
+
+    std::vector<glm::mat4> models;
+    std::vector<glm::mat4> mvps;
+    std::vector<glm::mat3> normals;
+    glm::mat4 lastViewProj = glm::mat4(0.0f);
+    TransformStats lastStats;
+
+    void composeGroup(size_t first);
+};
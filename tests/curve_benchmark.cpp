@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bezier_curve.hpp"
+
+// Nanoseconds per point of Bezier evaluation: the tgamma()/pow() sum BezierCurve replaced, BezierCurve::evaluate() one
+// point at a time and the batched evaluate(). Not a test, the numbers depend on the machine.
+
+static const size_t POINTS = 200000;
+static const int REPEATS = 5;
+
+// calculateBezierPoint() as it was before BezierCurve
+static glm::vec3 oldBezierPoint(float t, const std::vector<glm::vec3>& controlPoints) {
+    size_t n = controlPoints.size() - 1;
+    glm::vec3 point(0.0f);
+    for (size_t i = 0; i <= n; ++i) {
+        float binomialCoeff = static_cast<float>(tgamma(n + 1) / (tgamma(i + 1) * tgamma(n - i + 1)));
+        float powT = std::pow(t, (float) i);
+        float powOneMinusT = std::pow(1 - t, (float) (n - i));
+        point += binomialCoeff * powT * powOneMinusT * controlPoints[i];
+    }
+    return point;
+}
+
+// Best of REPEATS runs, in nanoseconds per point. The sum of the results is kept so nothing is optimised away.
+template <typename Evaluate>
+static double timePerPoint(Evaluate evaluate, float& sink) {
+    double best = 1e30;
+    for (int r = 0; r < REPEATS; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        sink += evaluate();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / POINTS);
+    }
+    return best;
+}
+
+int main() {
+    std::mt19937 random(40);
+    std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+    std::vector<float> ts(POINTS);
+    for (size_t i = 0; i < POINTS; ++i) {
+        ts[i] = (float) i / (float) (POINTS - 1);
+    }
+    std::vector<glm::vec3> out(POINTS);
+    float sink = 0.0f;
+
+    std::cout << "Kernel: " << CurveKernelName() << ", " << POINTS << " points" << std::endl;
+    std::cout << "degree    pow/tgamma    evaluate()    batched    speed-up" << std::endl;
+    for (size_t degree : { 3, 5, 7, 12, 20 }) {
+        std::vector<glm::vec3> points(degree + 1);
+        for (glm::vec3& p : points) {
+            p = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+        }
+        BezierCurve curve(points);
+
+        double old = timePerPoint([&] {
+            for (size_t i = 0; i < POINTS; ++i) {
+                out[i] = oldBezierPoint(ts[i], points);
+            }
+            return out[POINTS / 2].x;
+        }, sink);
+        double single = timePerPoint([&] {
+            for (size_t i = 0; i < POINTS; ++i) {
+                out[i] = curve.evaluate(ts[i]);
+            }
+            return out[POINTS / 2].x;
+        }, sink);
+        double batched = timePerPoint([&] {
+            curve.evaluate(ts.data(), out.data(), POINTS);
+            return out[POINTS / 2].x;
+        }, sink);
+
+        std::printf("%6zu %13.1f %13.1f %10.1f %10.1fx\n", degree, old, single, batched, old / batched);
+    }
+    std::cout << "(" << sink << ")" << std::endl;
+    return 0;
+}
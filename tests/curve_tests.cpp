@@ -0,0 +1,871 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "adaptive_tessellation.hpp"
+#include "animation_tracks.hpp"
+#include "arc_length.hpp"
+#include "bezier_curve.hpp"
+#include "curve_bvh.hpp"
+#include "curve_kernels.hpp"
+#include "piecewise_path.hpp"
+#include "rotation_spline.hpp"
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cout << "[ERROR][curve_tests] " << what << std::endl;
+        failures++;
+    }
+}
+
+static std::vector<glm::vec3> randomPoints(std::mt19937& random, size_t count) {
+    std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+    std::vector<glm::vec3> points(count);
+    for (glm::vec3& p : points) {
+        p = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+    }
+    return points;
+}
+
+// calculateBezierPoint() as it was before BezierCurve, binomials from tgamma() and powers from pow()
+static glm::vec3 oldBezierPoint(float t, const std::vector<glm::vec3>& controlPoints) {
+    size_t n = controlPoints.size() - 1;
+    glm::vec3 point(0.0f);
+    for (size_t i = 0; i <= n; ++i) {
+        float binomialCoeff = static_cast<float>(tgamma(n + 1) / (tgamma(i + 1) * tgamma(n - i + 1)));
+        float powT = std::pow(t, (float) i);
+        float powOneMinusT = std::pow(1 - t, (float) (n - i));
+        point += binomialCoeff * powT * powOneMinusT * controlPoints[i];
+    }
+    return point;
+}
+
+// de Casteljau in double precision, the exact answer as far as float results go
+static glm::dvec3 referencePoint(double t, const std::vector<glm::vec3>& controlPoints) {
+    std::vector<glm::dvec3> level(controlPoints.begin(), controlPoints.end());
+    for (size_t k = level.size(); k-- > 1;) {
+        for (size_t i = 0; i < k; ++i) {
+            level[i] = level[i] * (1.0 - t) + level[i + 1] * t;
+        }
+    }
+    return level[0];
+}
+
+static double error(const glm::vec3& p, const glm::dvec3& reference) {
+    glm::dvec3 d = glm::dvec3(p) - reference;
+    return std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+}
+
+// Horner on the Bernstein form against the tgamma()/pow() sum it replaced, both measured against de Casteljau
+static void testBezierAccuracy() {
+    std::mt19937 random(40);
+    const int SAMPLES = 1000;
+    for (size_t degree = 1; degree <= 20; ++degree) {
+        std::vector<glm::vec3> points = randomPoints(random, degree + 1);
+        BezierCurve curve(points);
+        double newError = 0.0, oldError = 0.0;
+        for (int i = 0; i <= SAMPLES; ++i) {
+            float t = (float) i / (float) SAMPLES;
+            glm::dvec3 reference = referencePoint(t, points);
+            newError = std::max(newError, error(curve.evaluate(t), reference));
+            oldError = std::max(oldError, error(oldBezierPoint(t, points), reference));
+        }
+        // Both stay within a few float ulps of points about 10 across (up to 7e-6 at degree 20), the new one no worse
+        // than twice the old
+        check(newError <= 1e-5 && newError <= 2.0 * oldError,
+              "degree " + std::to_string(degree) + ": error " + std::to_string(newError) + ", was "
+              + std::to_string(oldError));
+    }
+}
+
+static void testBezierEnds() {
+    std::mt19937 random(41);
+    for (size_t degree = 0; degree <= 12; ++degree) {
+        std::vector<glm::vec3> points = randomPoints(random, degree + 1);
+        BezierCurve curve(points);
+        check(curve.evaluate(0.0f) == points.front(), "degree " + std::to_string(degree) + " doesn't start at P0");
+        check(curve.evaluate(1.0f) == points.back(), "degree " + std::to_string(degree) + " doesn't end at Pn");
+    }
+    check(BezierCurve().evaluate(0.5f) == glm::vec3(0.0f), "a curve without points isn't at the origin");
+}
+
+// Points set once and again with a new degree, the binomials are only rebuilt when the degree changes
+static void testBezierDegreeChange() {
+    std::mt19937 random(42);
+    BezierCurve curve;
+    for (size_t count : { 4, 4, 9, 2, 4 }) {
+        std::vector<glm::vec3> points = randomPoints(random, count);
+        curve.setControlPoints(points);
+        check(curve.degree() == count - 1, "degree isn't " + std::to_string(count - 1));
+        check(error(curve.evaluate(0.3f), referencePoint(0.3f, points)) < 1e-4,
+              std::to_string(count) + " points after a degree change are off");
+    }
+}
+
+static bool sameBits(float a, float b) {
+    return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// The batched evaluate() goes through the widest SIMD kernel the CPU has and has to match evaluate() bit for bit. The
+// count isn't a multiple of any vector width, so the scalar tail runs too.
+static void testBezierBatch() {
+    std::mt19937 random(44);
+    std::uniform_real_distribution<float> parameter(0.0f, 1.0f);
+    const size_t COUNT = 1003;
+    std::vector<float> ts(COUNT);
+    for (float& t : ts) {
+        t = parameter(random);
+    }
+    // Both ends, both sides of the switch to the mirrored form
+    ts[0] = 0.0f;
+    ts[1] = 1.0f;
+    ts[2] = 0.5f;
+    ts[3] = std::nextafter(0.5f, 1.0f);
+
+    std::vector<glm::vec3> out(COUNT);
+    std::vector<float> x(COUNT), y(COUNT), z(COUNT);
+    for (size_t degree = 0; degree <= 11; ++degree) {
+        BezierCurve curve(randomPoints(random, degree + 1));
+        curve.evaluate(ts.data(), out.data(), COUNT);
+        curve.evaluate(ts.data(), x.data(), y.data(), z.data(), COUNT);
+        size_t differing = 0;
+        for (size_t i = 0; i < COUNT; ++i) {
+            glm::vec3 single = curve.evaluate(ts[i]);
+            for (int c = 0; c < 3; ++c) {
+                differing += sameBits(out[i][c], single[c]) ? 0 : 1;
+            }
+            differing += sameBits(x[i], single.x) && sameBits(y[i], single.y) && sameBits(z[i], single.z) ? 0 : 1;
+        }
+        check(differing == 0, std::string(CurveKernelName()) + " kernel, degree " + std::to_string(degree) + ": "
+              + std::to_string(differing) + " values differ from evaluate()");
+    }
+}
+
+static glm::quat randomRotation(std::mt19937& random) {
+    std::normal_distribution<float> normal;
+    return glm::normalize(glm::quat(normal(random), normal(random), normal(random), normal(random)));
+}
+
+// Pairs of rotations in structure of arrays form, some of them close together or a sign flip apart
+struct QuatPairs {
+    std::vector<float> a[4], b[4], t;
+
+    QuatPairs(std::mt19937& random, size_t count) {
+        std::uniform_real_distribution<float> parameter(0.0f, 1.0f);
+        for (int c = 0; c < 4; ++c) {
+            a[c].resize(count);
+            b[c].resize(count);
+        }
+        t.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            glm::quat qa = randomRotation(random);
+            glm::quat qb = randomRotation(random);
+            if (i % 5 == 1) {
+                qb = glm::normalize(qa + 1e-4f * qb);
+            } else if (i % 5 == 2) {
+                qb = -qb;
+            }
+            for (int c = 0; c < 4; ++c) {
+                a[c][i] = qa[c];
+                b[c][i] = qb[c];
+            }
+            t[i] = parameter(random);
+        }
+    }
+
+    glm::quat first(size_t i) const { return quat(a, i); }
+    glm::quat second(size_t i) const { return quat(b, i); }
+    QuatStreams streamsA() { return { a[0].data(), a[1].data(), a[2].data(), a[3].data() }; }
+    QuatStreams streamsB() { return { b[0].data(), b[1].data(), b[2].data(), b[3].data() }; }
+
+    static glm::quat quat(const std::vector<float>* q, size_t i) {
+        return glm::quat(q[3][i], q[0][i], q[1][i], q[2][i]);
+    }
+};
+
+static float maxDifference(const glm::quat& p, const glm::quat& q) {
+    float difference = 0.0f;
+    for (int c = 0; c < 4; ++c) {
+        difference = std::max(difference, std::fabs(p[c] - q[c]));
+    }
+    return difference;
+}
+
+static void testNlerp() {
+    std::mt19937 random(45);
+    const size_t COUNT = 1001;
+    QuatPairs pairs(random, COUNT);
+    std::vector<float> out[4];
+    for (std::vector<float>& component : out) {
+        component.resize(COUNT);
+    }
+    QuatStreams streams = { out[0].data(), out[1].data(), out[2].data(), out[3].data() };
+    NlerpBatch(pairs.streamsA(), pairs.streamsB(), pairs.t.data(), streams, COUNT);
+
+    float worst = 0.0f;
+    for (size_t i = 0; i < COUNT; ++i) {
+        glm::quat a = pairs.first(i), b = pairs.second(i);
+        if (glm::dot(a, b) < 0.0f) {
+            b = -b;
+        }
+        glm::quat expected = glm::normalize(a * (1.0f - pairs.t[i]) + b * pairs.t[i]);
+        worst = std::max(worst, maxDifference(QuatPairs::quat(out, i), expected));
+    }
+    check(worst <= 1e-6f, std::string(CurveKernelName()) + " nlerp is " + std::to_string(worst) + " off");
+}
+
+// Within 2e-6 of glm::slerp() as curve_kernels.hpp says, also when writing over the first input
+static void testSlerp() {
+    std::mt19937 random(46);
+    const size_t COUNT = 1001;
+    QuatPairs pairs(random, COUNT);
+    std::vector<glm::quat> expected(COUNT);
+    for (size_t i = 0; i < COUNT; ++i) {
+        expected[i] = glm::slerp(pairs.first(i), pairs.second(i), pairs.t[i]);
+    }
+    SlerpBatch(pairs.streamsA(), pairs.streamsB(), pairs.t.data(), pairs.streamsA(), COUNT);
+
+    float worst = 0.0f;
+    for (size_t i = 0; i < COUNT; ++i) {
+        worst = std::max(worst, maxDifference(pairs.first(i), expected[i]));
+    }
+    check(worst <= 2e-6f, std::string(CurveKernelName()) + " slerp is " + std::to_string(worst) + " off");
+}
+
+// CurveBvh::nearest() against dense sampling of every segment, on paths of random (often looping) segments measured in
+// pixels as the overlay does
+static void testCurveBvh() {
+    std::mt19937 random(49);
+    std::uniform_real_distribution<float> coordinate(-0.2f, 1.2f);
+    const glm::vec3 scale(800.0f, 600.0f, 1.0f);
+    const int SAMPLES = 2000;
+    for (int degree : { 1, 2, 3, 5, 7 }) {
+        const size_t SEGMENTS = 8;
+        std::vector<glm::vec3> points = randomPoints(random, SEGMENTS * (degree + 1));
+        for (glm::vec3& p : points) {
+            p = glm::vec3(coordinate(random), coordinate(random), 0.0f);
+        }
+        CurveBvh bvh;
+        bvh.build(points.data(), SEGMENTS, degree, scale);
+        check(bvh.pieceCount() == SEGMENTS * 4, "degree " + std::to_string(degree) + ": "
+              + std::to_string(bvh.pieceCount()) + " pieces instead of 4 per segment");
+
+        std::vector<BezierCurve> segments;
+        std::vector<glm::vec3> scaled(degree + 1);
+        for (size_t s = 0; s < SEGMENTS; ++s) {
+            for (int i = 0; i <= degree; ++i) {
+                scaled[i] = points[s * (degree + 1) + i] * scale;
+            }
+            segments.emplace_back(scaled);
+        }
+
+        float worst = 0.0f;
+        for (int query = 0; query < 100; ++query) {
+            glm::vec3 point = glm::vec3(coordinate(random), coordinate(random), 0.0f) * scale;
+            float sampled = std::numeric_limits<float>::max();
+            for (const BezierCurve& segment : segments) {
+                for (int i = 0; i <= SAMPLES; ++i) {
+                    sampled = std::min(sampled, glm::length(segment.evaluate((float) i / SAMPLES) - point));
+                }
+            }
+
+            CurveHit hit = bvh.nearest(point);
+            if (!hit.found || hit.segment >= SEGMENTS) {
+                check(false, "degree " + std::to_string(degree) + ": no hit");
+                continue;
+            }
+            // The hit is where it says on the curve, and no further than the closest sample
+            float onCurve = glm::length(segments[hit.segment].evaluate(hit.t) - hit.point);
+            check(onCurve < 1e-3f && std::fabs(glm::length(hit.point - point) - hit.distance) < 1e-3f,
+                  "degree " + std::to_string(degree) + ": hit at t = " + std::to_string(hit.t) + " is "
+                  + std::to_string(onCurve) + " px off the curve");
+            worst = std::max(worst, hit.distance - sampled);
+
+            CurveHit limited = bvh.nearest(point, hit.distance * 0.5f);
+            check(!limited.found || hit.distance == 0.0f, "degree " + std::to_string(degree)
+                  + ": a hit beyond maxDistance");
+        }
+        check(worst < 1e-2f, "degree " + std::to_string(degree) + ": up to " + std::to_string(worst)
+              + " px further than the closest sample");
+    }
+}
+
+// Keys every half second with a value of twice the time, so every sample has a known answer
+static uint32_t addRamp(AnimationTracks& tracks, int keys) {
+    std::vector<float> times;
+    std::vector<glm::vec3> values;
+    for (int i = 0; i < keys; ++i) {
+        times.push_back(0.5f * (float) i);
+        values.push_back(glm::vec3((float) i, -(float) i, 1.0f));
+    }
+    return tracks.addTrack(TrackChannel::POSITION, times, values);
+}
+
+// Playback moving forward finds its key at the cursor or the one after, scrubbing back, jumping ahead and looping
+// search
+static void testTrackCursor() {
+    AnimationTracks tracks;
+    uint32_t track = addRamp(tracks, 20);
+    tracks.takeStats();
+
+    // Steps shorter than a key, so the cursor never has to move more than one key
+    uint32_t samples = 0;
+    float worst = 0.0f;
+    for (int frame = 0; frame < 90; ++frame) {
+        float time = 0.05f + 0.1f * (float) frame;
+        tracks.sample(time);
+        worst = std::max(worst, std::fabs(tracks.vec3(track).x - 2.0f * time));
+        samples++;
+    }
+    TrackStats stats = tracks.takeStats();
+    check(stats.cursorHits == samples && stats.searches == 0, "forward playback: " + std::to_string(stats.cursorHits)
+          + " cursor hits and " + std::to_string(stats.searches) + " searches in " + std::to_string(samples)
+          + " samples");
+    check(worst < 1e-4f, "forward playback is " + std::to_string(worst) + " off");
+
+    // Scrubbing back, jumping ahead several keys and looping to the start each need a search and still land right
+    const float jumps[] = { 2.3f, 7.7f, 0.3f };
+    for (float time : jumps) {
+        tracks.sample(time);
+        check(std::fabs(tracks.vec3(track).x - 2.0f * time) < 1e-4f, "sample at " + std::to_string(time) + " after a "
+              "jump is " + std::to_string(tracks.vec3(track).x));
+    }
+    stats = tracks.takeStats();
+    check(stats.searches == 3 && stats.cursorHits == 0, std::to_string(stats.searches) + " searches for 3 jumps");
+
+    // Outside the keys the ends are held
+    tracks.sample(-1.0f);
+    check(tracks.vec3(track) == glm::vec3(0.0f, 0.0f, 1.0f), "before the first key isn't the first key");
+    tracks.sample(100.0f);
+    check(tracks.vec3(track) == glm::vec3(19.0f, -19.0f, 1.0f), "after the last key isn't the last key");
+}
+
+// 16 bit keys are within half a quantisation step of the float ones, at the keys and between them
+static void testTrackQuantisation() {
+    std::mt19937 random(46);
+    std::vector<glm::vec3> values = randomPoints(random, 50);
+    std::vector<float> times;
+    glm::vec3 minimum = values[0], maximum = values[0];
+    for (size_t i = 0; i < values.size(); ++i) {
+        times.push_back((float) i);
+        minimum = glm::min(minimum, values[i]);
+        maximum = glm::max(maximum, values[i]);
+    }
+    AnimationTracks tracks;
+    uint32_t exact = tracks.addTrack(TrackChannel::POSITION, times, values);
+    uint32_t quantised = tracks.addTrack(TrackChannel::POSITION, times, values, true);
+
+    glm::vec3 step = (maximum - minimum) / 65535.0f;
+    float worst = 0.0f;
+    for (int i = 0; i <= 4 * 49; ++i) {
+        tracks.sample(0.25f * (float) i);
+        glm::vec3 difference = glm::abs(tracks.vec3(quantised) - tracks.vec3(exact));
+        for (int c = 0; c < 3; ++c) {
+            // Plus float rounding of values about 10 across
+            worst = std::max(worst, difference[c] / (0.5f * step[c] + 2e-6f));
+        }
+    }
+    check(worst <= 1.0f, "quantised values are " + std::to_string(worst) + " half steps off");
+
+    size_t bytes = tracks.takeStats().bytes;
+    check(bytes == 50 * 2 * sizeof(float) + 50 * 3 * sizeof(float) + 50 * 3 * sizeof(uint16_t),
+          "key storage is " + std::to_string(bytes) + " bytes");
+}
+
+// Rotation keys of either sign and any length take the short way between them
+static void testTrackRotations() {
+    std::mt19937 random(47);
+    AnimationTracks tracks;
+    for (int quantise = 0; quantise < 2; ++quantise) {
+        std::vector<float> times;
+        std::vector<glm::quat> keys;
+        glm::quat q = randomRotation(random);
+        for (int i = 0; i < 10; ++i) {
+            // Small steps, every other key negated and scaled the way a UI might leave them
+            q = glm::normalize(q + 0.2f * randomRotation(random));
+            times.push_back((float) i);
+            keys.push_back(i % 2 == 1 ? q * -3.0f : q);
+        }
+        uint32_t track = tracks.addTrack(times, keys, quantise == 1);
+
+        float worstKey = 0.0f, worstMiddle = 0.0f, worstLength = 0.0f;
+        for (int i = 0; i < 10; ++i) {
+            tracks.sample((float) i);
+            glm::quat atKey = tracks.rotation(track);
+            worstKey = std::max(worstKey, 1.0f - std::fabs(glm::dot(atKey, glm::normalize(keys[i]))));
+            worstLength = std::max(worstLength, std::fabs(glm::length(atKey) - 1.0f));
+            if (i + 1 < 10) {
+                tracks.sample((float) i + 0.5f);
+                glm::quat middle = tracks.rotation(track);
+                glm::quat a = glm::normalize(keys[i]), b = glm::normalize(keys[i + 1]);
+                glm::quat expected = glm::normalize(glm::dot(a, b) < 0.0f ? a - b : a + b);
+                worstMiddle = std::max(worstMiddle, 1.0f - std::fabs(glm::dot(middle, expected)));
+                worstLength = std::max(worstLength, std::fabs(glm::length(middle) - 1.0f));
+            }
+        }
+        std::string name = quantise == 1 ? "quantised rotations" : "rotations";
+        check(worstKey < 1e-6f, name + " miss their keys by " + std::to_string(worstKey));
+        check(worstMiddle < 1e-6f, name + " take the long way, " + std::to_string(worstMiddle) + " off between keys");
+        check(worstLength < 1e-5f, name + " aren't unit length, " + std::to_string(worstLength) + " off");
+    }
+}
+
+// Sampling in ranges on several threads gives what one pass gives, counters included
+static void testTrackThreads() {
+    std::mt19937 random(48);
+    std::uniform_int_distribution<int> keyCount(1, 40);
+    AnimationTracks single, split;
+    for (int t = 0; t < 1000; ++t) {
+        int keys = keyCount(random);
+        std::vector<float> times;
+        float time = 0.0f;
+        for (int i = 0; i < keys; ++i) {
+            time += 0.05f + 0.5f * (float) (random() % 100) / 100.0f;
+            times.push_back(time);
+        }
+        if (t % 3 == 0) {
+            std::vector<glm::quat> rotations;
+            for (int i = 0; i < keys; ++i) {
+                rotations.push_back(randomRotation(random));
+            }
+            single.addTrack(times, rotations, t % 2 == 0);
+            split.addTrack(times, rotations, t % 2 == 0);
+        } else {
+            std::vector<glm::vec3> values = randomPoints(random, keys);
+            single.addTrack(TrackChannel::POSITION, times, values, t % 2 == 0);
+            split.addTrack(TrackChannel::POSITION, times, values, t % 2 == 0);
+        }
+    }
+
+    const uint32_t THREADS = 4;
+    const uint32_t RANGE = (uint32_t) (split.size() + THREADS - 1) / THREADS;
+    size_t differing = 0;
+    for (int frame = 0; frame < 200; ++frame) {
+        // Mostly forward playback with a loop in the middle
+        float time = 0.1f * (float) (frame % 120);
+        single.sample(time);
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < THREADS; ++i) {
+            threads.emplace_back([&split, time, i, RANGE] { split.sample(time, i * RANGE, RANGE); });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        for (uint32_t t = 0; t < single.size(); ++t) {
+            glm::quat a = single.rotation(t), b = split.rotation(t);
+            differing += a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w ? 0 : 1;
+        }
+    }
+    check(differing == 0, std::to_string(differing) + " samples differ between threaded ranges and one pass");
+    TrackStats a = single.takeStats(), b = split.takeStats();
+    check(a.cursorHits == b.cursorHits && a.searches == b.searches && a.cursorHits > 0 && a.searches > 0,
+          "threaded ranges count " + std::to_string(b.cursorHits) + " hits and " + std::to_string(b.searches)
+          + " searches, one pass " + std::to_string(a.cursorHits) + " and " + std::to_string(a.searches));
+}
+
+// Length of the dense polyline through the curve from 0 up to every sample, the reference for arc length
+static std::vector<double> polylineLengths(const BezierCurve& curve, int samples) {
+    std::vector<double> lengths(samples + 1, 0.0);
+    glm::vec3 previous = curve.evaluate(0.0f);
+    for (int i = 1; i <= samples; ++i) {
+        glm::vec3 p = curve.evaluate((float) i / samples);
+        lengths[i] = lengths[i - 1] + glm::length(p - previous);
+        previous = p;
+    }
+    return lengths;
+}
+
+// Polyline length up to t, interpolated between samples
+static double polylineLengthAt(const std::vector<double>& lengths, float t) {
+    double position = std::max(0.0, std::min((double) t, 1.0)) * (double) (lengths.size() - 1);
+    size_t i = std::min((size_t) position, lengths.size() - 2);
+    return lengths[i] + (position - (double) i) * (lengths[i + 1] - lengths[i]);
+}
+
+// length() against a dense polyline, and every parameterAt(d) lands d along it. Random curves and ones whose speed
+// drops to zero at an end, as the clamped ends of a B-spline path do, or in the middle at a cusp.
+static void testArcLength() {
+    std::mt19937 random(43);
+    std::vector<std::vector<glm::vec3>> curves;
+    for (size_t degree : { 1, 2, 3, 3, 3, 5, 7 }) {
+        curves.push_back(randomPoints(random, degree + 1));
+    }
+    std::vector<glm::vec3> clamped = randomPoints(random, 4);
+    clamped[3] = clamped[2];
+    curves.push_back(clamped);
+    clamped[1] = clamped[0];
+    curves.push_back(clamped);
+    curves.push_back({ glm::vec3(0.0f), glm::vec3(4.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, 0.0f),
+                       glm::vec3(4.0f, 0.0f, 0.0f) });
+
+    const int SAMPLES = 200000;
+    for (size_t c = 0; c < curves.size(); ++c) {
+        BezierCurve curve(curves[c]);
+        std::vector<double> reference = polylineLengths(curve, SAMPLES);
+        double total = reference.back();
+        // The default and the coarse tables of PiecewisePath segments
+        for (int intervals : { 64, PiecewisePath::ARC_LENGTH_INTERVALS }) {
+            std::string name = "arc length, curve " + std::to_string(c) + ", " + std::to_string(intervals)
+                               + " intervals: ";
+            ArcLengthTable table;
+            table.build(curves[c].data(), curves[c].size(), intervals);
+            // The quadrature is only close across the kink in the speed at a cusp
+            double tolerance = c + 1 == curves.size() ? 1e-3 : intervals < 64 ? 5e-4 : 1e-4;
+            check(std::fabs(table.length() - total) < tolerance * total, name + "length "
+                  + std::to_string(table.length()) + ", the polyline is " + std::to_string(total));
+
+            // In order, ends included and many just short of them, where a zero speed hurts most
+            std::vector<float> distances = { 0.0f, 1e-4f * table.length() };
+            for (int i = 1; i < 200; ++i) {
+                distances.push_back(table.length() * (float) i / 200.0f);
+            }
+            for (int i = 20; i > 0; --i) {
+                distances.push_back(table.length() * (1.0f - 1e-4f * (float) i));
+            }
+            distances.push_back(std::nextafter(table.length(), 0.0f));
+            distances.push_back(table.length());
+            std::vector<float> ts(distances.size());
+            table.parametersAt(distances.data(), ts.data(), distances.size());
+            double worst = 0.0;
+            bool ordered = true;
+            for (size_t i = 0; i < distances.size(); ++i) {
+                ordered = ordered && ts[i] >= 0.0f && ts[i] <= 1.0f && (i == 0 || ts[i] >= ts[i - 1]);
+                worst = std::max(worst, std::fabs(polylineLengthAt(reference, ts[i]) - distances[i]));
+            }
+            check(ordered && ts.front() == 0.0f && ts.back() == 1.0f, name + "parameters out of [0, 1] or order");
+            check(worst < 1e-3 * total, name + "parameterAt() lands up to " + std::to_string(worst)
+                  + " from the distance, the curve is " + std::to_string(total) + " long");
+            check(table.parameterAt(-1.0f) == 0.0f && table.parameterAt(2.0f * table.length()) == 1.0f,
+                  name + "distances beyond the curve aren't clamped");
+        }
+    }
+}
+
+// Fewer than two points and coincident points have no length, parameterAt() stays finite and in [0, 1]
+static void testArcLengthDegenerate() {
+    glm::vec3 point(1.0f, 2.0f, 3.0f);
+    std::vector<std::vector<glm::vec3>> cases = { {}, { point }, { point, point }, { point, point, point, point } };
+    for (size_t c = 0; c < cases.size(); ++c) {
+        std::string name = "arc length, degenerate case " + std::to_string(c) + ": ";
+        ArcLengthTable table;
+        table.build(cases[c].data(), cases[c].size());
+        check(table.length() == 0.0f, name + "length " + std::to_string(table.length()));
+        bool valid = true;
+        for (float distance : { -1.0f, 0.0f, 0.5f, 1.0f, 10.0f }) {
+            float t = table.parameterAt(distance);
+            valid = valid && std::isfinite(t) && t >= 0.0f && t <= 1.0f;
+        }
+        check(valid, name + "parameterAt() outside [0, 1]");
+    }
+
+    // Rebuilding a table with real points after a degenerate build works as a fresh one
+    std::vector<glm::vec3> line = { glm::vec3(0.0f), glm::vec3(3.0f, 4.0f, 0.0f) };
+    ArcLengthTable table;
+    table.build(nullptr, 0);
+    table.build(line.data(), line.size(), 1);
+    check(std::fabs(table.length() - 5.0f) < 1e-5f && std::fabs(table.parameterAt(2.5f) - 0.5f) < 1e-5f,
+          "arc length: a line rebuilt after an empty table is " + std::to_string(table.length()) + " long");
+}
+
+static std::string basisName(PathBasis basis) {
+    return basis == PathBasis::B_SPLINE ? "B-spline" : "Catmull-Rom";
+}
+
+// Segments join without gaps, the ends are where they should be and arc length covers the whole path
+static void testPathShape() {
+    std::mt19937 random(47);
+    std::vector<glm::vec3> points = randomPoints(random, 20);
+    for (PathBasis basis : { PathBasis::CATMULL_ROM, PathBasis::B_SPLINE }) {
+        std::string name = basisName(basis);
+        PiecewisePath path;
+        path.setBasis(basis);
+        path.sync(points, 1);
+        size_t segments = path.segmentCount();
+        const std::vector<glm::vec3>& bezier = path.bezierPoints();
+        check(segments > 0 && bezier.size() == segments * 4, name + ": " + std::to_string(bezier.size())
+              + " Bezier points for " + std::to_string(segments) + " segments");
+
+        float gap = 0.0f, jump = 0.0f;
+        for (size_t i = 0; i + 1 < segments; ++i) {
+            gap = std::max(gap, glm::length(bezier[i * 4 + 3] - bezier[(i + 1) * 4]));
+            float join = (float) (i + 1) / (float) segments;
+            jump = std::max(jump, glm::length(path.evaluate(join - 1e-6f) - path.evaluate(join)));
+        }
+        check(gap < 1e-5f, name + ": segments are up to " + std::to_string(gap) + " apart at the joins");
+        check(jump < 1e-3f, name + ": evaluate() jumps by " + std::to_string(jump) + " at a join");
+
+        float ends = std::max(glm::length(path.evaluate(0.0f) - points.front()),
+                              glm::length(path.evaluate(1.0f) - points.back()));
+        check(ends < 1e-5f, name + ": the ends are " + std::to_string(ends) + " off the end points");
+        if (basis == PathBasis::CATMULL_ROM) {
+            float off = 0.0f;
+            for (size_t i = 0; i < points.size(); ++i) {
+                float u = (float) i / (float) (points.size() - 1);
+                off = std::max(off, glm::length(path.evaluate(u) - points[i]));
+            }
+            check(off < 1e-4f, name + ": up to " + std::to_string(off) + " off a control point");
+        }
+
+        check(path.length() > 0.0f && path.parameterAt(0.0f) == 0.0f && path.parameterAt(path.length()) == 1.0f,
+              name + ": parameterAt() gives " + std::to_string(path.parameterAt(path.length()))
+              + " for the whole length");
+    }
+}
+
+// Moving one point of a long path rebuilds and re-tessellates at most the four segments that use it, whether the point
+// is set directly or comes in through sync()
+static void testPathLocalChanges() {
+    std::mt19937 random(470);
+    std::vector<glm::vec3> points = randomPoints(random, 40);
+    for (PathBasis basis : { PathBasis::CATMULL_ROM, PathBasis::B_SPLINE }) {
+        std::string name = basisName(basis);
+        PiecewisePath path;
+        path.setBasis(basis);
+        path.sync(points, 1);
+        path.tessellation(16);
+        check(path.stats().tessellatedSegments == path.segmentCount(), name + ": the first tessellation skipped "
+              "segments");
+
+        for (size_t index : { (size_t) 0, (size_t) 1, points.size() / 2, points.size() - 1 }) {
+            glm::vec3 moved = points[index] + glm::vec3(0.5f, -0.25f, 1.0f);
+            std::string where = name + ", point " + std::to_string(index) + ": ";
+
+            path.setPoint(index, moved);
+            check(path.stats().rebuiltSegments <= 4, where + "setPoint() rebuilt "
+                  + std::to_string(path.stats().rebuiltSegments) + " segments");
+            path.tessellation(16);
+            check(path.stats().tessellatedSegments <= 4, where + "tessellation() after setPoint() redid "
+                  + std::to_string(path.stats().tessellatedSegments) + " segments");
+
+            points[index] = moved + glm::vec3(0.0f, 1.0f, 0.0f);
+            check(path.sync(points, 2 + (uint32_t) index), where + "sync() ignored a new version");
+            check(path.stats().rebuiltSegments <= 4, where + "sync() rebuilt "
+                  + std::to_string(path.stats().rebuiltSegments) + " segments");
+            const std::vector<glm::vec3>& tessellated = path.tessellation(16);
+            check(path.stats().tessellatedSegments <= 4, where + "tessellation() after sync() redid "
+                  + std::to_string(path.stats().tessellatedSegments) + " segments");
+
+            // And the result is the path built from scratch
+            PiecewisePath fresh;
+            fresh.setBasis(basis);
+            fresh.sync(points, 1);
+            const std::vector<glm::vec3>& expected = fresh.tessellation(16);
+            float difference = tessellated.size() == expected.size() ? 0.0f : 1e30f;
+            for (size_t i = 0; i < expected.size() && i < tessellated.size(); ++i) {
+                difference = std::max(difference, glm::length(tessellated[i] - expected[i]));
+            }
+            check(difference < 1e-5f && std::fabs(path.length() - fresh.length()) < 1e-3f, where + "differs by "
+                  + std::to_string(difference) + " from a path built from scratch");
+        }
+    }
+}
+
+// Axis * angle of a rotation, taking the short way
+static glm::vec3 rotationVector(glm::quat q) {
+    if (q.w < 0.0f) {
+        q = -q;
+    }
+    glm::vec3 v(q.x, q.y, q.z);
+    float length = glm::length(v);
+    return length < 1e-9f ? 2.0f * v : v * (2.0f * std::atan2(length, q.w) / length);
+}
+
+// Angle between two rotations, whatever the signs of the quaternions
+static float rotationAngle(const glm::quat& p, const glm::quat& q) {
+    return glm::length(rotationVector(q * glm::conjugate(p)));
+}
+
+// Keys a random but bounded turn apart, as an animator would set them
+static std::vector<glm::quat> randomKeys(std::mt19937& random, size_t count) {
+    std::uniform_real_distribution<float> component(-0.6f, 0.6f);
+    std::vector<glm::quat> keys(1, randomRotation(random));
+    while (keys.size() < count) {
+        glm::quat turn = glm::normalize(glm::quat(1.0f, component(random), component(random), component(random)));
+        keys.push_back(glm::normalize(turn * keys.back()));
+    }
+    return keys;
+}
+
+// The spline passes through every key at i / (n - 1), and neither the orientation nor the angular velocity jumps there
+static void testRotationSplineKeys() {
+    std::mt19937 random(45);
+    for (size_t count : { 2, 3, 8 }) {
+        std::string name = "rotation spline, " + std::to_string(count) + " keys: ";
+        std::vector<glm::quat> keys = randomKeys(random, count);
+        RotationSpline spline;
+        check(spline.sync(keys, 1) && spline.size() == count && !spline.sync(keys, 1), name + "sync() versions");
+
+        float off = 0.0f;
+        for (size_t i = 0; i < count; ++i) {
+            off = std::max(off, rotationAngle(spline.evaluate((float) i / (float) (count - 1)), keys[i]));
+        }
+        check(off < 1e-3f, name + "up to " + std::to_string(off) + " rad off a key");
+
+        // Angular velocity in rad per unit of t from differences of h on either side of every inner key, against the
+        // speed of the segments, which is several rad per unit of t
+        const float h = 1e-3f;
+        float orientationJump = 0.0f, velocityJump = 0.0f, speed = 0.0f;
+        for (size_t i = 1; i + 1 < count; ++i) {
+            float key = (float) i / (float) (count - 1);
+            glm::quat before = spline.evaluate(key - h), at = spline.evaluate(key), after = spline.evaluate(key + h);
+            orientationJump = std::max(orientationJump, std::max(rotationAngle(before, at), rotationAngle(at, after)));
+            glm::vec3 left = rotationVector(at * glm::conjugate(before)) / h;
+            glm::vec3 right = rotationVector(after * glm::conjugate(at)) / h;
+            velocityJump = std::max(velocityJump, glm::length(right - left));
+            speed = std::max(speed, glm::length(left));
+        }
+        if (count > 2) {
+            check(orientationJump < 20.0f * h, name + "the orientation moves " + std::to_string(orientationJump)
+                  + " rad within " + std::to_string(h) + " of a key");
+            check(velocityJump < 0.05f * speed, name + "the angular velocity jumps by " + std::to_string(velocityJump)
+                  + " rad at a key, the speed is " + std::to_string(speed));
+        }
+    }
+}
+
+// Keys as the UI leaves them, not unit length and on either side of the sphere, give the spline of the clean keys
+static void testRotationSplineHemispheres() {
+    std::mt19937 random(450);
+    std::uniform_real_distribution<float> scale(0.2f, 5.0f);
+    std::vector<glm::quat> keys = randomKeys(random, 8);
+    std::vector<glm::quat> raw = keys;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        raw[i] = raw[i] * ((i % 3 == 1 ? -1.0f : 1.0f) * scale(random));
+    }
+    RotationSpline clean, edited;
+    clean.sync(keys, 1);
+    edited.sync(raw, 1);
+
+    float difference = 0.0f, unit = 0.0f, step = 0.0f;
+    glm::quat previous = edited.evaluate(0.0f);
+    for (int i = 0; i <= 1000; ++i) {
+        float t = (float) i / 1000.0f;
+        glm::quat q = edited.evaluate(t);
+        difference = std::max(difference, rotationAngle(clean.evaluate(t), q));
+        unit = std::max(unit, std::fabs(glm::length(q) - 1.0f));
+        // No turn the long way round between samples either, which would show as a sign flip of the quaternion
+        step = std::max(step, maxDifference(previous, q));
+        previous = q;
+    }
+    check(difference < 1e-4f, "rotation spline: raw keys end up " + std::to_string(difference)
+          + " rad from the normalised ones");
+    check(unit < 1e-4f, "rotation spline: results " + std::to_string(unit) + " off unit length");
+    check(step < 0.1f, "rotation spline: the quaternion jumps by " + std::to_string(step) + " between samples");
+}
+
+// Distance from p to the polyline through points
+static float polylineDistance(const glm::vec3& p, const std::vector<glm::vec3>& points) {
+    float best = points.empty() ? std::numeric_limits<float>::max() : glm::length(p - points[0]);
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        glm::vec3 ab = points[i + 1] - points[i];
+        float lengthSquared = glm::dot(ab, ab);
+        float t = lengthSquared > 0.0f ? std::max(0.0f, std::min(glm::dot(p - points[i], ab) / lengthSquared, 1.0f))
+                                       : 0.0f;
+        best = std::min(best, glm::length(p - (points[i] + ab * t)));
+    }
+    return best;
+}
+
+// Tessellates with the overlay's scale and segment cap and checks that every dense sample of the curve lies within the
+// tolerance of the polyline, in pixels. Returns the point count.
+static size_t checkTessellation(const std::string& name, const std::vector<glm::vec3>& controlPoints,
+                                const glm::vec3& scale, float tolerance) {
+    AdaptiveTessellator tessellator;
+    // The depth CachedCurve derives from the governor's 1000 segments
+    tessellator.maxDepth = 9;
+    std::vector<glm::vec3> out;
+    tessellator.tessellate(controlPoints.data(), controlPoints.size(), scale, tolerance, out);
+    check(out.size() >= 2 && out.front() == controlPoints.front() && out.back() == controlPoints.back(),
+          name + ": the polyline doesn't run between the end points");
+
+    std::vector<glm::vec3> scaled(out.size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        scaled[i] = out[i] * scale;
+    }
+    BezierCurve curve(controlPoints);
+    const int SAMPLES = 4000;
+    float worst = 0.0f;
+    for (int i = 0; i <= SAMPLES; ++i) {
+        worst = std::max(worst, polylineDistance(curve.evaluate((float) i / SAMPLES) * scale, scaled));
+    }
+    check(worst <= tolerance * 1.001f, name + ": a sample is " + std::to_string(worst) + " px from the polyline, "
+          "the tolerance is " + std::to_string(tolerance) + " px");
+    return out.size();
+}
+
+// The overlay's 800x600 window with z weighted as the overlay does. Random curves of several degrees stay within the
+// tolerance, and random cubics and the default overlay cubic need at least 5 times fewer points than the uniform 1001.
+static void testAdaptiveTessellation() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(0.0f, 1.0f);
+    const glm::vec3 scale(800.0f, 600.0f, 64.0f);
+    const size_t UNIFORM = 1001;
+    size_t cubicPoints = 0, cubics = 0;
+    for (size_t degree : { 1, 2, 3, 5, 7 }) {
+        for (int c = 0; c < 10; ++c) {
+            std::vector<glm::vec3> points(degree + 1);
+            for (glm::vec3& p : points) {
+                p = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+            }
+            for (float tolerance : { 0.25f, 1.0f }) {
+                size_t count = checkTessellation("tessellation, degree " + std::to_string(degree) + " curve "
+                                                 + std::to_string(c) + " at " + std::to_string(tolerance) + " px",
+                                                 points, scale, tolerance);
+                if (degree == 3 && tolerance == 0.25f) {
+                    cubicPoints += count;
+                    cubics++;
+                }
+            }
+        }
+    }
+    check(cubicPoints * 5 <= UNIFORM * cubics, "tessellation: random cubics take "
+          + std::to_string(cubicPoints / cubics) + " points on average instead of " + std::to_string(UNIFORM));
+
+    // The first four control points of new.cpp, at the overlay's default tolerance
+    std::vector<glm::vec3> overlay = { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.987f),
+                                       glm::vec3(0.0f, 0.0f, 1.922f), glm::vec3(0.0f, 0.0f, 0.0f) };
+    size_t count = checkTessellation("tessellation, default overlay cubic", overlay, scale, 0.25f);
+    check(count * 5 <= UNIFORM, "tessellation: the default overlay cubic takes " + std::to_string(count)
+          + " points instead of " + std::to_string(UNIFORM));
+
+    // A straight line is one segment however long
+    std::vector<glm::vec3> line = { glm::vec3(0.0f), glm::vec3(0.3f, 0.3f, 0.0f), glm::vec3(0.6f, 0.6f, 0.0f),
+                                    glm::vec3(1.0f, 1.0f, 0.0f) };
+    check(checkTessellation("tessellation, line", line, scale, 0.25f) == 2, "tessellation: a line isn't one segment");
+}
+
+int main() {
+    testBezierAccuracy();
+    testBezierEnds();
+    testBezierDegreeChange();
+    testBezierBatch();
+    testNlerp();
+    testSlerp();
+    testCurveBvh();
+    testAdaptiveTessellation();
+    testTrackCursor();
+    testTrackQuantisation();
+    testTrackRotations();
+    testTrackThreads();
+    testArcLength();
+    testArcLengthDegenerate();
+    testPathShape();
+    testPathLocalChanges();
+    testRotationSplineKeys();
+    testRotationSplineHemispheres();
+    if (failures > 0) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All curve tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "render_queue.hpp"
+
+// Key packing, the radix sort and the caps. Nothing here is executed, so no GL context is needed.
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cout << "[ERROR][render_queue_tests] " << what << std::endl;
+        failures++;
+    }
+}
+
+static const float NEAR_PLANE = 0.1f;
+static const float FAR_PLANE = 100.0f;
+
+static DrawCommand command(ShaderProgram& program, GLuint vao, uint32_t material) {
+    DrawCommand result = {};
+    result.program = &program;
+    result.vao = vao;
+    result.indexCount = 3;
+    result.material = material;
+    return result;
+}
+
+static void testKeys() {
+    // The pass decides first, then program, material, VAO and finally depth
+    check(makeDrawKey(RenderPass::DEPTH_PREPASS, 4095, 4095, 4095, 0xFFFFFF)
+          < makeDrawKey(RenderPass::OPAQUE, 0, 0, 0, 0), "pass isn't the most significant field");
+    check(makeDrawKey(RenderPass::OPAQUE, 1, 0, 0, 0xFFFFFF) < makeDrawKey(RenderPass::OPAQUE, 2, 0, 0, 0),
+          "program doesn't come before depth");
+    check(makeDrawKey(RenderPass::OPAQUE, 1, 7, 0, 0) < makeDrawKey(RenderPass::OPAQUE, 1, 8, 0, 0),
+          "materials aren't ordered");
+    // Names wider than their field are masked and can't spill into the pass
+    check(makeDrawKey(RenderPass::DEPTH_PREPASS, 0x1001, 0x1001, 0x1001, 0x1000001)
+          == makeDrawKey(RenderPass::DEPTH_PREPASS, 1, 1, 1, 1), "fields aren't masked to their width");
+
+    check(depthBucket(NEAR_PLANE, NEAR_PLANE, FAR_PLANE) == 0, "the near plane isn't bucket 0");
+    check(depthBucket(FAR_PLANE, NEAR_PLANE, FAR_PLANE) == 0xFFFFFF, "the far plane isn't the last bucket");
+    check(depthBucket(-5.0f, NEAR_PLANE, FAR_PLANE) == 0 && depthBucket(1e6f, NEAR_PLANE, FAR_PLANE) == 0xFFFFFF,
+          "depths outside the planes aren't clamped");
+    check(depthBucket(10.0f, NEAR_PLANE, FAR_PLANE) < depthBucket(10.5f, NEAR_PLANE, FAR_PLANE),
+          "buckets don't grow with depth");
+}
+
+// Random draws come out in key order, equal keys in the order they were submitted
+static void testSort() {
+    std::mt19937 random(26);
+    std::uniform_int_distribution<uint32_t> small(0, 5);
+    std::uniform_real_distribution<float> depth(NEAR_PLANE, FAR_PLANE);
+    ShaderProgram program;
+    RenderQueue queue;
+    std::vector<uint64_t> keys;
+    for (int frame = 0; frame < 2; ++frame) {
+        queue.clear();
+        keys.clear();
+        for (int i = 0; i < 1000; ++i) {
+            RenderPass pass = small(random) < 2 ? RenderPass::DEPTH_PREPASS : RenderPass::OPAQUE;
+            GLuint vao = small(random);
+            uint32_t material = small(random);
+            // Few distinct depths, so many keys are equal
+            float viewDepth = i % 3 == 0 ? 50.0f : depth(random);
+            queue.submit(pass, command(program, vao, material), viewDepth, NEAR_PLANE, FAR_PLANE);
+            keys.push_back(makeDrawKey(pass, program.id(), material, vao,
+                                       depthBucket(viewDepth, NEAR_PLANE, FAR_PLANE)));
+        }
+        queue.sort();
+
+        size_t outOfOrder = 0;
+        for (size_t i = 1; i < queue.size(); ++i) {
+            uint32_t previous = queue.commandAt(i - 1), current = queue.commandAt(i);
+            if (keys[previous] > keys[current] || (keys[previous] == keys[current] && previous > current)) {
+                outOfOrder++;
+            }
+        }
+        check(outOfOrder == 0, std::to_string(outOfOrder) + " draws out of order in frame " + std::to_string(frame));
+    }
+}
+
+// A capped opaque draw has to take its linked pre-pass draw with it, even though the pre-pass sorts by depth and the
+// opaque pass by state. The pre-pass cap doesn't apply to linked draws.
+static void testLinkedCaps() {
+    ShaderProgram program;
+    RenderQueue queue;
+    queue.setPassCap(RenderPass::OPAQUE, 3);
+    queue.setPassCap(RenderPass::DEPTH_PREPASS, 1);
+
+    const int DRAWS = 8;
+    uint32_t owners[DRAWS];
+    uint32_t linked[DRAWS];
+    for (int i = 0; i < DRAWS; ++i) {
+        // Material order is the reverse of depth order, so the two passes sort the other way round
+        float viewDepth = 1.0f + (float) i;
+        owners[i] = queue.submit(RenderPass::OPAQUE, command(program, 1, (uint32_t) (DRAWS - i)), viewDepth,
+                                 NEAR_PLANE, FAR_PLANE);
+        linked[i] = (uint32_t) queue.size();
+        queue.submitLinked(owners[i], RenderPass::DEPTH_PREPASS, command(program, 2, 0), viewDepth, NEAR_PLANE,
+                           FAR_PLANE);
+    }
+    queue.sort();
+
+    int keptOwners = 0;
+    for (int i = 0; i < DRAWS; ++i) {
+        // The opaque pass keeps the lowest materials, the furthest draws
+        bool expected = i >= DRAWS - 3;
+        check(queue.keeps(owners[i]) == expected, "opaque draw " + std::to_string(i) + " is "
+              + (queue.keeps(owners[i]) ? "kept" : "dropped") + " against its cap");
+        check(queue.keeps(linked[i]) == queue.keeps(owners[i]), "pre-pass draw " + std::to_string(i)
+              + " doesn't follow its opaque draw");
+        keptOwners += queue.keeps(owners[i]) ? 1 : 0;
+    }
+    check(keptOwners == 3, std::to_string(keptOwners) + " opaque draws kept with a cap of 3");
+
+    // Without caps everything is kept again
+    queue.setPassCap(RenderPass::OPAQUE, RenderQueue::NO_CAP);
+    queue.sort();
+    for (int i = 0; i < DRAWS; ++i) {
+        check(queue.keeps(owners[i]) && queue.keeps(linked[i]), "draw " + std::to_string(i) + " dropped without caps");
+    }
+}
+
+int main() {
+    testKeys();
+    testSort();
+    testLinkedCaps();
+    if (failures > 0) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All render queue tests passed" << std::endl;
+    return 0;
+}